@@ -0,0 +1,367 @@
+#include "SamplesCommon.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+///glTF component types used by the generated files
+const int GLTF_UNSIGNED_SHORT = 5123, GLTF_FLOAT = 5126;
+
+///Print a line of benchmark result to the standard output and to Ogre's log
+void report(const std::string& message)
+{
+	std::cout << message << std::endl;
+	Ogre::LogManager::getSingleton().logMessage("Benchmark: " + message);
+}
+
+///Write a "face" mesh with morph targets to a glTF file : a grid of vertices, and targets that each move a round patch of it
+/// \param path where to write the .gltf file. The buffer is written next to it
+/// \param gridSize number of vertices along each side of the grid
+/// \param targetCount number of morph targets
+void writeMorphBenchmarkFile(const std::string& path, size_t gridSize, size_t targetCount)
+{
+	const auto vertexCount = gridSize * gridSize;
+	std::vector<float> positions, normals;
+	std::vector<Ogre::uint16> indices;
+
+	for(size_t y = 0; y < gridSize; ++y)
+		for(size_t x = 0; x < gridSize; ++x)
+		{
+			positions.insert(positions.end(), { float(x) / float(gridSize - 1) - 0.5f, float(y) / float(gridSize - 1) - 0.5f, 0.0f });
+			normals.insert(normals.end(), { 0.0f, 0.0f, 1.0f });
+		}
+
+	for(size_t y = 0; y + 1 < gridSize; ++y)
+		for(size_t x = 0; x + 1 < gridSize; ++x)
+		{
+			const auto corner = Ogre::uint16(y * gridSize + x);
+			indices.insert(indices.end(), { corner, Ogre::uint16(corner + 1), Ogre::uint16(corner + gridSize) });
+			indices.insert(indices.end(), { Ogre::uint16(corner + 1), Ogre::uint16(corner + gridSize + 1), Ogre::uint16(corner + gridSize) });
+		}
+
+	//Each target pushes a patch of about a tenth of the vertices out of the grid, like a facial expression would do
+	std::mt19937 random { 42 };
+	std::uniform_real_distribution<float> distribution { -0.4f, 0.4f };
+	std::vector<std::vector<float>> positionDeltas(targetCount, std::vector<float>(vertexCount * 3, 0.0f));
+	std::vector<std::vector<float>> normalDeltas(targetCount, std::vector<float>(vertexCount * 3, 0.0f));
+	for(size_t target = 0; target < targetCount; ++target)
+	{
+		const Ogre::Vector2 center { distribution(random), distribution(random) };
+		for(size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			const auto distance = center.distance({ positions[vertex * 3], positions[vertex * 3 + 1] });
+			if(distance > 0.18f) continue;
+			positionDeltas[target][vertex * 3 + 2] = 0.1f * std::cos(distance / 0.18f * Ogre::Math::HALF_PI);
+			normalDeltas[target][vertex * 3]	   = 0.2f * (positions[vertex * 3] - center.x);
+			normalDeltas[target][vertex * 3 + 1]   = 0.2f * (positions[vertex * 3 + 1] - center.y);
+		}
+	}
+
+	//Binary buffer : indices, positions, normals, then the deltas of each target
+	const auto binaryPath = path.substr(0, path.find_last_of('.')) + ".bin";
+	const auto binaryName = binaryPath.substr(binaryPath.find_last_of("/\\") + 1);
+	std::ofstream binary(binaryPath, std::ios_base::binary);
+	std::stringstream bufferViews, accessors, targets;
+	size_t offset { 0 };
+	size_t viewIndex { 0 };
+
+	const auto addView = [&](const void* data, size_t size, int componentType, size_t count, const std::string& type, const std::string& bounds) {
+		binary.write(reinterpret_cast<const char*>(data), std::streamsize(size));
+		bufferViews << (viewIndex ? "," : "") << R"({"buffer":0,"byteOffset":)" << offset << R"(,"byteLength":)" << size << "}";
+		accessors << (viewIndex ? "," : "") << R"({"bufferView":)" << viewIndex << R"(,"componentType":)" << componentType << R"(,"count":)" << count
+				  << R"(,"type":")" << type << "\"" << bounds << "}";
+		offset += (size + 3) & ~size_t(3);
+		binary.write("\0\0\0", std::streamsize(((size + 3) & ~size_t(3)) - size));
+		return viewIndex++;
+	};
+
+	addView(indices.data(), indices.size() * sizeof(Ogre::uint16), GLTF_UNSIGNED_SHORT, indices.size(), "SCALAR", "");
+	addView(positions.data(), positions.size() * sizeof(float), GLTF_FLOAT, vertexCount, "VEC3", R"(,"min":[-0.5,-0.5,0],"max":[0.5,0.5,0])");
+	addView(normals.data(), normals.size() * sizeof(float), GLTF_FLOAT, vertexCount, "VEC3", "");
+	for(size_t target = 0; target < targetCount; ++target)
+	{
+		const auto position = addView(positionDeltas[target].data(), vertexCount * 3 * sizeof(float), GLTF_FLOAT, vertexCount, "VEC3", "");
+		const auto normal	= addView(normalDeltas[target].data(), vertexCount * 3 * sizeof(float), GLTF_FLOAT, vertexCount, "VEC3", "");
+		targets << (target ? "," : "") << R"({"POSITION":)" << position << R"(,"NORMAL":)" << normal << "}";
+	}
+
+	std::ofstream json(path);
+	json << R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],"nodes":[{"mesh":0,"name":"face"}],)"
+		 << R"("meshes":[{"name":"face","primitives":[{"attributes":{"POSITION":1,"NORMAL":2},"indices":0,"targets":[)" << targets.str() << "]}]}],"
+		 << R"("buffers":[{"uri":")" << binaryName << R"(","byteLength":)" << offset << "}],"
+		 << R"("bufferViews":[)" << bufferViews.str() << "],"
+		 << R"("accessors":[)" << accessors.str() << "]}";
+}
+
+///Write a 24 bit BMP image of a gradient, tinted by a color so that each generated texture is different
+/// \param path where to write the image
+/// \param size width and height of the image in pixels
+/// \param tint color of the image
+void writeBitmap(const std::string& path, size_t size, const Ogre::ColourValue& tint)
+{
+	//"BM", then the file header and the BITMAPINFOHEADER. Rows are bottom up, in BGR order, padded to 4 bytes
+	const auto rowSize			= (size * 3 + 3) & ~size_t(3);
+	const Ogre::uint32 header[] = { Ogre::uint32(54 + rowSize * size), 0, 54, 40, Ogre::uint32(size), Ogre::uint32(size), 1 | (24 << 16), 0,
+									Ogre::uint32(rowSize * size),	   0, 0,  0,  0 };
+	std::ofstream bitmap(path, std::ios_base::binary);
+	bitmap.write("BM", 2);
+	bitmap.write(reinterpret_cast<const char*>(header), sizeof header);
+
+	std::vector<Ogre::uchar> row(rowSize, 0);
+	for(size_t y = 0; y < size; ++y)
+	{
+		for(size_t x = 0; x < size; ++x)
+		{
+			const auto shade = float(x + y) / float(2 * size);
+			row[x * 3]		 = Ogre::uchar(255.0f * tint.b * shade);
+			row[x * 3 + 1]	 = Ogre::uchar(255.0f * tint.g * shade);
+			row[x * 3 + 2]	 = Ogre::uchar(255.0f * tint.r * shade);
+		}
+		bitmap.write(reinterpret_cast<const char*>(row.data()), std::streamsize(rowSize));
+	}
+}
+
+///Write a scene of textured quads to a glTF file. Each quad has its own material, with its own texture of the same size
+/// \param path where to write the .gltf file. The buffer and the images are written next to it
+/// \param quadCount number of quads, materials and textures
+/// \param textureSize width and height of the textures in pixels
+void writeTextureArrayBenchmarkFile(const std::string& path, size_t quadCount, size_t textureSize)
+{
+	const auto basePath = path.substr(0, path.find_last_of('.'));
+	const auto baseName = basePath.substr(basePath.find_last_of("/\\") + 1);
+
+	//All the quads use the same accessors : indices, positions and texture coordinates
+	const Ogre::uint16 indices[] = { 0, 1, 2, 2, 1, 3 };
+	const float positions[]		 = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0 };
+	const float uvs[]			 = { 0, 1, 1, 1, 0, 0, 1, 0 };
+	std::ofstream binary(basePath + ".bin", std::ios_base::binary);
+	binary.write(reinterpret_cast<const char*>(indices), sizeof indices);
+	binary.write(reinterpret_cast<const char*>(positions), sizeof positions);
+	binary.write(reinterpret_cast<const char*>(uvs), sizeof uvs);
+
+	std::stringstream sceneNodes, nodes, meshes, materials, textures, images;
+	for(size_t quad = 0; quad < quadCount; ++quad)
+	{
+		const auto imageName = baseName + "_" + std::to_string(quad) + ".bmp";
+		const auto hue		 = float((quad * 7) % quadCount) / float(quadCount);
+		writeBitmap(basePath + "_" + std::to_string(quad) + ".bmp", textureSize, Ogre::ColourValue { hue, 1.0f - hue, 0.5f + 0.5f * hue });
+
+		const auto separator = quad ? "," : "";
+		sceneNodes << separator << quad;
+		nodes << separator << R"({"mesh":)" << quad << R"(,"translation":[)" << float(quad % 10) * 1.1f << "," << float(quad / 10) * 1.1f << ",0]}";
+		meshes << separator << R"({"primitives":[{"attributes":{"POSITION":1,"TEXCOORD_0":2},"indices":0,"material":)" << quad << "}]}";
+		materials << separator << R"({"pbrMetallicRoughness":{"baseColorTexture":{"index":)" << quad << "}}}";
+		textures << separator << R"({"source":)" << quad << "}";
+		images << separator << R"({"uri":")" << imageName << R"("})";
+	}
+
+	std::ofstream json(path);
+	json << R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[)" << sceneNodes.str() << "]}],"
+		 << R"("nodes":[)" << nodes.str() << "],"
+		 << R"("meshes":[)" << meshes.str() << "],"
+		 << R"("materials":[)" << materials.str() << "],"
+		 << R"("textures":[)" << textures.str() << "],"
+		 << R"("images":[)" << images.str() << "],"
+		 << R"("buffers":[{"uri":")" << baseName << R"(.bin","byteLength":)" << sizeof indices + sizeof positions + sizeof uvs << "}],"
+		 << R"("bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":)" << sizeof indices << "},"
+		 << R"({"buffer":0,"byteOffset":)" << sizeof indices << R"(,"byteLength":)" << sizeof positions << "},"
+		 << R"({"buffer":0,"byteOffset":)" << sizeof indices + sizeof positions << R"(,"byteLength":)" << sizeof uvs << "}],"
+		 << R"("accessors":[{"bufferView":0,"componentType":)" << GLTF_UNSIGNED_SHORT << R"(,"count":6,"type":"SCALAR"},)"
+		 << R"({"bufferView":1,"componentType":)" << GLTF_FLOAT << R"(,"count":4,"type":"VEC3","min":[0,0,0],"max":[1,1,0]},)"
+		 << R"({"bufferView":2,"componentType":)" << GLTF_FLOAT << R"(,"count":4,"type":"VEC2"}]})";
+}
+
+///Measure the cost of blending the morph targets of many faces each frame
+void benchmarkMorphBlending(Ogre_glTF::glTFLoader& gltf, Ogre::SceneManager* smgr)
+{
+	const size_t faceCount { 100 }, targetCount { 50 }, frameCount { 200 };
+	writeMorphBenchmarkFile("./morphBenchmark.gltf", 64, targetCount);
+
+	auto adapter = gltf.loadFromFileSystem("./morphBenchmark.gltf");
+	for(size_t i = 0; i < faceCount; ++i) adapter.getSceneNode(0, smgr->getRootSceneNode(), smgr)->setPosition(float(i % 10), float(i / 10), 0);
+	const auto& controllers = adapter.getMorphControllers();
+
+	for(const size_t threadCount : { size_t(1), size_t(0) })
+	{
+		Ogre_glTF::morphBlender blender { threadCount };
+		for(const auto& controller : controllers) blender.addController(controller);
+
+		double blendTime { 0 }, updateTime { 0 };
+		for(size_t frame = 0; frame < frameCount; ++frame)
+		{
+			//Every weight of every face changes every frame, this is the worst case
+			const auto setWeights = [&](size_t step) {
+				for(size_t face = 0; face < controllers.size(); ++face)
+					for(size_t target = 0; target < controllers[face]->getTargetCount(); ++target)
+						controllers[face]->setWeight(target, 0.5f + 0.5f * std::sin(0.05f * float(step) + float(face + target)));
+			};
+
+			setWeights(2 * frame);
+			auto start = std::chrono::high_resolution_clock::now();
+			blender.blend();
+			blendTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+			setWeights(2 * frame + 1);
+			start = std::chrono::high_resolution_clock::now();
+			blender.update();
+			updateTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+			Ogre::Root::getSingleton().renderOneFrame();
+		}
+
+		report("Morph blending, " + std::to_string(controllers.size()) + " faces, " + std::to_string(targetCount) + " targets, "
+			   + (threadCount == 1 ? std::string("1 thread") : std::to_string(std::thread::hardware_concurrency()) + " threads") + ": "
+			   + std::to_string(blendTime / frameCount) + " ms/frame blending only, " + std::to_string(updateTime / frameCount) + " ms/frame with the upload");
+	}
+}
+
+///Measure the cost of spawning the same model many times, by walking the glTF file each time, and by replaying its blueprint
+void benchmarkInstantiation(Ogre_glTF::glTFLoader& gltf, Ogre::SceneManager* smgr)
+{
+	const size_t spawnCount { 1000 };
+	auto adapter = gltf.loadGlbResource("CesiumMan.glb");
+
+	//Load the meshes, skeletons and textures once, so that both measures only account for the instantiation itself
+	adapter.getFirstSceneNode(smgr)->setPosition(-1, 0, 0);
+	adapter.getBlueprint();
+
+	const auto measure = [&](const std::string& method, const std::function<Ogre::SceneNode*()>& spawn) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		for(size_t i = 0; i < spawnCount; ++i) spawn()->setPosition(float(i % 40), float(i / 40), 0);
+		const auto time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		report(std::to_string(spawnCount) + " CesiumMan spawned with " + method + ": " + std::to_string(time) + " ms, " + std::to_string(1000 * time / spawnCount)
+			   + " us per instance");
+	};
+
+	measure("getFirstSceneNode", [&] { return adapter.getFirstSceneNode(smgr); });
+	measure("instantiate", [&] { return adapter.instantiate(smgr->getRootSceneNode(), smgr); });
+	Ogre::Root::getSingleton().renderOneFrame();
+}
+
+///Compare the draw batches of a scene with many materials, with each texture on its own, and with the textures packed in texture arrays
+void benchmarkTextureArrays(Ogre_glTF::glTFLoader& gltf, Ogre::SceneManager* smgr, Ogre::RenderWindow* window)
+{
+	const size_t quadCount { 100 }, textureSize { 64 }, frameCount { 100 };
+	for(const auto pack : { false, true })
+	{
+		const auto path = std::string { "./textureArrayBenchmark" } + (pack ? "Packed" : "") + ".gltf";
+		writeTextureArrayBenchmarkFile(path, quadCount, textureSize);
+
+		//Only the quads of this file are drawn. The batches are counted on the last frame, the frames are timed after the shaders are compiled
+		smgr->getRootSceneNode()->setVisible(false);
+		auto adapter								 = gltf.loadFromFileSystem(path);
+		adapter.getImportOptions().packTextureArrays = pack;
+		auto sceneNode								 = smgr->getRootSceneNode()->createChildSceneNode();
+		adapter.loadMainScene(sceneNode, smgr);
+
+		Ogre::Root::getSingleton().renderOneFrame();
+		const auto start = std::chrono::high_resolution_clock::now();
+		for(size_t frame = 0; frame < frameCount; ++frame) Ogre::Root::getSingleton().renderOneFrame();
+		const auto time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		const auto& statistics = adapter.getLoadStatistics();
+		const auto textures	   = pack ? std::to_string(statistics.packedTextureCount) + " textures packed in " + std::to_string(statistics.textureArrayCount)
+										  + " texture arrays"
+									  : std::string("textures not packed");
+		report(std::to_string(quadCount) + " materials, " + textures + ": " + std::to_string(window->getStatistics().batchCount) + " batches, "
+			   + std::to_string(time / frameCount) + " ms/frame");
+	}
+}
+
+///Compare the time it takes to load a scene with big textures, with all their levels uploaded while loading, and with the textures streamed
+void benchmarkTextureStreaming(Ogre_glTF::glTFLoader& gltf, Ogre::SceneManager* smgr, const Ogre::Camera* camera)
+{
+	const size_t quadCount { 20 }, textureSize { 1024 }, uploadBudget { 4 * 1024 * 1024 };
+	auto& streamer = Ogre_glTF::textureStreamer::getSingleton();
+	for(const auto stream : { false, true })
+	{
+		const auto path = std::string { "./textureStreamingBenchmark" } + (stream ? "Streamed" : "") + ".gltf";
+		writeTextureArrayBenchmarkFile(path, quadCount, textureSize);
+
+		smgr->getRootSceneNode()->setVisible(false);
+		auto adapter							  = gltf.loadFromFileSystem(path);
+		adapter.getImportOptions().streamTextures = stream;
+		auto start								  = std::chrono::high_resolution_clock::now();
+		adapter.loadMainScene(smgr->getRootSceneNode()->createChildSceneNode(), smgr);
+		const auto loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		//The streamed textures are completed a few at a time, the closest first
+		size_t frameCount { 0 };
+		start = std::chrono::high_resolution_clock::now();
+		streamer.prioritize(camera);
+		for(; streamer.update(uploadBudget) > 0; ++frameCount) Ogre::Root::getSingleton().renderOneFrame();
+		const auto streamTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		const auto streaming  = stream ? std::to_string(adapter.getLoadStatistics().streamedTextureCount) + " streamed" : std::string("not streamed");
+		const auto completion = stream ? ", complete after " + std::to_string(frameCount) + " frames, " + std::to_string(streamTime) + " ms" : std::string();
+		report(std::to_string(quadCount) + " textures of " + std::to_string(textureSize) + "x" + std::to_string(textureSize) + ", " + streaming
+			   + ": loaded in " + std::to_string(loadTime) + " ms" + completion);
+	}
+}
+
+int main()
+{
+#ifdef Ogre_glTF_STATIC
+	// Must instantiate before Root so that it'll be destroyed afterwards.
+	// Otherwise we get a crash on Ogre::Root::shutdownPlugins()
+#if __linux__
+	auto glPlugin = std::make_unique<Ogre::GL3PlusPlugin>();
+#endif
+#endif
+
+	//Init Ogre
+	auto root = std::make_unique<Ogre::Root>();
+
+#ifdef Ogre_glTF_STATIC
+#if __linux__
+	root->installPlugin(glPlugin.get());
+#endif
+#else
+	root->loadPlugin(GL_RENDER_PLUGIN);
+#ifdef _WIN32
+	root->loadPlugin(D3D11_RENDER_PLUGIN);
+#endif
+#endif
+	if(!root->restoreConfig()) root->showConfigDialog();
+	root->initialise(false);
+
+	//Create a window and a scene. Benchmarks don't need to look good, but they need a render system
+	const auto window = root->createRenderWindow("glTF benchmark", 800, 600, false);
+	auto smgr		  = root->createSceneManager(Ogre::ST_GENERIC, 2, Ogre::INSTANCING_CULLING_THREADED);
+	auto camera		  = smgr->createCamera("cam");
+	camera->setPosition(5, 5, 15);
+	camera->lookAt(5, 5, 0);
+	camera->setAutoAspectRatio(true);
+
+	auto compositor			   = root->getCompositorManager2();
+	const char workspaceName[] = "workspace0";
+	compositor->createBasicWorkspaceDef(workspaceName, Ogre::ColourValue { 0.2f, 0.3f, 0.4f });
+	compositor->addWorkspace(smgr, window, camera, workspaceName, true);
+
+	DeclareHlmsLibrary("./Media");
+
+	Ogre::ResourceGroupManager::getSingleton().addResourceLocation("../Media/gltfFiles.zip", "Zip");
+	Ogre::ResourceGroupManager::getSingleton().initialiseAllResourceGroups(true);
+
+	auto gltf = std::make_unique<Ogre_glTF::glTFLoader>();
+
+	try
+	{
+		benchmarkMorphBlending(*gltf, smgr);
+		benchmarkInstantiation(*gltf, smgr);
+		benchmarkTextureArrays(*gltf, smgr, window);
+		benchmarkTextureStreaming(*gltf, smgr, camera);
+	}
+	catch(std::exception& e)
+	{
+		Ogre::LogManager::getSingleton().logMessage(e.what());
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+#include "Ogre_glTF_meshoptDecoder.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace Ogre_glTF;
+
+///Number of failed checks
+size_t failures { 0 };
+
+///Report a failed check
+/// \param condition what is checked
+/// \param description what failed, printed if the check fails
+void check(bool condition, const std::string& description)
+{
+	if(condition) return;
+	std::cerr << "FAILED: " << description << std::endl;
+	++failures;
+}
+
+///Decode copies of an octahedral element and compare them to the expected normal, allowing one unit of rounding difference
+/// \param element the encoded x, y, z and w
+/// \param expected the decoded x, y, z and w
+/// \param count number of copies : less than 4 only run the scalar path, more also run the SIMD path on blocks of 4
+template <typename T>
+void checkOctahedral(const T (&element)[4], const T (&expected)[4], size_t count, const std::string& description)
+{
+	T data[4 * 8];
+	for(size_t i = 0; i < count; ++i) memcpy(data + i * 4, element, sizeof element);
+
+	check(meshopt::decodeFilterOctahedral(reinterpret_cast<unsigned char*>(data), count, sizeof element), description + " is rejected");
+	for(size_t i = 0; i < count; ++i)
+		for(size_t c = 0; c < 4; ++c)
+			check(std::abs(int(data[i * 4 + c]) - int(expected[c])) <= 1,
+				  description + " element " + std::to_string(i) + " component " + std::to_string(c) + " is " + std::to_string(int(data[i * 4 + c]))
+					  + " instead of " + std::to_string(int(expected[c])));
+}
+
+///Known vectors of the octahedral filter. (0.8, 0.5) folds to z = 1 - 0.8 - 0.5 = -0.3 : it unfolds to (0.5, 0.2, -0.3), that is
+///(0.811, 0.324, -0.487) once normalized. (0.2, 0.3) has z = 0.5 and is only normalized to (0.324, 0.487, 0.811)
+void testOctahedralFilter()
+{
+	for(const size_t count : { size_t(3), size_t(5), size_t(8) })
+	{
+		const auto copies = " x" + std::to_string(count);
+		checkOctahedral<int8_t>({ 102, 64, 127, 0 }, { 102, 41, -63, 0 }, count, "8 bit octahedral z < 0" + copies);
+		checkOctahedral<int8_t>({ -102, -64, 127, 0 }, { -102, -41, -63, 0 }, count, "8 bit octahedral z < 0, negative x and y" + copies);
+		checkOctahedral<int8_t>({ 25, 38, 127, 0 }, { 40, 61, 104, 0 }, count, "8 bit octahedral z > 0" + copies);
+		checkOctahedral<int16_t>({ 26214, 16384, 32767, 0 }, { 26577, 10630, -15948, 0 }, count, "16 bit octahedral z < 0" + copies);
+	}
+}
+
+///Filters reject the element sizes they don't support instead of leaving the data quantized
+void testFilterStrides()
+{
+	unsigned char data[48] {};
+	check(!meshopt::decodeFilterOctahedral(data, 4, 12), "octahedral filter accepts a 12 bytes stride");
+	check(!meshopt::decodeFilterQuaternion(data, 4, 4), "quaternion filter accepts a 4 bytes stride");
+	check(!meshopt::decodeFilterExponential(data, 4, 6), "exponential filter accepts a 6 bytes stride");
+	check(meshopt::decodeFilterExponential(data, 4, 12), "exponential filter rejects a 12 bytes stride");
+}
+
+int main()
+{
+	testOctahedralFilter();
+	testFilterStrides();
+
+	if(failures) std::cerr << failures << " checks failed" << std::endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <map>
 #include <memory>
+#include <vector>
 #include <Ogre.h>
 #include <OgreItem.h>
+#include <Math/Simple/OgreAabb.h>
 #include "Ogre_glTF_DLL.hpp"
 
 namespace Ogre_glTF
@@ -11,6 +14,9 @@ namespace Ogre_glTF
 	//Forward declare main class
 	class glTFLoader;
 
+	//Forward declare the morph target controller
+	class morphController;
+
 	///Plugin accessible interface that plugin users can use
 	struct glTFLoaderInterface
 	{
@@ -21,6 +27,258 @@ namespace Ogre_glTF
 		enum class LoadFrom { FileSystem, ResourceManager };
 	};
 
+	///Transcoder of the Basis Universal images of KHR_texture_basisu. The library reads the KTX2 container itself, but doesn't contain
+	///a transcoder : implement this interface on top of basisu's ktx2_transcoder, and give it to importOptions::transcoder
+	class basisTranscoder
+	{
+	public:
+		///Formats the images can be transcoded to
+		enum class Target {
+			BC1, ///< RGB blocks
+			BC3, ///< RGBA blocks
+			BC5, ///< Two channel blocks, for the X and Y of normal maps
+			BC7, ///< RGBA blocks
+			RGBA8 ///< Uncompressed pixels, 4 bytes each
+		};
+
+		///Polymorphic dtor
+		virtual ~basisTranscoder() = default;
+
+		///Transcode one mip level of a KTX2 file. Called from several threads at once, for different levels and files
+		/// \param file content of the .ktx2 file
+		/// \param size size of the file in bytes
+		/// \param level mip level to transcode, 0 is the biggest
+		/// \param target format to transcode to
+		/// \param output set to the blocks, or the pixels, of the level
+		/// \return false if the level couldn't be transcoded
+		virtual bool transcode(const unsigned char* file, size_t size, size_t level, Target target, std::vector<unsigned char>& output) const = 0;
+	};
+
+	///Decoder of the JPEG and PNG images of the files. The library decodes them with stb_image : implement this interface on top of a
+	///faster decoder (libjpeg-turbo, libspng...) and give it to importOptions::decoder. The importer asks for the exact layout its
+	///textures read, so that the pixels don't need to be converted again after decoding
+	class imageDecoder
+	{
+	public:
+		///Layouts the pixels can be decoded to, one byte per channel, 8 bit per channel whatever the depth of the image
+		enum class Layout {
+			Color, ///< RGB, or RGBA if the image has an alpha channel. Greyscale images are expanded to RGB(A)
+			RGB8 ///< RGB, the alpha channel is dropped. Used by the textures that only read the color channels, like metalness and roughness
+		};
+
+		///Polymorphic dtor
+		virtual ~imageDecoder() = default;
+
+		///Decode an image file. Called from the thread that loads the files
+		/// \param file content of the image file
+		/// \param size size of the file in bytes
+		/// \param layout layout of the decoded pixels
+		/// \param output set to the pixels, row by row from the top, without padding
+		/// \param width set to the width of the image in pixels
+		/// \param height set to the height of the image in pixels
+		/// \param channels set to the number of bytes per pixel of output : 3 or 4
+		/// \return false if the image can't be decoded by this decoder, stb_image decodes it then
+		virtual bool decode(const unsigned char* file,
+							size_t size,
+							Layout layout,
+							std::vector<unsigned char>& output,
+							size_t& width,
+							size_t& height,
+							size_t& channels) const = 0;
+	};
+
+	///Options that change how the content of a glTF file is turned into Ogre objects
+	struct importOptions
+	{
+		///Meshes instanced with EXT_mesh_gpu_instancing that have at most this number of vertices get their instances baked
+		///together into a few static batches. Bigger meshes get one lightweight SceneNode and Item per instance
+		size_t instanceBakingVertexLimit = 4096;
+
+		///Maximum number of vertices in a batch of baked instances. The default keeps 16 bit indices usable
+		size_t instanceBatchVertexBudget = 65535;
+
+		///When set, loadMainScene merge the meshes of the static nodes (not skinned, not morphed, not moved by an animation) into a few
+		///Items : the primitives are transformed to the space of the scene, and grouped by material and vertex format
+		bool mergeStaticGeometry = false;
+
+		///Maximum number of vertices in an Item made of merged static geometry. Primitives are split into spatially close clusters to respect it
+		size_t mergedClusterVertexBudget = 65535;
+
+		///When set, materials are canonicalized before their datablock is created, so that near identical materials use the same
+		///Hlms shader permutation : factors are quantized, the alpha settings that have no visible effect are dropped, and textures
+		///made of a single color are folded into the factors
+		bool canonicalizeMaterials = false;
+
+		///When set, datablocks are made from the content of the textures : textures made of a single color are folded into the factors,
+		///flat normal maps are dropped, and blended materials whose alpha is 1 everywhere become opaque, so that they are not sorted as
+		///transparent objects. The images are decoded to be analyzed. canonicalizeMaterials does this too, and also quantizes the factors
+		bool analyzeTextures = false;
+
+		///Step used to quantize the factors of canonicalized materials
+		float materialQuantizationStep = 1.0f / 128.0f;
+
+		///Number of threads used to convert the pixels of big textures, including the calling thread. 0 means one per hardware thread
+		size_t textureThreadCount = 1;
+
+		///Number of threads used to build the keyframes of the skeletal animations, including the calling thread. 0 means one per hardware thread
+		size_t animationThreadCount = 1;
+
+		///When set, normal maps are stored as two channel RG8_SNORM textures, the Hlms PBS reconstruct Z in the shader. This halves their memory
+		bool twoChannelNormalMaps = false;
+
+		///When set, textures made from decoded images get a complete mip chain, computed on the CPU with a gamma correct box filter, on the
+		///importOptions::textureThreadCount threads. Otherwise they only have their first level
+		bool generateMipmaps = true;
+
+		///When set, the textures used by the materials are created together and the ones with the same size, format and use are packed in
+		///shared texture arrays. The datablocks use slices of these arrays, so that objects with different materials can be drawn in the
+		///same batch
+		bool packTextureArrays = false;
+
+		///When set, big textures are streamed : only their levels that are not bigger than streamedLevelSize are created while loading, so
+		///that the materials can be used right away. Their other levels are computed on a background thread and uploaded by the
+		///textureStreamer, that needs to be updated each frame. Textures packed in texture arrays, and the ones of KTX2 images, are not streamed
+		bool streamTextures = false;
+
+		///Biggest width or height of the levels of streamed textures created while loading
+		size_t streamedLevelSize = 64;
+
+		///Biggest width or height of the textures, 0 for no limit. Bigger images are halved with the gamma correct box filter of the mip
+		///chains until they fit, right after decoding, before any other processing : each halving divides the memory and the upload time of
+		///the texture by 4. KTX2 images skip their biggest levels instead. The source files are left as they are
+		size_t maxTextureSize = 0;
+
+		///Biggest width or height of the textures of a role, 0 to use maxTextureSize. Colors are base color and emissive textures. An image
+		///used for several roles gets the biggest of their limits
+		size_t maxColorTextureSize = 0, maxMetalRoughTextureSize = 0, maxNormalTextureSize = 0;
+
+		///Block compression presets for the textures, encoded on the CPU while importing
+		enum class TextureCompression {
+			None, ///< Textures are uploaded uncompressed
+			Fast, ///< BC1 (BC3 with alpha) for colors, BC4 for metalness and roughness, BC5 for normals. Endpoints are fitted to the bounding box of each block
+			Quality ///< Same as Fast, but BC7 for colors, and endpoints fitted to the principal axis of each block then refined. Several times slower
+		};
+
+		///Block compression of the textures. Formats that the render system doesn't support fall back to the next best one, or to no compression
+		TextureCompression compressTextures = TextureCompression::None;
+
+		///If not empty, directory where compressed textures are cached, so that each image is only encoded once. It must exist
+		std::string textureCacheDirectory;
+
+		///Transcoder of the KTX2 images of KHR_texture_basisu. Without one, textures use the fallback image of the file when it has one.
+		///KTX2 files that store BCn or RGBA8 levels as they are don't need a transcoder
+		std::shared_ptr<basisTranscoder> transcoder;
+
+		///Decoder of the JPEG and PNG images, tried before stb_image. Without one, stb_image decodes all the images
+		std::shared_ptr<imageDecoder> decoder;
+	};
+
+	///Bounds of the vertices of a submesh
+	struct subMeshBounds
+	{
+		///Axis aligned bounding box of the vertices
+		Ogre::Aabb box;
+
+		///Radius of the bounding sphere of the vertices. The sphere is centered on the box
+		Ogre::Real radius;
+	};
+
+	///Statistics about the objects created from a glTF file
+	struct loadStatistics
+	{
+		///Number of instances created from nodes using EXT_mesh_gpu_instancing
+		size_t instanceCount = 0;
+
+		///Number of Items used to draw these instances
+		size_t instanceBatchCount = 0;
+
+		///Approximate memory used by these instances, in bytes. Account for the instance transforms, the baked geometry and the per instance scene objects
+		size_t instanceMemory = 0;
+
+		///Number of primitives of static nodes that were merged together
+		size_t mergedPrimitiveCount = 0;
+
+		///Number of Items used to draw the merged static geometry
+		size_t mergedItemCount = 0;
+
+		///Number of textures packed in shared texture arrays
+		size_t packedTextureCount = 0;
+
+		///Number of texture arrays holding these textures
+		size_t textureArrayCount = 0;
+
+		///Number of textures that were already loaded from the same image, by this adapter or another one, and were reused
+		size_t reusedTextureCount = 0;
+
+		///Number of textures created with their small levels only, and completed by the textureStreamer
+		size_t streamedTextureCount = 0;
+	};
+
+	///How the materials of a file map to Hlms PBS shader permutations. Each distinct set of Hlms properties needs its own shaders,
+	///compiled the first time an object using it is rendered
+	struct materialReport
+	{
+		///Number of materials in the file
+		size_t materialCount = 0;
+
+		///Number of distinct sets of Hlms properties used by the materials, as they are written in the file
+		size_t permutationCount = 0;
+
+		///Number of distinct sets of Hlms properties used by the materials once they are canonicalized
+		size_t canonicalPermutationCount = 0;
+
+		///Number of distinct datablocks needed by the materials, as they are written in the file
+		size_t datablockCount = 0;
+
+		///Number of distinct datablocks needed by the materials once they are canonicalized
+		size_t canonicalDatablockCount = 0;
+
+		///Number of materials using each canonical set of properties, keyed by a readable description of the set
+		std::map<std::string, size_t> permutations;
+	};
+
+	///A node of a sceneBlueprint, with everything that doesn't change from one instance to the next already resolved
+	struct blueprintNode
+	{
+		///Index in the blueprint of the node this one is a child of. -1 for the roots of the scene and for tag points
+		int parent = -1;
+
+		///Index of the glTF node this one is made from
+		size_t gltfNode = 0;
+
+		///Name given to the scene node
+		std::string name;
+
+		///Local transform of the node
+		Ogre::Vector3 position, scale;
+
+		///Local transform of the node
+		Ogre::Quaternion orientation;
+
+		///Mesh of the item attached to the node. Null if there is no item, or if ownItem is set
+		Ogre::MeshPtr mesh;
+
+		///Datablock of each submesh of the mesh
+		std::vector<Ogre::HlmsDatablock*> datablocks;
+
+		///Set if each instance need its own item, created by the adapter : morphed meshes and EXT_mesh_gpu_instancing
+		bool ownItem = false;
+
+		///If not -1, this node is a tag point attached to the bone boneName of the item of this node of the blueprint
+		int skeletonOwner = -1;
+
+		///Name of the bone a tag point is attached to
+		std::string boneName;
+	};
+
+	///Main scene of a glTF file compiled to a flat array of nodes, where parents always come before their children.
+	///Instantiating it doesn't need to read the glTF file again, only to replay the array
+	struct sceneBlueprint
+	{
+		///Nodes of the scene
+		std::vector<blueprintNode> nodes;
+	};
+
 	///Class that hold the loaded content of a glTF file and that can create Ogre objects from it
 	class Ogre_glTF_EXPORT loaderAdapter
 	{
@@ -34,6 +292,20 @@ namespace Ogre_glTF
 
 		std::string adapterName;
 
+		///Create the scene node of a single glTF node, with the item of its mesh and its tag points, but without its children
+		/// \param index index of the glTF node
+		/// \param parentSceneNode scene node the new one will be a child of
+		/// \param smgr scene manager where the objects are created
+		/// \param withItem if false, the mesh of the node is not created. Used when it was merged with other static geometry
+		Ogre::SceneNode* createSceneNode(size_t index, Ogre::SceneNode* parentSceneNode, Ogre::SceneManager* smgr, bool withItem = true) const;
+
+		///Create the scene nodes of a node and its subtree
+		/// \param index index of the glTF node
+		/// \param parentSceneNode scene node the new one will be a child of
+		/// \param smgr scene manager where the objects are created
+		/// \param mergedNodes optional, for each glTF node : 0 if it is created normally, 1 if its mesh was merged, 2 if its whole subtree was merged
+		Ogre::SceneNode* createSubtree(size_t index, Ogre::SceneNode* parentSceneNode, Ogre::SceneManager* smgr, const Ogre::uint8* mergedNodes) const;
+
 	public:
 		///This will also initialize the "pimpl" structure
 		loaderAdapter();
@@ -64,6 +336,15 @@ namespace Ogre_glTF
 
 		void createTagPoints(int boneIndex, Ogre::SkeletonInstance* skeletonInstance, Ogre::SceneManager* smgr) const;
 
+		///Get the blueprint of the main scene. It is compiled the first time it is needed, the meshes, datablocks and textures it use are loaded then
+		const sceneBlueprint& getBlueprint() const;
+
+		///Create a new instance of the main scene from its blueprint. This is a lot faster than loadMainScene when spawning the same model many times
+		/// \param parentNode node under which the instance is created
+		/// \param smgr scene manager where the instance is created
+		/// \return a new child of parentNode that hold the root nodes of the scene
+		Ogre::SceneNode* instantiate(Ogre::SceneNode* parentNode, Ogre::SceneManager* smgr) const;
+
 		///Move constructor : object is movable
 		/// \param other object to move
 		loaderAdapter(loaderAdapter&& other) noexcept;
@@ -76,6 +357,22 @@ namespace Ogre_glTF
 
 		///Return the last error generated by the underlying glTF loading library
 		std::string getLastError() const;
+
+		///Get the options used when creating Ogre objects from this file. They can be changed before calling loadMainScene or getSceneNode
+		importOptions& getImportOptions();
+
+		///Get statistics about the objects that have been created from this file so far
+		const loadStatistics& getLoadStatistics() const;
+
+		///Count the Hlms property sets the materials of the file generate, with and without canonicalization. No datablock is created
+		materialReport getMaterialReport() const;
+
+		///Get the exact bounds of each submesh of a mesh. Ogre only culls whole items, this can be used to cull the submeshes of big meshes individually
+		/// \param meshIndex index of the mesh in the glTF file
+		std::vector<subMeshBounds> getSubMeshBounds(size_t meshIndex) const;
+
+		///Get the controllers of the items created so far that use morph targets. Add them to a morphBlender to see the weights applied
+		const std::vector<std::shared_ptr<morphController>>& getMorphControllers() const;
 	};
 
 	///Class that is responsible for initializing the library with the loader, and giving out
@@ -149,3 +446,6 @@ namespace Ogre_glTF
 //To facilitate the use of the library:
 #include "Ogre_glTF_OgreResource.hpp"
 #include "Ogre_glTF_OgrePlugin.hpp"
+#include "Ogre_glTF_morph.hpp"
+#include "Ogre_glTF_textureStreamer.hpp"
+#include "Ogre_glTF_residency.hpp"
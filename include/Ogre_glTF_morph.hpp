@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Ogre_glTF_DLL.hpp"
+
+#include <Ogre.h>
+#include <OgreItem.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	//Forward declare the loaded morph target data. Their content is only used by the library
+	struct morphMeshData;
+	struct morphAnimationList;
+	class threadPool;
+
+	///Weights of the morph targets of one Item. The loaderAdapter creates one for each Item that use a mesh with morph targets.
+	///Changing the weights doesn't change the mesh until the controller is updated by a morphBlender. The controller owns the mesh made
+	///for its item : the mesh is destroyed once both the controller and the item are
+	class Ogre_glTF_EXPORT morphController
+	{
+		friend class morphBlender;
+
+		///The item we are morphing
+		Ogre::Item* item;
+
+		///Mesh of the item, that no other item uses. Removed from the MeshManager with the controller
+		Ogre::MeshPtr mesh;
+
+		///Morph targets of the mesh of the item
+		std::shared_ptr<const morphMeshData> morphData;
+
+		///Weight animations of the node the item is attached to
+		std::shared_ptr<const morphAnimationList> animations;
+
+		///For each submesh, the vertex buffer that contains the morphed attributes
+		std::vector<Ogre::VertexBufferPacked*> vertexBuffers;
+
+		///For each submesh, the blended vertex data, as it will be uploaded to the vertex buffer
+		std::vector<std::vector<float>> blendedVertices;
+
+		///Current weight of each target
+		std::vector<float> weights;
+
+		///Set when the weights changed since the last time the vertices have been blended
+		bool weightsChanged = true;
+
+		///Set when the vertices have been blended but not uploaded to the GPU yet
+		bool uploadPending = false;
+
+	public:
+		///Construct a controller. This is done by the loaderAdapter
+		/// \param morphedItem the item we are morphing
+		/// \param data morph targets of the mesh of the item
+		/// \param buffers for each submesh, the vertex buffer that contains the morphed attributes
+		/// \param weightAnimations weight animations of the node the item is attached to
+		/// \param initialWeights the weights to start from
+		morphController(Ogre::Item* morphedItem,
+						std::shared_ptr<const morphMeshData> data,
+						std::vector<Ogre::VertexBufferPacked*> buffers,
+						std::shared_ptr<const morphAnimationList> weightAnimations,
+						std::vector<float> initialWeights);
+
+		///Remove the mesh of the item from the MeshManager. Its buffers are destroyed once the item doesn't use them either
+		~morphController();
+
+		///Non copyable object
+		morphController(const morphController&) = delete;
+
+		///Non copyable object
+		morphController& operator=(const morphController&) = delete;
+
+		///Get the item we are morphing
+		Ogre::Item* getItem() const;
+
+		///Get the number of morph targets
+		size_t getTargetCount() const;
+
+		///Get the name of a morph target, if the file gives one
+		/// \param target index of the target
+		std::string getTargetName(size_t target) const;
+
+		///Get the current weight of a target
+		/// \param target index of the target
+		float getWeight(size_t target) const;
+
+		///Set the weight of a target
+		/// \param target index of the target
+		/// \param weight weight of the target. 0 means the target is not applied, 1 means it's fully applied
+		void setWeight(size_t target, float weight);
+
+		///Get the names of the animations of the target weights
+		std::vector<std::string> getAnimationNames() const;
+
+		///Get the length of an animation, in seconds. Return 0 if there's no animation with this name
+		/// \param animation name of the animation
+		float getAnimationLength(const std::string& animation) const;
+
+		///Set the weights to their value at a given time of an animation. Return false if there's no animation with this name
+		/// \param animation name of the animation
+		/// \param time time in the animation, in seconds
+		bool setAnimationTime(const std::string& animation, float time);
+	};
+
+	///Apply the morph targets of a set of controllers. Blending is done on the CPU with SIMD kernels, spread across several threads,
+	///and the results are uploaded to the vertex buffers of the items.
+	class Ogre_glTF_EXPORT morphBlender
+	{
+		///The controllers we are updating
+		std::vector<std::shared_ptr<morphController>> controllers;
+
+		///The threads that blend the controllers
+		std::unique_ptr<threadPool> threads;
+
+	public:
+		///Construct a morph blender
+		/// \param threadCount number of threads used to blend. 0 means one per hardware thread
+		explicit morphBlender(size_t threadCount = 0);
+
+		///Stop the blending threads
+		~morphBlender();
+
+		///Non copyable object
+		morphBlender(const morphBlender&) = delete;
+
+		///Non copyable object
+		morphBlender& operator=(const morphBlender&) = delete;
+
+		///Add a controller to update
+		void addController(std::shared_ptr<morphController> controller);
+
+		///Stop updating a controller
+		void removeController(const std::shared_ptr<morphController>& controller);
+
+		///Blend the controllers which weights changed, and upload the results to the GPU. Call this once per frame, from the thread that render
+		void update();
+
+		///Only blend the controllers which weights changed, without uploading anything. The upload happens at the next update() call.
+		///This is what update() spend most of its time on, and it doesn't need the render system to be used.
+		void blend();
+	};
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Ogre_glTF_DLL.hpp"
+#include <Ogre.h>
+#include <memory>
+#include <string>
+
+namespace Ogre_glTF
+{
+	//Forward declare the state of the residency manager. Its content is only used by the library
+	struct residencyManagerState;
+
+	///Keep the meshes and the datablocks made by the adapters under a memory budget. Each adapter holds a reference on the resources it
+	///created or reused, until it is destroyed. Once no adapter holds a resource and no item uses it anymore, it stays loaded, so that
+	///loading the same file again is fast, until the budget is exceeded : the resources that were used the longest time ago are then
+	///destroyed first. The textures of a destroyed datablock are destroyed along with it if nothing else uses them. Resources are named
+	///after the content of their file, an evicted resource is created again from its file (or from the compressed texture cache) by the
+	///next adapter that needs it. It is shared by all the adapters, and used from the thread that loads the files
+	class Ogre_glTF_EXPORT residencyManager
+	{
+		///Resources tracked by the manager, and the budgets
+		std::unique_ptr<residencyManagerState> state;
+
+		///Construct the manager, with unlimited budgets
+		residencyManager();
+
+	public:
+		///Kind of a tracked resource
+		enum class Kind { Mesh, Datablock };
+
+		///Destruct the manager. Resources are left as they are
+		~residencyManager();
+
+		///Non copyable object
+		residencyManager(const residencyManager&) = delete;
+
+		///Non copyable object
+		residencyManager& operator=(const residencyManager&) = delete;
+
+		///Get the manager shared by all the adapters
+		static residencyManager& getSingleton();
+
+		///Set the memory budgets. Budgets are only enforced by update. Both are unlimited by default, nothing is ever evicted then
+		/// \param cpuBytes system memory budget, in bytes : shadow copies of the buffers, and the datablocks
+		/// \param gpuBytes video memory budget, in bytes : vertex and index buffers, and the textures made by the importers
+		void setBudget(size_t cpuBytes, size_t gpuBytes);
+
+		///Add a reference on a resource, registering it with its size the first time. This is done by the adapters
+		/// \param kind kind of the resource
+		/// \param name name of the resource in the MeshManager, or in the Hlms PBS
+		void acquire(Kind kind, const std::string& name);
+
+		///Remove a reference on a resource. It can be evicted once it doesn't have any reference, and isn't used by any item
+		/// \param kind kind of the resource
+		/// \param name name of the resource
+		void release(Kind kind, const std::string& name);
+
+		///Mark the resources that are in use as used this frame, then evict the resources that are not in use, the least recently used
+		///first, until the memory used is under the budgets. Call this once per frame, or after destroying items or adapters
+		/// \return number of resources that were evicted
+		size_t update();
+
+		///Get the system memory used by the tracked resources, in bytes
+		size_t getCpuMemory() const;
+
+		///Get the video memory used by the tracked resources and the textures made by the importers, in bytes
+		size_t getGpuMemory() const;
+
+		///Get the number of resources evicted since the start of the program
+		size_t getEvictedCount() const;
+	};
+}
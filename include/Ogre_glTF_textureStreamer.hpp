@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Ogre_glTF_DLL.hpp"
+#include <Ogre.h>
+#include <memory>
+
+namespace Ogre_glTF
+{
+	//Forward declare the streamed textures and the state of the streamer. Their content is only used by the library
+	struct streamedTexture;
+	struct textureStreamerState;
+
+	///Complete the textures loaded with importOptions::streamTextures. Only their smallest levels are uploaded while loading, so that the
+	///materials can be used right away. The streamer computes all the levels of these textures on a background thread, and uploads the
+	///complete textures a few at a time, under a byte budget. It is shared by all the adapters
+	class Ogre_glTF_EXPORT textureStreamer
+	{
+		///State of the streamer, and its thread
+		std::unique_ptr<textureStreamerState> state;
+
+		///Construct the streamer. The thread is started with the first texture
+		textureStreamer();
+
+	public:
+		///Stop the thread. The textures that were not uploaded yet keep their smallest levels
+		~textureStreamer();
+
+		///Non copyable object
+		textureStreamer(const textureStreamer&) = delete;
+
+		///Non copyable object
+		textureStreamer& operator=(const textureStreamer&) = delete;
+
+		///Get the streamer shared by all the adapters
+		static textureStreamer& getSingleton();
+
+		///Add a texture to complete. This is done by the texture importer, after it uploaded the smallest levels of the texture
+		/// \param texture what the texture is, and how to compute its levels
+		void add(std::unique_ptr<streamedTexture> texture);
+
+		///Upload the textures whose levels are computed, highest priority first, until byteBudget bytes are uploaded. The texture is replaced
+		///by a complete one, with all its levels, at once : at least one texture is uploaded if one is ready, even if it is bigger than the
+		///budget. Call this once per frame, from the thread that renders
+		/// \param byteBudget maximum number of bytes to upload, unless a single texture is bigger
+		/// \return number of textures that are not complete yet
+		size_t update(size_t byteBudget);
+
+		///Set the priority of the textures from the items that use them : the bigger an item looks from the camera, the sooner the textures
+		///of its material are computed and uploaded. Items are found through the datablocks of the Hlms PBS. Call this when the camera moves
+		/// \param camera the camera the scene is seen from
+		void prioritize(const Ogre::Camera* camera);
+
+		///Compute and upload all the textures that are not complete yet, whatever their size
+		void finish();
+
+		///Get the number of textures that are not complete yet
+		size_t getPendingCount() const;
+	};
+}
@@ -5,6 +5,11 @@
 #include "Ogre_glTF_textureImporter.hpp"
 #include "Ogre_glTF_materialLoader.hpp"
 #include "Ogre_glTF_skeletonImporter.hpp"
+#include "Ogre_glTF_bufferViewDecoder.hpp"
+#include "Ogre_glTF_accessorReader.hpp"
+#include "Ogre_glTF_morphTargetImporter.hpp"
+#include "Ogre_glTF_sceneGraphIndex.hpp"
+#include "Ogre_glTF_ktx2.hpp"
 #include "Ogre_glTF_common.hpp"
 #include "Ogre_glTF_OgreResource.hpp"
 #include "Ogre_glTF_internal_utils.hpp"
@@ -16,7 +21,10 @@
 
 #include <OgreItem.h>
 #include <OgreMesh2.h>
+#include <OgreMeshManager2.h>
 #include <Animation/OgreTagPoint.h>
+#include <limits>
+#include <map>
 
 using namespace Ogre_glTF;
 
@@ -25,7 +33,11 @@ struct loaderAdapter::impl
 {
 	///Constructor, initialize once all the objects inclosed in this class. They need a reference
 	///to a model object (and sometimes more) given at construct time
-	impl() : textureImp(model), materialLoad(model, textureImp), modelConv(model), skeletonImp(model) {}
+	impl() :
+	 bufferViews(model), accessors(model, bufferViews), sceneGraph(model), textureImp(model, options, statistics), materialLoad(model, textureImp, options),
+	 modelConv(model, bufferViews), skeletonImp(model, bufferViews, accessors, sceneGraph, options), morphImp(model, accessors)
+	{
+	}
 
 	///Variable to check if everything is alright with the adapter
 	bool valid = false;
@@ -39,6 +51,21 @@ struct loaderAdapter::impl
 	///Where tinygltf will write it's warning messages
 	std::string warnings = "";
 
+	///Options used when creating Ogre objects
+	importOptions options;
+
+	///Statistics about the created Ogre objects
+	loadStatistics statistics;
+
+	///BufferView decoder : give access to the bufferViews data, and decode them on first access if they are compressed
+	bufferViewDecoder bufferViews;
+
+	///Accessor reader : read whole accessors as arrays of floats
+	accessorReader accessors;
+
+	///Scene graph index : parents, joints and traversal order of the nodes, computed once for the whole file
+	sceneGraphIndex sceneGraph;
+
 	///Texture importer object : go through the texture array and load them into Ogre
 	textureImporter textureImp;
 
@@ -51,207 +78,690 @@ struct loaderAdapter::impl
 
 	///Skeleton importer : load skins from the glTF model, create equivalent OgreSkeleton objects
 	skeletonImporter skeletonImp;
-};
 
-loaderAdapter::loaderAdapter() : pimpl { std::make_unique<impl>() } { OgreLog("Created adapter object..."); }
+	///Morph target importer : load the morph targets of the meshes, and the animations of their weights
+	morphTargetImporter morphImp;
 
-loaderAdapter::~loaderAdapter() { OgreLog("Destructed adapter object..."); }
+	///The controllers of all the morphed items that were created
+	std::vector<std::shared_ptr<morphController>> morphControllers;
 
-void loaderAdapter::loadMainScene(Ogre::SceneNode* parentNode, Ogre::SceneManager* smgr) const
-{
-	if(!isOk())
-		return;
+	///Counter used to give an unique name to the meshes of morphed items
+	static size_t morphedMeshCount;
 
-	pimpl->textureImp.loadTextures();
-	auto sceneIdx = pimpl->model.defaultScene >= 0 ? pimpl->model.defaultScene : 0;
-	const auto& scene = pimpl->model.scenes[sceneIdx];
+	///Create the controller of a morphed item
+	/// \param nodeIndex index of the glTF node the item is created for
+	/// \param item the morphed item
+	/// \param morphedBuffers the vertex buffers with the morphed attributes of each submesh of the item
+	void createMorphController(size_t nodeIndex, Ogre::Item* item, std::vector<Ogre::VertexBufferPacked*> morphedBuffers);
 
-	for(auto nodeIdx : scene.nodes)
+	///Hash of the content of the loaded file, used to give unique names to the Ogre resources created from it
+	std::string sourceHash;
+
+	///Set the hash that identify the content of the loaded file
+	/// \param hash value returned by internal_utils::hashBytes
+	void setSourceHash(std::uint64_t hash)
 	{
-		getSceneNode(nodeIdx, parentNode, smgr);
+		sourceHash = internal_utils::hashToString(hash);
+		modelConv.setSourceIdentifier(sourceHash);
 	}
-}
 
-Ogre::SceneNode* loaderAdapter::getFirstSceneNode(Ogre::SceneManager* smgr) const
+	///Create the instances of a node that use the EXT_mesh_gpu_instancing extension. Return false if the node doesn't use it
+	/// \param nodeIndex index of the glTF node
+	/// \param sceneNode the scene node created for the glTF node. Instances are relative to it
+	/// \param smgr the scene manager where we create the Items
+	bool createInstances(size_t nodeIndex, Ogre::SceneNode* sceneNode, Ogre::SceneManager* smgr);
+
+	///Return true if the items of a node can't share their mesh with other instances of the scene : morphed meshes, and EXT_mesh_gpu_instancing
+	/// \param nodeIndex index of the glTF node
+	bool needsOwnItem(size_t nodeIndex);
+
+	///Create and attach the item(s) of the mesh of a node. Return the item, or nullptr when the node use EXT_mesh_gpu_instancing
+	/// \param nodeIndex index of the glTF node. It must have a mesh
+	/// \param sceneNode the scene node created for the glTF node
+	/// \param smgr the scene manager where we create the Items
+	Ogre::Item* createItem(size_t nodeIndex, Ogre::SceneNode* sceneNode, Ogre::SceneManager* smgr);
+
+	///Merge the meshes of the static nodes of a scene into a few Items, grouped by material and vertex format, and split in spatial clusters.
+	///Return for each node : 0 if it must be created normally, 1 if its mesh was merged, 2 if its whole subtree was merged
+	/// \param scene the scene we are loading
+	/// \param parentNode scene node the scene is loaded under. The merged Items are attached to it
+	/// \param smgr the scene manager where we create the Items
+	std::vector<Ogre::uint8> mergeStaticGeometry(const tinygltf::Scene& scene, Ogre::SceneNode* parentNode, Ogre::SceneManager* smgr);
+
+	///Compiled main scene, built the first time it is instantiated
+	std::unique_ptr<sceneBlueprint> blueprint;
+
+	///Build the blueprint of the main scene
+	void compileBlueprint();
+};
+
+size_t loaderAdapter::impl::morphedMeshCount = 0;
+
+void loaderAdapter::impl::createMorphController(size_t nodeIndex, Ogre::Item* item, std::vector<Ogre::VertexBufferPacked*> morphedBuffers)
 {
-	if(!isOk())
-		return nullptr;
-	
-	pimpl->textureImp.loadTextures();
-	return getSceneNode(pimpl->model.scenes[0].nodes[0], smgr->getRootSceneNode(), smgr);
+	const auto& node = model.nodes[nodeIndex];
+	auto data		 = morphImp.getMorphData(node.mesh);
+
+	//The weights of the node override the ones of the mesh
+	auto weights = data->defaultWeights;
+	for(size_t i = 0; i < std::min(weights.size(), node.weights.size()); ++i) weights[i] = float(node.weights[i]);
+
+	//The vertices can leave the bounds of the base mesh
+	auto bounds = item->getMesh()->getAabb();
+	bounds.mHalfSize += data->maxDisplacement;
+	item->getMesh()->_setBounds(bounds, false);
+
+	morphControllers.push_back(
+		std::make_shared<morphController>(item, data, std::move(morphedBuffers), morphImp.getWeightAnimations(nodeIndex), std::move(weights)));
 }
 
-Ogre::SceneNode* loaderAdapter::getSceneNode(size_t index, Ogre::SceneNode* parentSceneNode, Ogre::SceneManager* smgr) const
+namespace
 {
-	assert(index < pimpl->model.nodes.size());
+	///Spread the 10 lower bits of a value so that there are 2 zero bits between each of them
+	Ogre::uint32 spreadBits(Ogre::uint32 value)
+	{
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
 
-	const auto& node = pimpl->model.nodes[index];
-	// Check if node is not a bone
-	for(const auto& skin : pimpl->model.skins)
+	///Get the order in which to visit a list of points so that points that are next to each other in space are next to each other in the list (Morton order)
+	std::vector<size_t> getSpatialOrder(const std::vector<Ogre::Vector3>& points)
 	{
-		if(std::find(skin.joints.begin(), skin.joints.end(), index) != skin.joints.end())
+		Ogre::Vector3 minimum { Ogre::Vector3::ZERO }, maximum { Ogre::Vector3::ZERO };
+		if(!points.empty()) minimum = maximum = points.front();
+		for(const auto& point : points)
+		{
+			minimum.makeFloor(point);
+			maximum.makeCeil(point);
+		}
+
+		auto extent = maximum - minimum;
+		extent.makeCeil(Ogre::Vector3 { std::numeric_limits<float>::epsilon() });
+
+		std::vector<std::pair<Ogre::uint32, size_t>> codes(points.size());
+		for(size_t i = 0; i < points.size(); ++i)
 		{
-			return nullptr;
+			const auto cell = (points[i] - minimum) / extent * 1023.f;
+			codes[i]		= { spreadBits(Ogre::uint32(cell.x)) | (spreadBits(Ogre::uint32(cell.y)) << 1) | (spreadBits(Ogre::uint32(cell.z)) << 2), i };
 		}
+		std::sort(codes.begin(), codes.end());
+
+		std::vector<size_t> order(points.size());
+		for(size_t i = 0; i < codes.size(); ++i) order[i] = codes[i].second;
+		return order;
 	}
 
-	auto sceneNode = parentSceneNode->createChildSceneNode();
-	sceneNode->setName(node.name);
-	
-	if(!node.translation.empty())
-		sceneNode->setPosition(node.translation[0], node.translation[1], node.translation[2]);
+	///Get the local transform of a node, from its matrix or its TRS properties
+	void getNodeTransform(const tinygltf::Node& node, Ogre::Vector3& position, Ogre::Quaternion& orientation, Ogre::Vector3& scale)
+	{
+		position	= Ogre::Vector3::ZERO;
+		orientation	= Ogre::Quaternion::IDENTITY;
+		scale		= Ogre::Vector3::UNIT_SCALE;
 
-	if(!node.rotation.empty())
-		sceneNode->setOrientation(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
+		if(!node.translation.empty()) position = Ogre::Vector3(node.translation[0], node.translation[1], node.translation[2]);
+		if(!node.rotation.empty()) orientation = Ogre::Quaternion(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
+		if(!node.scale.empty()) scale = Ogre::Vector3(node.scale[0], node.scale[1], node.scale[2]);
 
-	if(!node.scale.empty())
-		sceneNode->setScale(node.scale[0], node.scale[1], node.scale[2]);
+		if(!node.matrix.empty())
+		{
+			std::array<Ogre::Real, 4 * 4> matrixArray { 0 };
+			internal_utils::container_double_to_real(node.matrix, matrixArray);
+			Ogre::Matrix4 matrix { matrixArray.data() };
+			matrix.transpose().decomposition(position, scale, orientation);
+		}
+	}
+}
 
-	if(!node.matrix.empty())
+bool loaderAdapter::impl::createInstances(size_t nodeIndex, Ogre::SceneNode* sceneNode, Ogre::SceneManager* smgr)
+{
+	const auto& node	 = model.nodes[nodeIndex];
+	const auto extension = internal_utils::findExtension(node.extensions, "EXT_mesh_gpu_instancing");
+	if(!extension || !extension->Has("attributes")) return false;
+
+	//Read the instance transforms in bulk
+	const auto& attributes		   = extension->Get("attributes");
+	const auto translationAccessor = int(internal_utils::getNumber(attributes, "TRANSLATION", -1));
+	const auto rotationAccessor	   = int(internal_utils::getNumber(attributes, "ROTATION", -1));
+	const auto scaleAccessor	   = int(internal_utils::getNumber(attributes, "SCALE", -1));
+
+	std::vector<float> translations, rotations, scales;
+	size_t instanceCount { 0 };
+	if(translationAccessor >= 0)
 	{
-		std::array<Ogre::Real, 4 * 4> matrixArray { 0 };
-		internal_utils::container_double_to_real(node.matrix, matrixArray);
-		Ogre::Matrix4 matrix { matrixArray.data() };
-		Ogre::Vector3 position;
-		Ogre::Quaternion orientation;
-		Ogre::Vector3 scale;
-		matrix.transpose().decomposition(position, scale, orientation);
-		sceneNode->setPosition(position);
-		sceneNode->setOrientation(orientation);
-		sceneNode->setScale(scale);
+		accessors.readFloats(translationAccessor, translations);
+		instanceCount = translations.size() / 3;
+	}
+	if(rotationAccessor >= 0)
+	{
+		accessors.readFloats(rotationAccessor, rotations);
+		instanceCount = rotations.size() / 4;
+	}
+	if(scaleAccessor >= 0)
+	{
+		accessors.readFloats(scaleAccessor, scales);
+		instanceCount = scales.size() / 3;
 	}
 
-	if(node.mesh >= 0)
+	if((!translations.empty() && translations.size() != instanceCount * 3) || (!rotations.empty() && rotations.size() != instanceCount * 4)
+	   || (!scales.empty() && scales.size() != instanceCount * 3))
+		throw LoadingError("EXT_mesh_gpu_instancing attributes of node " + node.name + " don't have the same number of elements");
+
+	std::vector<Ogre::Vector3> positions(instanceCount, Ogre::Vector3::ZERO);
+	std::vector<Ogre::Matrix4> transforms(instanceCount);
+	for(size_t i = 0; i < instanceCount; ++i)
 	{
-		auto ogreMesh = pimpl->modelConv.getOgreMesh(node.mesh);
+		Ogre::Quaternion orientation;
+		Ogre::Vector3 scale { Ogre::Vector3::UNIT_SCALE };
+		if(!translations.empty()) positions[i] = Ogre::Vector3 { &translations[i * 3] };
+		if(!rotations.empty()) orientation = Ogre::Quaternion { rotations[i * 4 + 3], rotations[i * 4 + 0], rotations[i * 4 + 1], rotations[i * 4 + 2] };
+		if(!scales.empty()) scale = Ogre::Vector3 { &scales[i * 3] };
+		orientation.normalise();
+		transforms[i].makeTransform(positions[i], scale, orientation);
+	}
+
+	statistics.instanceCount += instanceCount;
+	statistics.instanceMemory += (translations.size() + rotations.size() + scales.size()) * sizeof(float);
+
+	const auto& mesh			 = model.meshes[node.mesh];
+	const auto vertexCount		 = modelConv.getVertexCount(node.mesh);
+	const auto canBeBaked		 = node.skin < 0 && modelConv.isBakeable(node.mesh) && vertexCount <= options.instanceBakingVertexLimit;
+	const auto instancesPerBatch = vertexCount > 0 ? std::max<size_t>(1, options.instanceBatchVertexBudget / vertexCount) : instanceCount;
 
+	if(!canBeBaked)
+	{
+		//Big or skinned meshes are not worth merging : create the smallest scene objects we can for each instance.
+		//Ogre will still automatically instance the draw calls of these Items as they share the same mesh and datablocks
+		auto ogreMesh = modelConv.getOgreMesh(node.mesh);
 		if(node.skin >= 0)
 		{
-			auto skeleton = this->pimpl->skeletonImp.getSkeleton(node.skin);
-			if(skeleton)
-			{
-				ogreMesh->_notifySkeleton(skeleton);
-			}
+			auto skeleton = skeletonImp.getSkeleton(node.skin);
+			if(skeleton) ogreMesh->_notifySkeleton(skeleton);
 		}
 
-		auto item = smgr->createItem(ogreMesh);
-		const auto& mesh = pimpl->model.meshes[node.mesh];
-		for(size_t i = 0; i < mesh.primitives.size(); ++i) 
-		{ 
-			auto subItem = item->getSubItem(i);
-			subItem->setDatablock(getDatablock(mesh.primitives[i].material));
+		for(size_t i = 0; i < instanceCount; ++i)
+		{
+			Ogre::Vector3 position, scale;
+			Ogre::Quaternion orientation;
+			transforms[i].decomposition(position, scale, orientation);
+
+			auto instanceNode = sceneNode->createChildSceneNode(Ogre::SCENE_DYNAMIC, position, orientation);
+			instanceNode->setScale(scale);
+			auto item = smgr->createItem(ogreMesh);
+			for(size_t p = 0; p < mesh.primitives.size(); ++p) item->getSubItem(p)->setDatablock(materialLoad.getDatablock(mesh.primitives[p].material));
+			instanceNode->attachObject(item);
+		}
+
+		statistics.instanceBatchCount += instanceCount;
+		statistics.instanceMemory += instanceCount * (sizeof(Ogre::SceneNode) + sizeof(Ogre::Item));
+		return true;
+	}
+
+	//Small static meshes : bake spatially close instances together so that each batch stays cullable
+	const auto order = getSpatialOrder(positions);
+	for(size_t first = 0; first < instanceCount; first += instancesPerBatch)
+	{
+		//Batches only depend on the file content and on the batch size, so they can be shared by every load of the same file
+		const auto batchName = "glTF_instances_" + sourceHash + "_" + std::to_string(nodeIndex) + "_" + std::to_string(instancesPerBatch) + "_"
+							   + std::to_string(first / instancesPerBatch);
+		auto ogreMesh = modelConv.findMesh(batchName);
+		if(!ogreMesh)
+		{
+			const auto last = std::min(instanceCount, first + instancesPerBatch);
+			std::vector<std::vector<bakedPrimitive>> subMeshes(mesh.primitives.size());
+			for(size_t p = 0; p < mesh.primitives.size(); ++p)
+				for(size_t i = first; i < last; ++i) subMeshes[p].push_back({ size_t(node.mesh), p, transforms[order[i]] });
+			ogreMesh = modelConv.createBakedMesh(batchName, subMeshes);
 		}
+
+		auto item = smgr->createItem(ogreMesh);
+		for(size_t p = 0; p < mesh.primitives.size(); ++p) item->getSubItem(p)->setDatablock(materialLoad.getDatablock(mesh.primitives[p].material));
 		sceneNode->attachObject(item);
 
-		// Add tag points
-		auto skeletonInstance = item->getSkeletonInstance();
-		if(skeletonInstance)
+		for(unsigned s = 0; s < ogreMesh->getNumSubMeshes(); ++s)
+		{
+			const auto vao = ogreMesh->getSubMesh(s)->mVao[Ogre::VpNormal].front();
+			for(const auto vertexBuffer : vao->getVertexBuffers()) statistics.instanceMemory += vertexBuffer->getTotalSizeBytes();
+			statistics.instanceMemory += vao->getIndexBuffer()->getTotalSizeBytes();
+		}
+		++statistics.instanceBatchCount;
+	}
+
+	return true;
+}
+
+std::vector<Ogre::uint8> loaderAdapter::impl::mergeStaticGeometry(const tinygltf::Scene& scene, Ogre::SceneNode* parentNode, Ogre::SceneManager* smgr)
+{
+	const auto& order = sceneGraph.getTopologicalOrder();
+	std::vector<Ogre::uint8> mergedNodes(model.nodes.size(), 0);
+
+	//A node is dynamic if an animation moves it or one of its ancestors, or if it is part of a skeleton
+	std::vector<bool> dynamic(model.nodes.size(), false);
+	for(const auto& animation : model.animations)
+		for(const auto& channel : animation.channels)
+			if(channel.target_node >= 0) dynamic[channel.target_node] = true;
+
+	//Parents come first in the topological order : world transforms and dynamic flags propagate down in a single pass
+	std::vector<Ogre::Matrix4> worldTransforms(model.nodes.size(), Ogre::Matrix4::IDENTITY);
+	for(const auto nodeIdx : order)
+	{
+		const auto parent = sceneGraph.getParent(size_t(nodeIdx));
+		dynamic[nodeIdx]  = dynamic[nodeIdx] || sceneGraph.isJoint(size_t(nodeIdx)) || (parent >= 0 && dynamic[parent]);
+
+		Ogre::Vector3 position, scale;
+		Ogre::Quaternion orientation;
+		getNodeTransform(model.nodes[nodeIdx], position, orientation, scale);
+		worldTransforms[nodeIdx].makeTransform(position, scale, orientation);
+		if(parent >= 0) worldTransforms[nodeIdx] = worldTransforms[parent] * worldTransforms[nodeIdx];
+	}
+
+	//Gather the primitives of the static nodes of the scene, by material and vertex format
+	struct clusterPrimitive
+	{
+		bakedPrimitive primitive;
+		Ogre::Vector3 center;
+		size_t vertexCount;
+	};
+	std::map<std::pair<int, std::string>, std::vector<clusterPrimitive>> groups;
+	for(const auto root : scene.nodes)
+	{
+		const auto first = sceneGraph.getOrderPosition(size_t(root));
+		for(size_t i = first; i < first + sceneGraph.getSubtreeSize(size_t(root)); ++i)
+		{
+			const auto nodeIdx = size_t(order[i]);
+			const auto& node   = model.nodes[nodeIdx];
+			if(dynamic[nodeIdx] || node.mesh < 0 || node.skin >= 0 || !modelConv.isBakeable(size_t(node.mesh)) || needsOwnItem(nodeIdx)) continue;
+
+			mergedNodes[nodeIdx] = 1;
+			const auto& bounds	 = modelConv.getSubMeshBounds(size_t(node.mesh));
+			const auto& mesh	 = model.meshes[node.mesh];
+			for(size_t p = 0; p < mesh.primitives.size(); ++p)
+			{
+				std::string vertexFormat;
+				for(const auto& attribute : mesh.primitives[p].attributes) vertexFormat += attribute.first + ";";
+				groups[{ mesh.primitives[p].material, vertexFormat }].push_back({ { size_t(node.mesh), p, worldTransforms[nodeIdx] },
+																				 worldTransforms[nodeIdx].transformAffine(bounds[p].box.mCenter),
+																				 model.accessors[mesh.primitives[p].attributes.at("POSITION")].count });
+			}
+		}
+	}
+
+	//Nodes without anything left to create don't need a scene node at all. Children come after their parent, so walk backward
+	for(auto node = order.rbegin(); node != order.rend(); ++node)
+	{
+		const auto& children = model.nodes[*node].children;
+		const auto empty	 = mergedNodes[*node] == 1 || (model.nodes[*node].mesh < 0 && !dynamic[*node]);
+		if(empty && std::all_of(children.begin(), children.end(), [&](int child) { return mergedNodes[child] == 2; })) mergedNodes[*node] = 2;
+	}
+
+	//Cut each group in clusters of spatially close primitives, one Item per cluster so that culling still works
+	size_t groupIdx { 0 };
+	for(const auto& group : groups)
+	{
+		std::vector<Ogre::Vector3> centers;
+		for(const auto& primitive : group.second) centers.push_back(primitive.center);
+		const auto spatialOrder = getSpatialOrder(centers);
+
+		std::vector<std::vector<bakedPrimitive>> clusters(1);
+		size_t clusterVertexCount { 0 };
+		for(const auto index : spatialOrder)
 		{
-			// Find all root bones. Collect all children of all nodes in the skin and then find
-			// all nodes in the skin that are not in the set of children. Those are all nodes
-			// that don't have a parent because they're not a child of any other node. 
-			std::vector<int> rootBones;
-			std::vector<int> allChildren;
-			const auto& skin = pimpl->model.skins[node.skin];
-
-			for(const auto& nodeIndex : skin.joints)
+			const auto& primitive = group.second[index];
+			if(!clusters.back().empty() && clusterVertexCount + primitive.vertexCount > options.mergedClusterVertexBudget)
 			{
-				const auto& node = pimpl->model.nodes[nodeIndex];
-				allChildren.insert(allChildren.end(), node.children.begin(), node.children.end());
+				clusters.emplace_back();
+				clusterVertexCount = 0;
 			}
+			clusters.back().push_back(primitive.primitive);
+			clusterVertexCount += primitive.vertexCount;
+		}
+
+		for(size_t cluster = 0; cluster < clusters.size(); ++cluster)
+		{
+			//Clusters only depend on the file content and on the budget, so they can be shared by every load of the same file
+			const auto clusterName = "glTF_static_" + sourceHash + "_" + std::to_string(groupIdx) + "_" + std::to_string(options.mergedClusterVertexBudget)
+									 + "_" + std::to_string(cluster);
+			auto ogreMesh = modelConv.findMesh(clusterName);
+			if(!ogreMesh) ogreMesh = modelConv.createBakedMesh(clusterName, { clusters[cluster] });
+
+			auto item = smgr->createItem(ogreMesh);
+			item->getSubItem(0)->setDatablock(materialLoad.getDatablock(group.first.first));
+			parentNode->attachObject(item);
+			statistics.mergedPrimitiveCount += clusters[cluster].size();
+			++statistics.mergedItemCount;
+		}
+		++groupIdx;
+	}
+
+	OgreLog("Merged " + std::to_string(statistics.mergedPrimitiveCount) + " static primitives into " + std::to_string(statistics.mergedItemCount) + " items");
+	return mergedNodes;
+}
 
-			for(const auto& nodeIndex : skin.joints)
+bool loaderAdapter::impl::needsOwnItem(size_t nodeIndex)
+{
+	const auto& node = model.nodes[nodeIndex];
+	return morphImp.isMorphable(node.mesh) || internal_utils::findExtension(node.extensions, "EXT_mesh_gpu_instancing");
+}
+
+Ogre::Item* loaderAdapter::impl::createItem(size_t nodeIndex, Ogre::SceneNode* sceneNode, Ogre::SceneManager* smgr)
+{
+	if(createInstances(nodeIndex, sceneNode, smgr)) return nullptr;
+	const auto& node = model.nodes[nodeIndex];
+
+	//Morphed items need their own vertex buffers, and so their own mesh
+	Ogre::MeshPtr ogreMesh;
+	std::vector<Ogre::VertexBufferPacked*> morphedBuffers;
+	const auto morphable = morphImp.isMorphable(node.mesh);
+	if(morphable)
+		ogreMesh = modelConv.createMorphableMesh(node.mesh, modelConv.getMeshName(node.mesh) + "_morph_" + std::to_string(morphedMeshCount++), morphedBuffers);
+	else
+		ogreMesh = modelConv.getOgreMesh(node.mesh);
+
+	if(node.skin >= 0)
+	{
+		auto skeleton = skeletonImp.getSkeleton(node.skin);
+		if(skeleton)
+		{
+			ogreMesh->_notifySkeleton(skeleton);
+		}
+	}
+
+	auto item		 = smgr->createItem(ogreMesh);
+	const auto& mesh = model.meshes[node.mesh];
+	for(size_t i = 0; i < mesh.primitives.size(); ++i)
+	{
+		auto subItem = item->getSubItem(i);
+		subItem->setDatablock(materialLoad.getDatablock(mesh.primitives[i].material));
+	}
+	sceneNode->attachObject(item);
+	if(morphable) createMorphController(nodeIndex, item, std::move(morphedBuffers));
+
+	return item;
+}
+
+void loaderAdapter::impl::compileBlueprint()
+{
+	blueprint = std::make_unique<sceneBlueprint>();
+	auto& nodes = blueprint->nodes;
+	if(model.scenes.empty()) return;
+	const auto& scene = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0];
+
+	//Same walk as getSceneNode and createTagPoints, but everything that doesn't depend on the instance is resolved once and written
+	//down in a flat array. Tag points come after the node that own their skeleton, and their children after them
+	struct pendingNode
+	{
+		int gltfNode;
+		int parent;
+		int skeletonOwner;
+		std::string boneName;
+	};
+	std::vector<pendingNode> pending;
+	for(auto root = scene.nodes.rbegin(); root != scene.nodes.rend(); ++root) pending.push_back({ *root, -1, -1, {} });
+
+	while(!pending.empty())
+	{
+		auto current = std::move(pending.back());
+		pending.pop_back();
+
+		//Bones are not scene nodes, but meshes attached to them are tag points
+		if(current.skeletonOwner < 0 && sceneGraph.isJoint(size_t(current.gltfNode))) continue;
+
+		const auto& gltfNode = model.nodes[current.gltfNode];
+		const auto index	 = int(nodes.size());
+		blueprintNode node;
+		node.parent		   = current.parent;
+		node.gltfNode	   = size_t(current.gltfNode);
+		node.name		   = gltfNode.name;
+		node.skeletonOwner = current.skeletonOwner;
+		node.boneName	   = std::move(current.boneName);
+		getNodeTransform(gltfNode, node.position, node.orientation, node.scale);
+
+		if(gltfNode.mesh >= 0)
+		{
+			//Tag points always use the shared mesh, like createTagPoints does
+			node.ownItem = current.skeletonOwner < 0 && needsOwnItem(node.gltfNode);
+			if(!node.ownItem)
 			{
-				if(std::find(allChildren.begin(), allChildren.end(), nodeIndex) == allChildren.end()) {
-					rootBones.push_back(nodeIndex);
+				node.mesh = modelConv.getOgreMesh(gltfNode.mesh);
+				if(gltfNode.skin >= 0)
+				{
+					auto skeleton = skeletonImp.getSkeleton(gltfNode.skin);
+					if(skeleton) node.mesh->_notifySkeleton(skeleton);
 				}
+				for(const auto& primitive : model.meshes[gltfNode.mesh].primitives) node.datablocks.push_back(materialLoad.getDatablock(primitive.material));
 			}
+		}
+
+		const auto& children = gltfNode.children;
+		for(auto child = children.rbegin(); child != children.rend(); ++child) pending.push_back({ *child, index, -1, {} });
 
-			for(int boneIndex : rootBones)
+		//The nodes holding meshes under the bones of the skin become tag points of the skeleton instance of this item
+		if(current.skeletonOwner < 0 && gltfNode.mesh >= 0 && gltfNode.skin >= 0)
+		{
+			std::vector<int> bones(sceneGraph.getSkinRoots(size_t(gltfNode.skin)));
+			while(!bones.empty())
 			{
-				createTagPoints(boneIndex, skeletonInstance, smgr);
+				const auto& boneNode = model.nodes[bones.back()];
+				bones.pop_back();
+				for(const auto child : boneNode.children)
+				{
+					if(model.nodes[child].mesh >= 0)
+						pending.push_back({ child, -1, index, boneNode.name });
+					else
+						bones.push_back(child);
+				}
 			}
 		}
+
+		nodes.push_back(std::move(node));
 	}
 
-	for(const auto& child : node.children)
+	OgreLog("Compiled scene blueprint with " + std::to_string(nodes.size()) + " nodes");
+}
+
+loaderAdapter::loaderAdapter() : pimpl { std::make_unique<impl>() } { OgreLog("Created adapter object..."); }
+
+loaderAdapter::~loaderAdapter() { OgreLog("Destructed adapter object..."); }
+
+void loaderAdapter::loadMainScene(Ogre::SceneNode* parentNode, Ogre::SceneManager* smgr) const
+{
+	if(!isOk())
+		return;
+
+	pimpl->textureImp.loadTextures();
+	auto sceneIdx = pimpl->model.defaultScene >= 0 ? pimpl->model.defaultScene : 0;
+	const auto& scene = pimpl->model.scenes[sceneIdx];
+
+	std::vector<Ogre::uint8> mergedNodes;
+	if(pimpl->options.mergeStaticGeometry) mergedNodes = pimpl->mergeStaticGeometry(scene, parentNode, smgr);
+
+	for(auto nodeIdx : scene.nodes)
 	{
-		getSceneNode(child, sceneNode, smgr);
+		createSubtree(nodeIdx, parentNode, smgr, mergedNodes.empty() ? nullptr : mergedNodes.data());
 	}
-
-	return sceneNode;
 }
 
-void loaderAdapter::createTagPoints(int boneIndex, Ogre::SkeletonInstance* skeletonInstance, Ogre::SceneManager* smgr) const
+Ogre::SceneNode* loaderAdapter::getFirstSceneNode(Ogre::SceneManager* smgr) const
 {
-	const auto& boneNode = pimpl->model.nodes[boneIndex];
+	if(!isOk())
+		return nullptr;
+	
+	pimpl->textureImp.loadTextures();
+	return getSceneNode(pimpl->model.scenes[0].nodes[0], smgr->getRootSceneNode(), smgr);
+}
 
-	for(auto child : boneNode.children)
+const sceneBlueprint& loaderAdapter::getBlueprint() const
+{
+	if(!pimpl->blueprint)
 	{
-		const auto& childNode = pimpl->model.nodes[child];
+		pimpl->textureImp.loadTextures();
+		pimpl->compileBlueprint();
+	}
+	return *pimpl->blueprint;
+}
 
-		if(childNode.mesh >= 0)
+Ogre::SceneNode* loaderAdapter::instantiate(Ogre::SceneNode* parentNode, Ogre::SceneManager* smgr) const
+{
+	if(!isOk())
+		return nullptr;
+
+	const auto& nodes = getBlueprint().nodes;
+	auto instanceRoot = parentNode->createChildSceneNode();
+	std::vector<Ogre::SceneNode*> sceneNodes(nodes.size(), nullptr);
+	std::vector<Ogre::Item*> items(nodes.size(), nullptr);
+
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		const auto& node = nodes[i];
+		Ogre::SceneNode* sceneNode;
+		if(node.skeletonOwner >= 0)
 		{
+			const auto skeletonInstance = items[node.skeletonOwner] ? items[node.skeletonOwner]->getSkeletonInstance() : nullptr;
+			if(!skeletonInstance) continue;
 			auto tagPoint = smgr->createTagPoint();
-			tagPoint->setName(childNode.name);
+			tagPoint->setPosition(node.position);
+			tagPoint->setOrientation(node.orientation);
+			skeletonInstance->getBone(node.boneName)->addTagPoint(tagPoint);
+			sceneNode = tagPoint;
+		}
+		else
+		{
+			const auto parent = node.parent < 0 ? instanceRoot : sceneNodes[node.parent];
+			if(!parent) continue;
+			sceneNode = parent->createChildSceneNode(Ogre::SCENE_DYNAMIC, node.position, node.orientation);
+		}
+		sceneNode->setName(node.name);
+		sceneNode->setScale(node.scale);
+		sceneNodes[i] = sceneNode;
 
-			Ogre::Vector3 position;
-			Ogre::Quaternion orientation;
-			Ogre::Vector3 scale(1);
-			
-			if(!childNode.translation.empty())
-				position = Ogre::Vector3(childNode.translation[0], childNode.translation[1], childNode.translation[2]);
+		if(node.ownItem)
+			items[i] = pimpl->createItem(node.gltfNode, sceneNode, smgr);
+		else if(node.mesh)
+		{
+			items[i] = smgr->createItem(node.mesh);
+			for(size_t subItem = 0; subItem < node.datablocks.size(); ++subItem) items[i]->getSubItem(subItem)->setDatablock(node.datablocks[subItem]);
+			sceneNode->attachObject(items[i]);
+		}
+	}
 
-			if(!childNode.rotation.empty())
-				orientation = Ogre::Quaternion(childNode.rotation[3], childNode.rotation[0], childNode.rotation[1], childNode.rotation[2]);
+	return instanceRoot;
+}
 
-			if(!childNode.scale.empty())
-				scale = Ogre::Vector3(childNode.scale[0], childNode.scale[1], childNode.scale[2]);
+Ogre::SceneNode* loaderAdapter::getSceneNode(size_t index, Ogre::SceneNode* parentSceneNode, Ogre::SceneManager* smgr) const
+{
+	return createSubtree(index, parentSceneNode, smgr, nullptr);
+}
 
-			if(!childNode.matrix.empty())
-			{
-				std::array<Ogre::Real, 4 * 4> matrixArray { 0 };
-				internal_utils::container_double_to_real(childNode.matrix, matrixArray);
-				Ogre::Matrix4 matrix { matrixArray.data() };
-				matrix.transpose().decomposition(position, scale, orientation);
-			}
+Ogre::SceneNode* loaderAdapter::createSubtree(size_t index, Ogre::SceneNode* parentSceneNode, Ogre::SceneManager* smgr, const Ogre::uint8* mergedNodes) const
+{
+	assert(index < pimpl->model.nodes.size());
+	auto& sceneGraph = pimpl->sceneGraph;
+
+	//The subtree of the node is a contiguous range of the topological order, where parents come before their children : walk it
+	//instead of recursing. Bones are not scene nodes, nothing is created for them nor for their children (see createTagPoints)
+	const auto& order = sceneGraph.getTopologicalOrder();
+	const auto first  = sceneGraph.getOrderPosition(index);
+	std::vector<Ogre::SceneNode*> sceneNodes(sceneGraph.getSubtreeSize(index), nullptr);
+	for(size_t i = 0; i < sceneNodes.size(); ++i)
+	{
+		const auto nodeIndex = size_t(order[first + i]);
+		const auto parent	 = i == 0 ? parentSceneNode : sceneNodes[sceneGraph.getOrderPosition(size_t(sceneGraph.getParent(nodeIndex))) - first];
+		const auto merged	 = mergedNodes ? mergedNodes[nodeIndex] : 0;
+		if(parent && merged != 2 && !sceneGraph.isJoint(nodeIndex)) sceneNodes[i] = createSceneNode(nodeIndex, parent, smgr, merged == 0);
+	}
+
+	return sceneNodes.front();
+}
+
+Ogre::SceneNode* loaderAdapter::createSceneNode(size_t index, Ogre::SceneNode* parentSceneNode, Ogre::SceneManager* smgr, bool withItem) const
+{
+	const auto& node = pimpl->model.nodes[index];
+	Ogre::Vector3 position, scale;
+	Ogre::Quaternion orientation;
+	getNodeTransform(node, position, orientation, scale);
+
+	auto sceneNode = parentSceneNode->createChildSceneNode(Ogre::SCENE_DYNAMIC, position, orientation);
+	sceneNode->setName(node.name);
+	sceneNode->setScale(scale);
 
-			tagPoint->setPosition(position);
-			tagPoint->setOrientation(orientation);
-			tagPoint->setScale(scale);
+	if(node.mesh < 0 || !withItem) return sceneNode;
+	const auto item = pimpl->createItem(index, sceneNode, smgr);
 
-			auto ogreMesh = pimpl->modelConv.getOgreMesh(childNode.mesh);
+	// Add tag points
+	auto skeletonInstance = item ? item->getSkeletonInstance() : nullptr;
+	if(skeletonInstance)
+	{
+		// Root bones are the joints of the skin that don't have a parent in the skin
+		for(int boneIndex : pimpl->sceneGraph.getSkinRoots(node.skin))
+		{
+			createTagPoints(boneIndex, skeletonInstance, smgr);
+		}
+	}
 
-			if(childNode.skin >= 0)
+	return sceneNode;
+}
+
+void loaderAdapter::createTagPoints(int boneIndex, Ogre::SkeletonInstance* skeletonInstance, Ogre::SceneManager* smgr) const
+{
+	//Walk the bone hierarchy with an explicit stack. Meshes attached to bones become tag points, and end the walk
+	std::vector<int> bones { boneIndex };
+	while(!bones.empty())
+	{
+		const auto& boneNode = pimpl->model.nodes[bones.back()];
+		bones.pop_back();
+
+		for(auto child : boneNode.children)
+		{
+			const auto& childNode = pimpl->model.nodes[child];
+
+			if(childNode.mesh >= 0)
 			{
-				auto skeleton = this->pimpl->skeletonImp.getSkeleton(childNode.skin);
-				if(skeleton)
+				auto tagPoint = smgr->createTagPoint();
+				tagPoint->setName(childNode.name);
+
+				Ogre::Vector3 position, scale;
+				Ogre::Quaternion orientation;
+				getNodeTransform(childNode, position, orientation, scale);
+
+				tagPoint->setPosition(position);
+				tagPoint->setOrientation(orientation);
+				tagPoint->setScale(scale);
+
+				auto ogreMesh = pimpl->modelConv.getOgreMesh(childNode.mesh);
+
+				if(childNode.skin >= 0)
 				{
-					ogreMesh->_notifySkeleton(skeleton);
+					auto skeleton = this->pimpl->skeletonImp.getSkeleton(childNode.skin);
+					if(skeleton)
+					{
+						ogreMesh->_notifySkeleton(skeleton);
+					}
 				}
-			}
 
-			auto item = smgr->createItem(ogreMesh);
-			const auto& mesh = pimpl->model.meshes[childNode.mesh];
-			for(size_t i = 0; i < mesh.primitives.size(); ++i) 
-			{ 
-				auto subItem = item->getSubItem(i);
-				subItem->setDatablock(getDatablock(mesh.primitives[i].material));
-			}
-			tagPoint->attachObject(item);
+				auto item = smgr->createItem(ogreMesh);
+				const auto& mesh = pimpl->model.meshes[childNode.mesh];
+				for(size_t i = 0; i < mesh.primitives.size(); ++i) 
+				{ 
+					auto subItem = item->getSubItem(i);
+					subItem->setDatablock(getDatablock(mesh.primitives[i].material));
+				}
+				tagPoint->attachObject(item);
 
-			auto parentBone = skeletonInstance->getBone(boneNode.name);
-			parentBone->addTagPoint(tagPoint);
+				auto parentBone = skeletonInstance->getBone(boneNode.name);
+				parentBone->addTagPoint(tagPoint);
 
-			for(const auto& childOfChild : childNode.children)
+				for(const auto& childOfChild : childNode.children)
+				{
+					getSceneNode(childOfChild, tagPoint, smgr);
+				}
+			}
+			else
 			{
-				getSceneNode(childOfChild, tagPoint, smgr);
+				bones.push_back(child);
 			}
 		}
-		else
-		{
-			createTagPoints(child, skeletonInstance, smgr);
-		}
 	}
 }
 
@@ -275,6 +785,16 @@ bool loaderAdapter::isOk() const { return pimpl->valid; }
 
 std::string loaderAdapter::getLastError() const { return pimpl->error; }
 
+importOptions& loaderAdapter::getImportOptions() { return pimpl->options; }
+
+const loadStatistics& loaderAdapter::getLoadStatistics() const { return pimpl->statistics; }
+
+materialReport loaderAdapter::getMaterialReport() const { return pimpl->materialLoad.getReport(); }
+
+std::vector<subMeshBounds> loaderAdapter::getSubMeshBounds(size_t meshIndex) const { return pimpl->modelConv.getSubMeshBounds(meshIndex); }
+
+const std::vector<std::shared_ptr<morphController>>& loaderAdapter::getMorphControllers() const { return pimpl->morphControllers; }
+
 ///Implementation of the glTF loader. Exist as a pImpl inside the glTFLoader class
 struct glTFLoader::glTFLoaderImpl
 {
@@ -282,7 +802,56 @@ struct glTFLoader::glTFLoaderImpl
 	tinygltf::TinyGLTF loader;
 
 	///Constructor. the loader is on the stack, there isn't much state to set inside the object
-	glTFLoaderImpl() { OgreLog("initialized TinyGLTF loader"); }
+	glTFLoaderImpl()
+	{
+		loader.SetImageLoader(loadImageData, nullptr);
+		OgreLog("initialized TinyGLTF loader");
+	}
+
+	///Image loader given to tinygltf. Images are kept encoded, as they are in the file, with component set to 0 : the textureImporter
+	///decodes them only if the textures made from them are not already loaded, and transcodes the KTX2 files (KHR_texture_basisu). Only
+	///the header of the other images is read by stb here, images it can't read are given to tinygltf to report the error
+	static bool loadImageData(tinygltf::Image* image,
+							  const int imageIndex,
+							  std::string* error,
+							  std::string* warning,
+							  int requestedWidth,
+							  int requestedHeight,
+							  const unsigned char* bytes,
+							  int size,
+							  void* userData)
+	{
+		if(!ktx2Image::isKtx2(bytes, size_t(size)))
+		{
+			int width, height, channels;
+			if(!stbi_info_from_memory(bytes, size, &width, &height, &channels))
+				return tinygltf::LoadImageData(image, imageIndex, error, warning, requestedWidth, requestedHeight, bytes, size, userData);
+
+			image->width	 = width;
+			image->height	 = height;
+			image->component = 0;
+			image->bits		 = 8;
+			image->image.assign(bytes, bytes + size);
+			return true;
+		}
+
+		try
+		{
+			const ktx2Image ktx2 { bytes, size_t(size) };
+			image->width	 = int(ktx2.getWidth());
+			image->height	 = int(ktx2.getHeight());
+			image->component = 0;
+			image->bits		 = 8;
+			image->image.assign(bytes, bytes + size);
+			if(image->mimeType.empty()) image->mimeType = "image/ktx2";
+			return true;
+		}
+		catch(const LoadingError& e)
+		{
+			if(error) *error += "Image " + std::to_string(imageIndex) + ": " + e.what() + "\n";
+			return false;
+		}
+	}
 
 	///For file type detection. Ascii is plain old JSON text, Binary is .glc files.
 	enum class FileType { Ascii, Binary, Unknown };
@@ -315,24 +884,61 @@ struct glTFLoader::glTFLoaderImpl
 		return FileType::Unknown;
 	}
 
+	///Read the whole content of a file in memory
+	static std::vector<unsigned char> readFile(const std::string& path)
+	{
+		std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+		if(!file) throw FileIOError("Could not open " + path);
+
+		std::vector<unsigned char> content(size_t(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(content.data()), std::streamsize(content.size()));
+		return content;
+	}
+
 	///Load the content of a file into an adapter object
 	bool loadInto(loaderAdapter& adapter, const std::string& path)
 	{
-		switch(detectType(path))
+		const auto type = detectType(path);
+		if(type == FileType::Unknown) return false;
+
+		//The file is read here, and not by tinygltf, so that we can identify its content
+		const auto content = readFile(path);
+		const auto baseDir = path.find_last_of("/\\") != std::string::npos ? path.substr(0, path.find_last_of("/\\")) : std::string {};
+		auto hash		   = internal_utils::hashBytes(content.data(), content.size());
+
+		bool loaded { false };
+		if(type == FileType::Ascii)
 		{
-			default:
-			case FileType::Unknown: return false;
-			case FileType::Ascii:
-				//OgreLog("Detected ascii file type");
-				return loader.LoadASCIIFromFile(&adapter.pimpl->model, &adapter.pimpl->error, &adapter.pimpl->warnings, path);
-			case FileType::Binary:
-				//OgreLog("Deteted binary file type");
-				return loader.LoadBinaryFromFile(&adapter.pimpl->model, &adapter.pimpl->error, &adapter.pimpl->warnings, path);
+			//OgreLog("Detected ascii file type");
+			loaded = loader.LoadASCIIFromString(&adapter.pimpl->model,
+												&adapter.pimpl->error,
+												&adapter.pimpl->warnings,
+												reinterpret_cast<const char*>(content.data()),
+												static_cast<unsigned int>(content.size()),
+												baseDir);
+
+			//External buffers are part of the content of the asset too
+			for(const auto& buffer : adapter.pimpl->model.buffers) hash = internal_utils::hashBytes(buffer.data.data(), buffer.data.size(), hash);
 		}
+		else
+		{
+			//OgreLog("Deteted binary file type");
+			loaded = loader.LoadBinaryFromMemory(&adapter.pimpl->model,
+												 &adapter.pimpl->error,
+												 &adapter.pimpl->warnings,
+												 content.data(),
+												 static_cast<unsigned int>(content.size()),
+												 baseDir);
+		}
+
+		adapter.pimpl->setSourceHash(hash);
+		return loaded;
 	}
 
 	bool loadGlb(loaderAdapter& adapter, GlbFilePtr file)
 	{
+		adapter.pimpl->setSourceHash(internal_utils::hashBytes(file->getData(), file->getSize()));
 		return loader.LoadBinaryFromMemory(
 			&adapter.pimpl->model, &adapter.pimpl->error, &adapter.pimpl->warnings, file->getData(), int(file->getSize()), ".", 0);
 	}
@@ -0,0 +1,238 @@
+#include "Ogre_glTF_accessorReader.hpp"
+#include "Ogre_glTF.hpp"
+#include "Ogre_glTF_simd.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace Ogre_glTF;
+
+namespace
+{
+#if Ogre_glTF_SIMD_SSE2
+	///Store 4 integers as scaled and clamped floats
+	inline void storeFloats(float* output, __m128i integers, __m128 scale, __m128 minimum)
+	{
+		_mm_storeu_ps(output, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(integers), scale), minimum));
+	}
+
+	///Convert the first values of a flat array of values of type T to floats with SSE2, several at a time. Types without a vectorized
+	///conversion don't convert any
+	/// \return number of values converted
+	template <typename T>
+	size_t convertValuesSse2(const unsigned char*, size_t, __m128, __m128, float*)
+	{
+		return 0;
+	}
+
+	template <>
+	size_t convertValuesSse2<double>(const unsigned char* source, size_t count, __m128, __m128, float* output)
+	{
+		size_t i { 0 };
+		for(; i + 4 <= count; i += 4)
+		{
+			const auto values = reinterpret_cast<const double*>(source) + i;
+			_mm_storeu_ps(output + i, _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(values)), _mm_cvtpd_ps(_mm_loadu_pd(values + 2))));
+		}
+		return i;
+	}
+
+	template <>
+	size_t convertValuesSse2<uint8_t>(const unsigned char* source, size_t count, __m128 scale, __m128 minimum, float* output)
+	{
+		const auto zero = _mm_setzero_si128();
+		size_t i { 0 };
+		for(; i + 16 <= count; i += 16)
+		{
+			const auto bytes	   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			const __m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+			for(size_t w { 0 }; w < 2; w++)
+			{
+				storeFloats(output + i + w * 8, _mm_unpacklo_epi16(words[w], zero), scale, minimum);
+				storeFloats(output + i + w * 8 + 4, _mm_unpackhi_epi16(words[w], zero), scale, minimum);
+			}
+		}
+		return i;
+	}
+
+	template <>
+	size_t convertValuesSse2<int8_t>(const unsigned char* source, size_t count, __m128 scale, __m128 minimum, float* output)
+	{
+		//Each byte is duplicated in a wider lane then shifted back down, which extends its sign
+		size_t i { 0 };
+		for(; i + 16 <= count; i += 16)
+		{
+			const auto bytes	   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			const __m128i words[2] = { _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8), _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8) };
+			for(size_t w { 0 }; w < 2; w++)
+			{
+				storeFloats(output + i + w * 8, _mm_srai_epi32(_mm_unpacklo_epi16(words[w], words[w]), 16), scale, minimum);
+				storeFloats(output + i + w * 8 + 4, _mm_srai_epi32(_mm_unpackhi_epi16(words[w], words[w]), 16), scale, minimum);
+			}
+		}
+		return i;
+	}
+
+	template <>
+	size_t convertValuesSse2<uint16_t>(const unsigned char* source, size_t count, __m128 scale, __m128 minimum, float* output)
+	{
+		const auto zero = _mm_setzero_si128();
+		size_t i { 0 };
+		for(; i + 8 <= count; i += 8)
+		{
+			const auto words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+			storeFloats(output + i, _mm_unpacklo_epi16(words, zero), scale, minimum);
+			storeFloats(output + i + 4, _mm_unpackhi_epi16(words, zero), scale, minimum);
+		}
+		return i;
+	}
+
+	template <>
+	size_t convertValuesSse2<int16_t>(const unsigned char* source, size_t count, __m128 scale, __m128 minimum, float* output)
+	{
+		size_t i { 0 };
+		for(; i + 8 <= count; i += 8)
+		{
+			const auto words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+			storeFloats(output + i, _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16), scale, minimum);
+			storeFloats(output + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16), scale, minimum);
+		}
+		return i;
+	}
+#endif
+
+	///Convert count elements of components values of type T to float
+	template <typename T>
+	void convertToFloats(const unsigned char* source, size_t byteStride, size_t count, size_t components, bool normalized, float* output)
+	{
+		//glTF 2.0 normalized integers : unsigned ones map to [0;1], signed ones map to [-1;1] and are clamped
+		const auto scale = normalized ? 1.0f / float((std::numeric_limits<T>::max)()) : 1.0f;
+
+		//Tightly packed elements are a flat array of values, the vectorized conversion handles most of them
+		if(byteStride == components * sizeof(T))
+		{
+			const auto valueCount = count * components;
+			size_t i { 0 };
+#if Ogre_glTF_SIMD_SSE2
+			const auto minimum = _mm_set1_ps(normalized ? -1.0f : -(std::numeric_limits<float>::max)());
+			i				   = convertValuesSse2<T>(source, valueCount, _mm_set1_ps(scale), minimum, output);
+#endif
+			for(; i < valueCount; ++i)
+			{
+				T value;
+				memcpy(&value, source + i * sizeof(T), sizeof(T));
+				const auto converted = float(value) * scale;
+				output[i]			 = normalized && converted < -1.0f ? -1.0f : converted;
+			}
+			return;
+		}
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			const auto element = source + i * byteStride;
+			for(size_t c = 0; c < components; ++c)
+			{
+				T value;
+				memcpy(&value, element + c * sizeof(T), sizeof(T));
+				const auto converted	   = float(value) * scale;
+				output[i * components + c] = normalized && converted < -1.0f ? -1.0f : converted;
+			}
+		}
+	}
+
+	///Copy the elements that have at least one non zero component
+	/// \param sourceIndices index of each element, or nullptr if the elements are all the elements of the accessor
+	void filterNonZero(const uint32_t* sourceIndices, const float* source, size_t count, size_t components, std::vector<uint32_t>& indices, std::vector<float>& values)
+	{
+		for(size_t i = 0; i < count; ++i)
+		{
+			const auto element = source + i * components;
+			if(std::all_of(element, element + components, [](float value) { return value == 0.0f; })) continue;
+			indices.push_back(sourceIndices ? sourceIndices[i] : uint32_t(i));
+			values.insert(values.end(), element, element + components);
+		}
+	}
+}
+
+accessorReader::accessorReader(tinygltf::Model& input, bufferViewDecoder& decoder) : model { input }, bufferViews { decoder } {}
+
+size_t accessorReader::getComponentCount(int type)
+{
+	switch(type)
+	{
+		case TINYGLTF_TYPE_SCALAR: return 1;
+		case TINYGLTF_TYPE_VEC2: return 2;
+		case TINYGLTF_TYPE_VEC3: return 3;
+		case TINYGLTF_TYPE_VEC4: return 4;
+		case TINYGLTF_TYPE_MAT2: return 4;
+		case TINYGLTF_TYPE_MAT3: return 9;
+		case TINYGLTF_TYPE_MAT4: return 16;
+		default: return 0;
+	}
+}
+
+void accessorReader::convert(const tinygltf::Accessor& accessor, const unsigned char* data, size_t byteStride, size_t count, float* output)
+{
+	const auto components = getComponentCount(accessor.type);
+	switch(accessor.componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_FLOAT:
+			if(byteStride == components * sizeof(float))
+				memcpy(output, data, count * components * sizeof(float));
+			else
+				convertToFloats<float>(data, byteStride, count, components, false, output);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_DOUBLE: convertToFloats<double>(data, byteStride, count, components, false, output); break;
+		case TINYGLTF_COMPONENT_TYPE_BYTE: convertToFloats<int8_t>(data, byteStride, count, components, accessor.normalized, output); break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: convertToFloats<uint8_t>(data, byteStride, count, components, accessor.normalized, output); break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT: convertToFloats<int16_t>(data, byteStride, count, components, accessor.normalized, output); break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: convertToFloats<uint16_t>(data, byteStride, count, components, accessor.normalized, output); break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: convertToFloats<uint32_t>(data, byteStride, count, components, accessor.normalized, output); break;
+		default: throw LoadingError("Unrecognized accessor component type");
+	}
+}
+
+void accessorReader::readFloats(int accessorIndex, std::vector<float>& output)
+{
+	const auto& accessor   = model.accessors[accessorIndex];
+	const auto components = getComponentCount(accessor.type);
+	output.resize(accessor.count * components);
+
+	//An accessor without bufferView is initialized with zeros
+	if(const auto base = bufferViews.getBaseData(accessor))
+		convert(accessor, base, bufferViews.getBaseByteStride(accessor), accessor.count, output.data());
+	else
+		std::fill(output.begin(), output.end(), 0.0f);
+
+	if(!accessor.sparse.isSparse) return;
+
+	//Convert the sparse values directly into their place in the output
+	const auto indices	   = bufferViews.getSparseIndices(accessor);
+	const auto values	   = bufferViews.getSparseValues(accessor);
+	const auto elementSize = bufferViewDecoder::getElementSize(accessor);
+	std::vector<float> converted(indices.size() * components);
+	convert(accessor, values, elementSize, indices.size(), converted.data());
+	for(size_t i = 0; i < indices.size(); ++i) memcpy(&output[indices[i] * components], &converted[i * components], components * sizeof(float));
+}
+
+void accessorReader::readNonZeroFloats(int accessorIndex, std::vector<uint32_t>& indices, std::vector<float>& values)
+{
+	const auto& accessor   = model.accessors[accessorIndex];
+	const auto components = getComponentCount(accessor.type);
+	indices.clear();
+	values.clear();
+
+	//Sparse values over a zero base are already what we want, don't expand them to the whole accessor
+	if(accessor.sparse.isSparse && accessor.bufferView < 0)
+	{
+		const auto sparseIndices = bufferViews.getSparseIndices(accessor);
+		std::vector<float> sparseValues(sparseIndices.size() * components);
+		convert(accessor, bufferViews.getSparseValues(accessor), bufferViewDecoder::getElementSize(accessor), sparseIndices.size(), sparseValues.data());
+		filterNonZero(sparseIndices.data(), sparseValues.data(), sparseIndices.size(), components, indices, values);
+		return;
+	}
+
+	std::vector<float> dense;
+	readFloats(accessorIndex, dense);
+	filterNonZero(nullptr, dense.data(), accessor.count, components, indices, values);
+}
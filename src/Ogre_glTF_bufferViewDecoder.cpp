@@ -0,0 +1,201 @@
+#include "Ogre_glTF_bufferViewDecoder.hpp"
+#include "Ogre_glTF_meshoptDecoder.hpp"
+#include "Ogre_glTF_internal_utils.hpp"
+#include "Ogre_glTF_common.hpp"
+#include "Ogre_glTF.hpp"
+#include <cstring>
+
+using namespace Ogre_glTF;
+
+namespace
+{
+	///Name of the extension, and of its KHR successor that use the exact same bitstream
+	const std::string meshoptExtensionNames[] = { "EXT_meshopt_compression", "KHR_meshopt_compression" };
+}
+
+bufferViewDecoder::bufferViewDecoder(tinygltf::Model& input) : model { input } {}
+
+const unsigned char* bufferViewDecoder::getRawData(const tinygltf::BufferView& bufferView) const
+{
+	const auto& buffer = model.buffers[bufferView.buffer];
+	if(buffer.data.size() < bufferView.byteOffset + bufferView.byteLength) return nullptr;
+	return buffer.data.data() + bufferView.byteOffset;
+}
+
+bool bufferViewDecoder::decode(const tinygltf::BufferView& bufferView, const tinygltf::Value& extension, std::vector<unsigned char>& output) const
+{
+	const auto sourceBuffer = static_cast<int>(internal_utils::getNumber(extension, "buffer", -1));
+	const auto byteOffset	= static_cast<size_t>(internal_utils::getNumber(extension, "byteOffset", 0));
+	const auto byteLength	= static_cast<size_t>(internal_utils::getNumber(extension, "byteLength", 0));
+	const auto byteStride	= static_cast<size_t>(internal_utils::getNumber(extension, "byteStride", 0));
+	const auto count		= static_cast<size_t>(internal_utils::getNumber(extension, "count", 0));
+	const auto mode			= internal_utils::getString(extension, "mode");
+	const auto filter		= internal_utils::getString(extension, "filter", "NONE");
+
+	if(sourceBuffer < 0 || sourceBuffer >= int(model.buffers.size())) return false;
+	const auto& source = model.buffers[sourceBuffer].data;
+	if(source.size() < byteOffset + byteLength) return false;
+
+	//Accessors are validated against the bufferView, so the decoded data must have exactly its length
+	if(count * byteStride != bufferView.byteLength) return false;
+
+	const auto compressed = source.data() + byteOffset;
+	output.resize(count * byteStride);
+
+	if(mode == "ATTRIBUTES")
+	{
+		if(!meshopt::decodeVertexBuffer(output.data(), count, byteStride, compressed, byteLength)) return false;
+
+		//Filters reject the element sizes they don't support, rather than leaving the data quantized
+		if(filter == "OCTAHEDRAL") return meshopt::decodeFilterOctahedral(output.data(), count, byteStride);
+		if(filter == "QUATERNION") return meshopt::decodeFilterQuaternion(output.data(), count, byteStride);
+		if(filter == "EXPONENTIAL") return meshopt::decodeFilterExponential(output.data(), count, byteStride);
+		return filter == "NONE";
+	}
+
+	if(mode == "TRIANGLES") return meshopt::decodeIndexBuffer(output.data(), count, byteStride, compressed, byteLength);
+	if(mode == "INDICES") return meshopt::decodeIndexSequence(output.data(), count, byteStride, compressed, byteLength);
+
+	return false;
+}
+
+const unsigned char* bufferViewDecoder::getData(int bufferViewIndex)
+{
+	const auto& bufferView = model.bufferViews[bufferViewIndex];
+
+	const tinygltf::Value* extension = nullptr;
+	std::string extensionName;
+	for(const auto& name : meshoptExtensionNames)
+	{
+		if((extension = internal_utils::findExtension(bufferView.extensions, name)) != nullptr)
+		{
+			extensionName = name;
+			break;
+		}
+	}
+
+	if(!extension) return getRawData(bufferView);
+
+	const auto decoded = decodedBufferViews.find(bufferViewIndex);
+	if(decoded != decodedBufferViews.end()) return decoded->second.data();
+
+	std::vector<unsigned char> output;
+	if(decode(bufferView, *extension, output))
+	{
+		OgreLog("Decoded " + extensionName + " bufferView " + std::to_string(bufferViewIndex) + " (" + std::to_string(output.size()) + " bytes)");
+		return decodedBufferViews.emplace(bufferViewIndex, std::move(output)).first->second.data();
+	}
+
+	//When the extension is optional, the bufferView itself point to uncompressed data the file provides as a fallback
+	const auto fallback = getRawData(bufferView);
+	if(!internal_utils::isExtensionRequired(model, extensionName) && fallback)
+	{
+		OgreLog("Couldn't decode " + extensionName + " bufferView " + std::to_string(bufferViewIndex) + ", using the fallback buffer instead");
+		return fallback;
+	}
+
+	throw LoadingError("Couldn't decode " + extensionName + " compressed bufferView " + std::to_string(bufferViewIndex));
+}
+
+const unsigned char* bufferViewDecoder::getAccessorData(const tinygltf::Accessor& accessor)
+{
+	if(!accessor.sparse.isSparse)
+	{
+		const auto data = getBaseData(accessor);
+		if(!data) throw LoadingError("Accessor point to a bufferView that has no data");
+		return data;
+	}
+
+	const auto resolved = resolvedSparseAccessors.find(&accessor);
+	if(resolved != resolvedSparseAccessors.end()) return resolved->second.data();
+
+	//Expand the base data (zeros if there is none) into a tightly packed copy, then put the sparse values over it
+	const auto elementSize = getElementSize(accessor);
+	std::vector<unsigned char> output(accessor.count * elementSize, 0);
+	if(const auto base = getBaseData(accessor))
+	{
+		const auto baseStride = getBaseByteStride(accessor);
+		for(size_t i = 0; i < accessor.count; ++i) memcpy(output.data() + i * elementSize, base + i * baseStride, elementSize);
+	}
+	applySparseValues(accessor, output.data(), elementSize);
+
+	return resolvedSparseAccessors.emplace(&accessor, std::move(output)).first->second.data();
+}
+
+size_t bufferViewDecoder::getAccessorByteStride(const tinygltf::Accessor& accessor) const
+{
+	return accessor.sparse.isSparse ? getElementSize(accessor) : getBaseByteStride(accessor);
+}
+
+size_t bufferViewDecoder::getElementSize(const tinygltf::Accessor& accessor)
+{
+	const auto componentSize  = tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType));
+	const auto componentCount = tinygltf::GetNumComponentsInType(uint32_t(accessor.type));
+	if(componentSize <= 0 || componentCount <= 0) throw LoadingError("Unrecognized accessor component type or element type");
+	return size_t(componentSize * componentCount);
+}
+
+const unsigned char* bufferViewDecoder::getBaseData(const tinygltf::Accessor& accessor)
+{
+	if(accessor.bufferView < 0) return nullptr;
+	const auto data = getData(accessor.bufferView);
+	if(!data) throw LoadingError("Accessor point to a bufferView that has no data");
+	return data + accessor.byteOffset;
+}
+
+size_t bufferViewDecoder::getBaseByteStride(const tinygltf::Accessor& accessor) const
+{
+	if(accessor.bufferView < 0) return getElementSize(accessor);
+	const auto byteStride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+	if(byteStride < 0) throw LoadingError("Can't get valid bytestride from accessor and bufferview. Loading data not possible");
+	return size_t(byteStride);
+}
+
+std::vector<uint32_t> bufferViewDecoder::getSparseIndices(const tinygltf::Accessor& accessor)
+{
+	const auto& sparse = accessor.sparse;
+	std::vector<uint32_t> indices(size_t(sparse.count));
+	const auto data = getData(sparse.indices.bufferView);
+	if(!data) throw LoadingError("Sparse accessor indices point to a bufferView that has no data");
+	const auto source = data + sparse.indices.byteOffset;
+
+	switch(sparse.indices.componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			for(size_t i = 0; i < indices.size(); ++i) indices[i] = source[i];
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			for(size_t i = 0; i < indices.size(); ++i)
+			{
+				uint16_t index;
+				memcpy(&index, source + i * sizeof index, sizeof index);
+				indices[i] = index;
+			}
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: memcpy(indices.data(), source, indices.size() * sizeof(uint32_t)); break;
+		default: throw LoadingError("Unrecognized sparse accessor index component type");
+	}
+
+	for(size_t i = 0; i < indices.size(); ++i)
+		if(indices[i] >= accessor.count || (i > 0 && indices[i] <= indices[i - 1]))
+			throw LoadingError("Sparse accessor indices are out of bounds or not strictly increasing");
+
+	return indices;
+}
+
+const unsigned char* bufferViewDecoder::getSparseValues(const tinygltf::Accessor& accessor)
+{
+	const auto data = getData(accessor.sparse.values.bufferView);
+	if(!data) throw LoadingError("Sparse accessor values point to a bufferView that has no data");
+	return data + accessor.sparse.values.byteOffset;
+}
+
+void bufferViewDecoder::applySparseValues(const tinygltf::Accessor& accessor, unsigned char* destination, size_t byteStride)
+{
+	if(!accessor.sparse.isSparse) return;
+
+	const auto elementSize = getElementSize(accessor);
+	const auto indices	   = getSparseIndices(accessor);
+	const auto values	   = getSparseValues(accessor);
+	for(size_t i = 0; i < indices.size(); ++i) memcpy(destination + indices[i] * byteStride, values + i * elementSize, elementSize);
+}
@@ -0,0 +1,148 @@
+#include "Ogre_glTF_ktx2.hpp"
+#include "Ogre_glTF_common.hpp"
+#include "Ogre_glTF.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace Ogre_glTF;
+
+namespace
+{
+	///The 12 bytes every KTX2 file starts with
+	const unsigned char identifier[] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	///Size of the fixed part of the header, the level index follows it
+	const size_t headerSize { 80 };
+
+	///Color models of the data format descriptor used by Basis Universal
+	const std::uint8_t colorModelETC1S { 163 }, colorModelUASTC { 166 };
+
+	///Transfer function of sRGB data in the data format descriptor
+	const std::uint8_t transferSRGB { 2 };
+
+	///Read a little endian value of the file
+	template <typename T> T read(const unsigned char* data, size_t offset)
+	{
+		T value;
+		std::memcpy(&value, data + offset, sizeof value);
+		return value;
+	}
+
+	///Get the Ogre pixel format of the Vulkan formats a KTX2 file can store and Ogre can sample
+	/// \param vkFormat the VkFormat value of the header
+	/// \param sRGB set if the format is a sRGB one
+	Ogre::PixelFormat getOgreFormat(std::uint32_t vkFormat, bool& sRGB)
+	{
+		sRGB = vkFormat == 43 || vkFormat == 132 || vkFormat == 134 || vkFormat == 138 || vkFormat == 146;
+		switch(vkFormat)
+		{
+			case 37: //R8G8B8A8_UNORM
+			case 43: return Ogre::PF_BYTE_RGBA;
+			case 131: //BC1_RGB_UNORM_BLOCK
+			case 132:
+			case 133: //BC1_RGBA_UNORM_BLOCK
+			case 134: return Ogre::PF_DXT1;
+			case 137: //BC3_UNORM_BLOCK
+			case 138: return Ogre::PF_DXT5;
+			case 139: return Ogre::PF_BC4_UNORM;
+			case 141: return Ogre::PF_BC5_UNORM;
+			case 145: //BC7_UNORM_BLOCK
+			case 146: return Ogre::PF_BC7_UNORM;
+			default: return Ogre::PF_UNKNOWN;
+		}
+	}
+}
+
+bool ktx2Image::isKtx2(const unsigned char* data, size_t size)
+{
+	return size >= sizeof identifier && std::equal(std::begin(identifier), std::end(identifier), data);
+}
+
+ktx2Image::ktx2Image(const unsigned char* content, size_t size) :
+ data { content }, width { 0 }, height { 0 }, encoding { Encoding::Unsupported }, pixelFormat { Ogre::PF_UNKNOWN }, sRGB { false }, alpha { false }
+{
+	if(!isKtx2(data, size) || size < headerSize) throw LoadingError("The image is not a KTX2 file");
+
+	const auto vkFormat				  = read<std::uint32_t>(data, 12);
+	width							  = read<std::uint32_t>(data, 20);
+	height							  = read<std::uint32_t>(data, 24);
+	const auto depth				  = read<std::uint32_t>(data, 28);
+	const auto layerCount			  = read<std::uint32_t>(data, 32);
+	const auto faceCount			  = read<std::uint32_t>(data, 36);
+	const auto levelCount			  = std::max<std::uint32_t>(1, read<std::uint32_t>(data, 40));
+	const auto supercompressionScheme = read<std::uint32_t>(data, 44);
+	const auto dfdOffset			  = size_t(read<std::uint32_t>(data, 48));
+	const auto dfdSize				  = size_t(read<std::uint32_t>(data, 52));
+
+	if(width == 0 || height == 0 || levelCount > 32 || headerSize + levelCount * 24 > size) throw LoadingError("The header of the KTX2 file is invalid");
+
+	//Level index : offset, size, and uncompressed size of each level, as 64 bit values
+	for(size_t level { 0 }; level < levelCount; level++)
+	{
+		const auto offset	   = read<std::uint64_t>(data, headerSize + level * 24);
+		const auto levelLength = read<std::uint64_t>(data, headerSize + level * 24 + 8);
+		if(offset > size || levelLength > size - offset) throw LoadingError("A level of the KTX2 file is outside of it");
+		levels.push_back({ size_t(offset), size_t(levelLength) });
+	}
+
+	//Basic data format descriptor : color model and transfer function, then 16 bytes per sample. The channel of a sample is in the low 4 bits
+	//of its 4th byte. ETC1S stores alpha as a second slice (channel 15), UASTC as the RGBA (3) or RRRG (5) channel of its only sample
+	std::uint8_t colorModel { 0 };
+	if(dfdSize >= 44 && dfdOffset + dfdSize <= size)
+	{
+		colorModel			   = data[dfdOffset + 12];
+		sRGB				   = data[dfdOffset + 14] == transferSRGB;
+		const auto blockSize   = std::min(size_t(read<std::uint16_t>(data, dfdOffset + 10)), dfdSize - 4);
+		const auto sampleCount = blockSize >= 24 ? (blockSize - 24) / 16 : 0;
+		for(size_t sample { 0 }; sample < sampleCount; sample++)
+		{
+			const auto channel = data[dfdOffset + 28 + sample * 16 + 3] & 0x0F;
+			if(colorModel == colorModelETC1S && channel == 15) alpha = true;
+			if(colorModel == colorModelUASTC && (channel == 3 || channel == 5)) alpha = true;
+		}
+	}
+
+	//Only single 2D images are textures of a glTF material
+	if(depth > 1 || layerCount > 1 || faceCount != 1) return;
+
+	if(colorModel == colorModelETC1S && supercompressionScheme == 1)
+		encoding = Encoding::ETC1S;
+	else if(colorModel == colorModelUASTC)
+		encoding = Encoding::UASTC;
+	else if(supercompressionScheme == 0)
+	{
+		auto formatSRGB = false;
+		pixelFormat		= getOgreFormat(vkFormat, formatSRGB);
+		if(pixelFormat == Ogre::PF_UNKNOWN) return;
+		sRGB	 = formatSRGB;
+		alpha	 = vkFormat == 37 || vkFormat == 43 || vkFormat == 133 || vkFormat == 134 || vkFormat == 137 || vkFormat == 138 || vkFormat >= 145;
+		encoding = Encoding::Raw;
+
+		for(size_t level { 0 }; level < levels.size(); level++)
+		{
+			const auto levelWidth  = Ogre::uint32(std::max<size_t>(1, width >> level));
+			const auto levelHeight = Ogre::uint32(std::max<size_t>(1, height >> level));
+			if(levels[level].size < Ogre::PixelUtil::getMemorySize(levelWidth, levelHeight, 1, pixelFormat))
+				throw LoadingError("A level of the KTX2 file is smaller than its size");
+		}
+	}
+}
+
+size_t ktx2Image::getWidth() const { return width; }
+
+size_t ktx2Image::getHeight() const { return height; }
+
+size_t ktx2Image::getLevelCount() const { return levels.size(); }
+
+ktx2Image::Encoding ktx2Image::getEncoding() const { return encoding; }
+
+Ogre::PixelFormat ktx2Image::getPixelFormat() const { return pixelFormat; }
+
+bool ktx2Image::isSRGB() const { return sRGB; }
+
+bool ktx2Image::hasAlpha() const { return alpha; }
+
+const unsigned char* ktx2Image::getLevelData(size_t level) const { return data + levels[level].offset; }
+
+size_t ktx2Image::getLevelSize(size_t level) const { return levels[level].size; }
@@ -6,6 +6,10 @@
 #include <OgreHlmsManager.h>
 #include <OgreLogManager.h>
 #include "Ogre_glTF_internal_utils.hpp"
+#include "Ogre_glTF.hpp"
+#include "Ogre_glTF_residency.hpp"
+#include <cmath>
+#include <set>
 
 using namespace Ogre_glTF;
 
@@ -45,32 +49,29 @@ void materialLoader::setBaseColorTexture(Ogre::HlmsPbsDatablock* block, int valu
 {
 	if(!isTextureIndexValid(value)) return;
 	auto texture = textureImporterRef.getTexture(value);
-	if(texture)
+	if(texture.texture)
 	{
-		//OgreLog("diffuse texture from textureImporter : " + texture->getName());
-		block->setTexture(Ogre::PbsTextureTypes::PBSM_DIFFUSE, 0, texture);
+		//OgreLog("diffuse texture from textureImporter : " + texture.texture->getName());
+		block->setTexture(Ogre::PbsTextureTypes::PBSM_DIFFUSE, texture.slice, texture.texture);
 	}
 }
 
 void materialLoader::setMetalRoughTexture(Ogre::HlmsPbsDatablock* block, int gltfTextureID) const
 {
 	if(!isTextureIndexValid(gltfTextureID)) return;
-	//Ogre cannot use combined metal rough textures. Metal is in the R channel, and rough in the G channel. It seems that the images are loaded as BGR by the libarry
-	//R channel is channle 2 (from 0), G channel is 1.
+	//Ogre cannot use combined metal rough textures. Metal is in the B channel, and rough in the G channel, each get its own single channel texture
+	const auto textures = textureImporterRef.getMetalRoughTextures(gltfTextureID);
 
-	auto metalTexure = textureImporterRef.generateGreyScaleFromChannel(gltfTextureID, 2);
-	auto roughTexure = textureImporterRef.generateGreyScaleFromChannel(gltfTextureID, 1);
-
-	if(metalTexure)
+	if(textures.first.texture)
 	{
-		//OgreLog("metalness greyscale texture extracted by textureImporter : " + metalTexure->getName());
-		block->setTexture(Ogre::PBSM_METALLIC, 0, metalTexure);
+		//OgreLog("metalness single channel texture extracted by textureImporter : " + textures.first.texture->getName());
+		block->setTexture(Ogre::PBSM_METALLIC, textures.first.slice, textures.first.texture);
 	}
 
-	if(roughTexure)
+	if(textures.second.texture)
 	{
-		//OgreLog("roughness geyscale texture extracted by textureImporter : " + roughTexure->getName());
-		block->setTexture(Ogre::PBSM_ROUGHNESS, 0, roughTexure);
+		//OgreLog("roughness single channel texture extracted by textureImporter : " + textures.second.texture->getName());
+		block->setTexture(Ogre::PBSM_ROUGHNESS, textures.second.slice, textures.second.texture);
 	}
 }
 
@@ -78,10 +79,10 @@ void materialLoader::setNormalTexture(Ogre::HlmsPbsDatablock* block, int value)
 {
 	if(!isTextureIndexValid(value)) return;
 	auto texture = textureImporterRef.getNormalSNORM(value);
-	if(texture)
+	if(texture.texture)
 	{
-		//OgreLog("normal texture from textureImporter : " + texture->getName());
-		block->setTexture(Ogre::PbsTextureTypes::PBSM_NORMAL, 0, texture);
+		//OgreLog("normal texture from textureImporter : " + texture.texture->getName());
+		block->setTexture(Ogre::PbsTextureTypes::PBSM_NORMAL, texture.slice, texture.texture);
 	}
 }
 
@@ -89,9 +90,9 @@ void materialLoader::setOcclusionTexture(Ogre::HlmsPbsDatablock* block, int valu
 {
 	if(!isTextureIndexValid(value)) return;
 	auto texture = textureImporterRef.getTexture(value);
-	if(texture)
+	if(texture.texture)
 	{
-		//OgreLog("occlusion texture from textureImporter : " + texture->getName());
+		//OgreLog("occlusion texture from textureImporter : " + texture.texture->getName());
 		//OgreLog("Warning: Ogre doesn't supoort occlusion map in it's HLMS PBS implementation!");
 		//block->setTexture(Ogre::PbsTextureTypes::PBSM_, 0, texture);
 	}
@@ -101,10 +102,10 @@ void materialLoader::setEmissiveTexture(Ogre::HlmsPbsDatablock* block, int value
 {
 	if(!isTextureIndexValid(value)) return;
 	auto texture = textureImporterRef.getTexture(value);
-	if(texture)
+	if(texture.texture)
 	{
-		//OgreLog("emissive texture from textureImporter : " + texture->getName());
-		block->setTexture(Ogre::PbsTextureTypes::PBSM_EMISSIVE, 0, texture);
+		//OgreLog("emissive texture from textureImporter : " + texture.texture->getName());
+		block->setTexture(Ogre::PbsTextureTypes::PBSM_EMISSIVE, texture.slice, texture.texture);
 	}
 }
 
@@ -127,29 +128,256 @@ void materialLoader::setAlphaCutoff(Ogre::HlmsPbsDatablock* block, Ogre::Real va
 	block->setAlphaTestThreshold(value);
 }
 
-materialLoader::materialLoader(tinygltf::Model& input, textureImporter& textureInterface) :
+materialLoader::materialLoader(tinygltf::Model& input, textureImporter& textureInterface, const importOptions& importSettings) :
  textureImporterRef { textureInterface },
- model { input }
+ model { input },
+ options { importSettings }
 {
 }
 
-Ogre::HlmsDatablock* materialLoader::getDatablock(size_t index) const
+materialLoader::~materialLoader()
+{
+	for(const auto& name : acquiredDatablocks) residencyManager::getSingleton().release(residencyManager::Kind::Datablock, name);
+}
+
+tinygltf::Material materialLoader::canonicalize(const tinygltf::Material& material, bool quantize) const
+{
+	auto canonical		   = material;
+	auto& values		   = canonical.values;
+	auto& additionalValues = canonical.additionalValues;
+
+	//Get the index of a texture. References to textures that don't exist are removed, they don't set anything in the datablock
+	const auto getImage = [&](tinygltf::ParameterMap& parameters, const std::string& name) {
+		const auto texture = parameters.find(name);
+		if(texture == parameters.end()) return -1;
+		const auto index = texture->second.TextureIndex();
+		if(index >= 0 && size_t(index) < model.textures.size()) return index;
+		parameters.erase(texture);
+		return -1;
+	};
+
+	//Get the factors of a parameter, with the glTF default values if the material doesn't have them
+	const auto getFactors = [](tinygltf::ParameterMap& parameters, const std::string& name, std::vector<double> defaults) -> std::vector<double>& {
+		auto& parameter = parameters[name];
+		if(parameter.number_array.size() < defaults.size()) parameter.number_array = std::move(defaults);
+		return parameter.number_array;
+	};
+	const auto getFactor = [](tinygltf::ParameterMap& parameters, const std::string& name, double defaultValue) -> double& {
+		auto& parameter = parameters[name];
+		if(!parameter.has_number_value) parameter.number_value = defaultValue;
+		parameter.has_number_value = true;
+		return parameter.number_value;
+	};
+
+	//Color textures are sampled as sRGB when hardware gamma is on. Metalness and roughness textures are always linear
+	const auto gamma  = textureImporterRef.isHardwareGammaEnabled();
+	const auto sample = [gamma](Ogre::uchar value) {
+		const auto normalized = double(value) / 255.0;
+		if(!gamma) return normalized;
+		return normalized <= 0.04045 ? normalized / 12.92 : std::pow((normalized + 0.055) / 1.055, 2.4);
+	};
+
+	//A texture of a single color is the same thing as a factor, without a texture unit and a shader permutation of its own
+	std::array<Ogre::uchar, 4> color {};
+	const auto baseColorImage = getImage(values, "baseColorTexture");
+	if(baseColorImage >= 0 && textureImporterRef.getUniformColor(baseColorImage, color))
+	{
+		auto& factor = getFactors(values, "baseColorFactor", { 1, 1, 1, 1 });
+		for(size_t c { 0 }; c < 3; ++c) factor[c] *= sample(color[c]);
+		factor[3] *= double(color[3]) / 255.0;
+		values.erase("baseColorTexture");
+	}
+
+	const auto metalRoughImage = getImage(values, "metallicRoughnessTexture");
+	if(metalRoughImage >= 0 && textureImporterRef.getUniformColor(metalRoughImage, color))
+	{
+		getFactor(values, "metallicFactor", 1) *= double(color[2]) / 255.0;
+		getFactor(values, "roughnessFactor", 1) *= double(color[1]) / 255.0;
+		values.erase("metallicRoughnessTexture");
+	}
+
+	//A flat normal map doesn't change the normals
+	const auto normalImage = getImage(additionalValues, "normalTexture");
+	if(normalImage >= 0 && textureImporterRef.getUniformColor(normalImage, color) && std::abs(int(color[0]) - 128) <= 1
+	   && std::abs(int(color[1]) - 128) <= 1 && color[2] >= 254)
+		additionalValues.erase("normalTexture");
+
+	//Occlusion maps are not used by the Hlms PBS
+	additionalValues.erase("occlusionTexture");
+
+	//The emissive texture is used as is by this loader when there is no emissive factor
+	const auto emissiveImage = getImage(additionalValues, "emissiveTexture");
+	if(emissiveImage >= 0 && textureImporterRef.getUniformColor(emissiveImage, color))
+	{
+		auto& factor = getFactors(additionalValues, "emissiveFactor", { 1, 1, 1 });
+		for(size_t c { 0 }; c < 3; ++c) factor[c] *= sample(color[c]);
+		additionalValues.erase("emissiveTexture");
+	}
+
+	//Quantize the factors, so that an alpha of 0.999 is opaque, and materials that only differ by rounding errors are the same
+	const auto step			= quantize ? double(options.materialQuantizationStep) : 0.0;
+	const auto quantizeStep = [step](double& value) {
+		if(step > 0) value = std::round(value / step) * step;
+	};
+	for(auto parameters : { &values, &additionalValues })
+		for(auto& parameter : *parameters)
+		{
+			if(parameter.second.json_double_value.count("index")) continue;
+			for(auto& value : parameter.second.number_array) quantizeStep(value);
+			quantizeStep(parameter.second.number_value);
+		}
+
+	//Alpha settings that have no effect : the alpha of opaque materials, a mask that let everything through, a blend of opaque pixels
+	auto alphaMode		   = additionalValues.count("alphaMode") ? additionalValues["alphaMode"].string_value : std::string("OPAQUE");
+	const auto alphaCutoff = additionalValues.count("alphaCutoff") ? additionalValues["alphaCutoff"].number_value : 0.5;
+	auto& baseColorFactor  = getFactors(values, "baseColorFactor", { 1, 1, 1, 1 });
+	const auto opaqueImage = !values.count("baseColorTexture") || !textureImporterRef.hasAlphaChannel(values["baseColorTexture"].TextureIndex());
+
+	if(alphaMode == "MASK" && alphaCutoff <= 0) alphaMode = "OPAQUE";
+	if(alphaMode == "BLEND" && baseColorFactor[3] >= 1 && opaqueImage) alphaMode = "OPAQUE";
+	if(alphaMode == "OPAQUE") baseColorFactor[3] = 1;
+	if(alphaMode != "MASK") additionalValues.erase("alphaCutoff");
+	if(alphaMode == "OPAQUE")
+		additionalValues.erase("alphaMode");
+	else
+		additionalValues["alphaMode"].string_value = alphaMode;
+
+	//Factors with the default value of the datablock don't need to be set
+	if(baseColorFactor == std::vector<double> { 1, 1, 1, 1 }) values.erase("baseColorFactor");
+	if(additionalValues.count("emissiveFactor") && getFactors(additionalValues, "emissiveFactor", { 0, 0, 0 }) == std::vector<double> { 0, 0, 0 })
+		additionalValues.erase("emissiveFactor");
+
+	return canonical;
+}
+
+std::string materialLoader::getPermutation(const tinygltf::Material& material) const
+{
+	//Mirror what createDatablock set on the datablock
+	std::string permutation;
+	const auto add = [&](const std::string& property) { permutation += (permutation.empty() ? "" : "+") + property; };
+	const auto has = [](const tinygltf::ParameterMap& parameters, const std::string& name) { return parameters.find(name) != parameters.end(); };
+	const auto hasTexture = [&](const tinygltf::ParameterMap& parameters, const std::string& name) {
+		return has(parameters, name) && parameters.at(name).TextureIndex() >= 0 && size_t(parameters.at(name).TextureIndex()) < model.textures.size();
+	};
+
+	if(hasTexture(material.values, "baseColorTexture")) add("diffuse_map");
+	if(hasTexture(material.values, "metallicRoughnessTexture")) add("metal_rough_maps");
+	if(hasTexture(material.additionalValues, "normalTexture")) add("normal_map");
+	if(hasTexture(material.additionalValues, "emissiveTexture")) add("emissive_map");
+
+	if(has(material.additionalValues, "emissiveFactor"))
+	{
+		const auto emissive = convertColor(material.additionalValues.at("emissiveFactor").ColorFactor());
+		if(emissive != Ogre::Vector3::ZERO) add("emissive");
+	}
+
+	if(has(material.values, "baseColorFactor"))
+	{
+		const auto& factor = material.values.at("baseColorFactor").number_array;
+		if(factor.size() > 3 && factor[3] != 1) add("transparent");
+	}
+
+	if(has(material.additionalValues, "alphaMode"))
+	{
+		const auto& mode = material.additionalValues.at("alphaMode").string_value;
+		if(mode == "BLEND") add("alpha_blend");
+		if(mode == "MASK") add("alpha_test");
+	}
+
+	return permutation.empty() ? "plain" : permutation;
+}
+
+materialReport materialLoader::getReport() const
 {
-	OgreLog("Loading material...");
-	auto HlmsPbs			 = static_cast<Ogre::HlmsPbs*>(Ogre::Root::getSingleton().getHlmsManager()->getHlms(Ogre::HlmsTypes::HLMS_PBS));
-	const auto material		 = model.materials[index];
+	materialReport report;
+	report.materialCount = model.materials.size();
 
-	auto datablock = static_cast<Ogre::HlmsPbsDatablock*>(HlmsPbs->getDatablock(Ogre::IdString(material.name)));
-	if(datablock)
+	std::set<std::string> permutations;
+	std::set<std::uint64_t> hashes, canonicalHashes;
+	for(const auto& material : model.materials)
 	{
-		//OgreLog("Found HlmsPbsDatablock " + material.name + " in Ogre::HlmsPbs");
-		return datablock;
+		const auto canonical = canonicalize(material);
+		permutations.insert(getPermutation(material));
+		report.permutations[getPermutation(canonical)]++;
+		hashes.insert(hashMaterial(material));
+		canonicalHashes.insert(hashMaterial(canonical));
 	}
-	datablock = static_cast<Ogre::HlmsPbsDatablock*>(HlmsPbs->createDatablock(Ogre::IdString(material.name),
-																			  material.name,
-																			  Ogre::HlmsMacroblock {},
-																			  Ogre::HlmsBlendblock {},
-																			  Ogre::HlmsParamVec {}));
+
+	report.permutationCount			 = permutations.size();
+	report.canonicalPermutationCount = report.permutations.size();
+	report.datablockCount			 = hashes.size();
+	report.canonicalDatablockCount	 = canonicalHashes.size();
+	return report;
+}
+
+std::uint64_t materialLoader::hashMaterial(const tinygltf::Material& material) const
+{
+	std::uint64_t hash { 0 };
+	const auto hashValue = [&](const void* data, size_t size) { hash = internal_utils::hashBytes(data, size, hash); };
+
+	for(const auto parameters : { &material.values, &material.additionalValues })
+	{
+		for(const auto& content : *parameters)
+		{
+			hashValue(content.first.data(), content.first.size());
+			const auto& parameter = content.second;
+
+			//Texture references : hash the key of the texture instead of its index in this file
+			for(const auto& property : parameter.json_double_value)
+			{
+				hashValue(property.first.data(), property.first.size());
+				if(property.first == "index" && property.second >= 0 && size_t(property.second) < model.textures.size())
+				{
+					const auto textureKey = textureImporterRef.getTextureKey(int(property.second));
+					hashValue(textureKey.data(), textureKey.size());
+				}
+				else
+					hashValue(&property.second, sizeof property.second);
+			}
+
+			hashValue(&parameter.number_value, sizeof parameter.number_value);
+			hashValue(parameter.number_array.data(), parameter.number_array.size() * sizeof(double));
+			hashValue(parameter.string_value.data(), parameter.string_value.size());
+			hashValue(&parameter.bool_value, sizeof parameter.bool_value);
+		}
+		hashValue("|", 1);
+	}
+
+	return hash;
+}
+
+Ogre::HlmsDatablock* materialLoader::getDatablock(size_t index) const
+{
+	auto HlmsPbs = static_cast<Ogre::HlmsPbs*>(Ogre::Root::getSingleton().getHlmsManager()->getHlms(Ogre::HlmsTypes::HLMS_PBS));
+	if(index >= model.materials.size()) return HlmsPbs->getDefaultDatablock();
+
+	if(datablocks.size() != model.materials.size()) datablocks.assign(model.materials.size(), nullptr);
+	if(datablocks[index]) return datablocks[index];
+
+	//Datablocks are named after their content : identical materials share one datablock, from this file or any other one
+	const auto simplify = options.canonicalizeMaterials || options.analyzeTextures;
+	const auto material = simplify ? canonicalize(model.materials[index], options.canonicalizeMaterials) : model.materials[index];
+	const auto name		= "glTF_material_" + internal_utils::hashToString(hashMaterial(material));
+	auto datablock		 = HlmsPbs->getDatablock(Ogre::IdString(name));
+	if(!datablock)
+	{
+		OgreLog("Loading material " + material.name + " as " + name);
+		datablock = createDatablock(material, name);
+	}
+
+	//The datablock is kept as long as this adapter, or an item, uses it
+	if(acquiredDatablocks.insert(name).second) residencyManager::getSingleton().acquire(residencyManager::Kind::Datablock, name);
+	return datablocks[index] = datablock;
+}
+
+Ogre::HlmsPbsDatablock* materialLoader::createDatablock(const tinygltf::Material& material, const std::string& name) const
+{
+	auto HlmsPbs   = static_cast<Ogre::HlmsPbs*>(Ogre::Root::getSingleton().getHlmsManager()->getHlms(Ogre::HlmsTypes::HLMS_PBS));
+	auto datablock = static_cast<Ogre::HlmsPbsDatablock*>(HlmsPbs->createDatablock(Ogre::IdString(name),
+																				   material.name.empty() ? name : material.name,
+																				   Ogre::HlmsMacroblock {},
+																				   Ogre::HlmsBlendblock {},
+																				   Ogre::HlmsParamVec {}));
 	datablock->setWorkflow(Ogre::HlmsPbsDatablock::Workflows::MetallicWorkflow);
 
 	//TODO refactor these almost exact peices of code
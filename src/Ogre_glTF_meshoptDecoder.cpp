@@ -0,0 +1,617 @@
+#include "Ogre_glTF_meshoptDecoder.hpp"
+#include "Ogre_glTF_simd.hpp"
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+
+//This is a decoder for the bitstream produced by meshoptimizer (https://github.com/zeux/meshoptimizer) encoders,
+//as described by the EXT_meshopt_compression specification. Encoding is not needed here, only decoding.
+
+namespace
+{
+	//Vertex codec constants
+	constexpr unsigned char vertexHeader	 = 0xa0;
+	constexpr size_t vertexBlockSizeBytes	 = 8192;
+	constexpr size_t vertexBlockMaxSize		 = 256;
+	constexpr size_t byteGroupSize			 = 16;
+	constexpr size_t byteGroupDecodeLimit	 = 24;
+	constexpr size_t vertexTailMinSize		 = 32;
+
+	//Index codec constants
+	constexpr unsigned char indexHeader		 = 0xe0;
+	constexpr unsigned char sequenceHeader	 = 0xd0;
+
+	size_t getVertexBlockSize(size_t vertexSize)
+	{
+		//The whole block needs to fit in the scratch buffer, and to be aligned on the byte group size
+		auto result = vertexBlockSizeBytes / vertexSize;
+		result &= ~(byteGroupSize - 1);
+		return result < vertexBlockMaxSize ? result : vertexBlockMaxSize;
+	}
+
+	unsigned char unzigzag8(unsigned char v) { return static_cast<unsigned char>(-(v & 1) ^ (v >> 1)); }
+
+	///Decode one group of 16 bytes, each of them encoded with 0, 2, 4 or 8 bits.
+	const unsigned char* decodeBytesGroup(const unsigned char* data, unsigned char* buffer, int bitsLog2)
+	{
+		//Values that are equal to the maximal value of the bit field are "escaped" and stored as a full byte after the bit fields
+		const auto decodeBitFields = [&](int bits, size_t headerBytes) {
+			const unsigned char* dataVar = data + headerBytes;
+			const unsigned int escape	 = (1u << bits) - 1;
+			for(size_t i = 0; i < headerBytes; ++i)
+			{
+				unsigned char byte = data[i];
+				for(int j = 0; j < 8 / bits; ++j)
+				{
+					const unsigned int enc = byte >> (8 - bits);
+					byte				   = static_cast<unsigned char>(byte << bits);
+					*buffer++			   = enc == escape ? *dataVar : static_cast<unsigned char>(enc);
+					dataVar += enc == escape;
+				}
+			}
+			return dataVar;
+		};
+
+		switch(bitsLog2)
+		{
+			case 0: memset(buffer, 0, byteGroupSize); return data;
+			case 1: return decodeBitFields(2, 4);
+			case 2: return decodeBitFields(4, 8);
+			default: memcpy(buffer, data, byteGroupSize); return data + byteGroupSize;
+		}
+	}
+
+	const unsigned char* decodeBytes(const unsigned char* data, const unsigned char* dataEnd, unsigned char* buffer, size_t bufferSize)
+	{
+		//2 bits of header per group, rounded up to the next byte
+		const unsigned char* header = data;
+		const auto headerSize		= (bufferSize / byteGroupSize + 3) / 4;
+		if(size_t(dataEnd - data) < headerSize) return nullptr;
+		data += headerSize;
+
+		for(size_t i = 0; i < bufferSize; i += byteGroupSize)
+		{
+			if(size_t(dataEnd - data) < byteGroupDecodeLimit) return nullptr;
+
+			const auto headerOffset = i / byteGroupSize;
+			const int bitsLog2		= (header[headerOffset / 4] >> ((headerOffset % 4) * 2)) & 3;
+			data					= decodeBytesGroup(data, buffer + i, bitsLog2);
+		}
+
+		return data;
+	}
+
+	const unsigned char* decodeVertexBlock(const unsigned char* data,
+										   const unsigned char* dataEnd,
+										   unsigned char* vertexData,
+										   size_t vertexCount,
+										   size_t vertexSize,
+										   unsigned char lastVertex[256])
+	{
+		unsigned char buffer[vertexBlockMaxSize];
+		unsigned char transposed[vertexBlockSizeBytes];
+
+		const auto vertexCountAligned = (vertexCount + byteGroupSize - 1) & ~(byteGroupSize - 1);
+
+		//Each byte of the vertex is stored in its own stream, as a zigzag encoded delta to the same byte of the previous vertex
+		for(size_t k = 0; k < vertexSize; ++k)
+		{
+			data = decodeBytes(data, dataEnd, buffer, vertexCountAligned);
+			if(!data) return nullptr;
+
+			auto vertexOffset = k;
+			auto p			  = lastVertex[k];
+			for(size_t i = 0; i < vertexCount; ++i)
+			{
+				const auto v			 = static_cast<unsigned char>(unzigzag8(buffer[i]) + p);
+				transposed[vertexOffset] = v;
+				p						 = v;
+				vertexOffset += vertexSize;
+			}
+		}
+
+		memcpy(vertexData, transposed, vertexCount * vertexSize);
+		memcpy(lastVertex, &transposed[vertexSize * (vertexCount - 1)], vertexSize);
+		return data;
+	}
+
+	unsigned int decodeVByte(const unsigned char*& data)
+	{
+		const unsigned char lead = *data++;
+		if(lead < 128) return lead;
+
+		//Values larger than 127 are encoded in groups of 7 bits, the high bit marking that another group follows
+		unsigned int result = lead & 127;
+		unsigned int shift	= 7;
+		for(int i = 0; i < 4; ++i)
+		{
+			const unsigned char group = *data++;
+			result |= unsigned(group & 127) << shift;
+			shift += 7;
+			if(group < 128) break;
+		}
+
+		return result;
+	}
+
+	unsigned int decodeIndex(const unsigned char*& data, unsigned int last)
+	{
+		const auto v = decodeVByte(data);
+		const auto d = (v >> 1) ^ static_cast<unsigned int>(-int(v & 1));
+		return last + d;
+	}
+
+	void writeIndex(unsigned char* destination, size_t i, size_t indexSize, unsigned int value)
+	{
+		if(indexSize == 2)
+			reinterpret_cast<uint16_t*>(destination)[i] = static_cast<uint16_t>(value);
+		else
+			reinterpret_cast<uint32_t*>(destination)[i] = value;
+	}
+
+	void writeTriangle(unsigned char* destination, size_t i, size_t indexSize, unsigned int a, unsigned int b, unsigned int c)
+	{
+		writeIndex(destination, i + 0, indexSize, a);
+		writeIndex(destination, i + 1, indexSize, b);
+		writeIndex(destination, i + 2, indexSize, c);
+	}
+
+	///The index codec keeps the last 16 seen edges and vertices to refer to them with 4 bits
+	struct indexFifos
+	{
+		unsigned int edges[16][2];
+		unsigned int vertices[16];
+		size_t edgeOffset	= 0;
+		size_t vertexOffset = 0;
+
+		indexFifos()
+		{
+			memset(edges, -1, sizeof edges);
+			memset(vertices, -1, sizeof vertices);
+		}
+
+		void pushEdge(unsigned int a, unsigned int b)
+		{
+			edges[edgeOffset][0] = a;
+			edges[edgeOffset][1] = b;
+			edgeOffset			 = (edgeOffset + 1) & 15;
+		}
+
+		void pushVertex(unsigned int v, bool condition = true)
+		{
+			vertices[vertexOffset] = v;
+			vertexOffset		   = (vertexOffset + (condition ? 1 : 0)) & 15;
+		}
+	};
+
+	template <typename T>
+	void decodeFilterOctahedralScalar(T* data, size_t count)
+	{
+		const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			//x and y are stored, z is reconstructed. This assumes z encodes 1.0f with the same bit count
+			auto x = float(data[i * 4 + 0]);
+			auto y = float(data[i * 4 + 1]);
+			auto z = float(data[i * 4 + 2]) - std::fabs(x) - std::fabs(y);
+
+			//Fixup octahedral coordinates for z < 0
+			const auto t = z < 0.f ? z : 0.f;
+			x += x >= 0.f ? t : -t;
+			y += y >= 0.f ? t : -t;
+
+			const auto l = std::sqrt(x * x + y * y + z * z);
+			const auto s = max / l;
+
+			data[i * 4 + 0] = T(int(x * s + (x >= 0.f ? 0.5f : -0.5f)));
+			data[i * 4 + 1] = T(int(y * s + (y >= 0.f ? 0.5f : -0.5f)));
+			data[i * 4 + 2] = T(int(z * s + (z >= 0.f ? 0.5f : -0.5f)));
+		}
+	}
+
+	void decodeFilterQuaternionScalar(int16_t* data, size_t count)
+	{
+		const float scale = 1.f / std::sqrt(2.f);
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			//The scale of the 3 stored components is recovered from the high bits of the 4th one
+			const int sf   = data[i * 4 + 3] | 3;
+			const float ss = scale / float(sf);
+
+			const auto x  = float(data[i * 4 + 0]) * ss;
+			const auto y  = float(data[i * 4 + 1]) * ss;
+			const auto z  = float(data[i * 4 + 2]) * ss;
+			const auto ww = 1.f - x * x - y * y - z * z;
+			const auto w  = std::sqrt(ww >= 0.f ? ww : 0.f);
+
+			//The 2 low bits are the index of the component that was dropped by the encoder
+			const int qc				  = data[i * 4 + 3] & 3;
+			data[i * 4 + ((qc + 1) & 3)] = int16_t(int(x * 32767.f + (x >= 0.f ? 0.5f : -0.5f)));
+			data[i * 4 + ((qc + 2) & 3)] = int16_t(int(y * 32767.f + (y >= 0.f ? 0.5f : -0.5f)));
+			data[i * 4 + ((qc + 3) & 3)] = int16_t(int(z * 32767.f + (z >= 0.f ? 0.5f : -0.5f)));
+			data[i * 4 + ((qc + 0) & 3)] = int16_t(int(w * 32767.f + 0.5f));
+		}
+	}
+
+	void decodeFilterExponentialScalar(uint32_t* data, size_t count)
+	{
+		for(size_t i = 0; i < count; ++i)
+		{
+			//24 bit signed mantissa, 8 bit signed exponent. This is ldexp(float(m), e) without the function call
+			const auto v = data[i];
+			const int m	 = int(v << 8) >> 8;
+			const int e	 = int(v) >> 24;
+
+			float f;
+			uint32_t bits = uint32_t(e + 127) << 23;
+			memcpy(&f, &bits, sizeof f);
+			f *= float(m);
+			memcpy(&bits, &f, sizeof f);
+			data[i] = bits;
+		}
+	}
+
+#if Ogre_glTF_SIMD_SSE2
+	///Sign extend the 4 lower 16 bit integers of a register to 32 bits
+	inline __m128i widenLow16(__m128i v) { return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); }
+
+	///Sign extend the 4 higher 16 bit integers of a register to 32 bits
+	inline __m128i widenHigh16(__m128i v) { return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+
+	///Round to nearest integer, with ties away from zero, the same way the scalar filters do it
+	inline __m128i roundAwayFromZero(__m128 v)
+	{
+		const auto sign = _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000))));
+		return _mm_cvttps_epi32(_mm_add_ps(v, _mm_or_ps(_mm_set1_ps(0.5f), sign)));
+	}
+
+	///Transpose 4 vectors of 4 integers
+	inline void transpose(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+	{
+		auto fa = _mm_castsi128_ps(a), fb = _mm_castsi128_ps(b), fc = _mm_castsi128_ps(c), fd = _mm_castsi128_ps(d);
+		_MM_TRANSPOSE4_PS(fa, fb, fc, fd);
+		a = _mm_castps_si128(fa), b = _mm_castps_si128(fb), c = _mm_castps_si128(fc), d = _mm_castps_si128(fd);
+	}
+
+	///Run the octahedral filter math on 4 elements stored as structure of arrays. w is kept as-is.
+	inline void octahedralKernel(__m128i& xi, __m128i& yi, __m128i& zi, float max)
+	{
+		const auto signMask = _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000)));
+
+		auto x = _mm_cvtepi32_ps(xi);
+		auto y = _mm_cvtepi32_ps(yi);
+		auto z = _mm_sub_ps(_mm_sub_ps(_mm_cvtepi32_ps(zi), _mm_andnot_ps(signMask, x)), _mm_andnot_ps(signMask, y));
+
+		//t = min(z, 0); x += x >= 0 ? t : -t;
+		const auto t = _mm_min_ps(z, _mm_setzero_ps());
+		x			 = _mm_add_ps(x, _mm_xor_ps(t, _mm_and_ps(x, signMask)));
+		y			 = _mm_add_ps(y, _mm_xor_ps(t, _mm_and_ps(y, signMask)));
+
+		const auto l = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z))));
+		const auto s = _mm_div_ps(_mm_set1_ps(max), l);
+
+		xi = roundAwayFromZero(_mm_mul_ps(x, s));
+		yi = roundAwayFromZero(_mm_mul_ps(y, s));
+		zi = roundAwayFromZero(_mm_mul_ps(z, s));
+	}
+
+	size_t decodeFilterOctahedral8SSE2(int8_t* data, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			//4 elements of 4 bytes. Sign extend them to 4 x 4 int32
+			const auto raw	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+			const auto lo16 = _mm_srai_epi16(_mm_unpacklo_epi8(raw, raw), 8);
+			const auto hi16 = _mm_srai_epi16(_mm_unpackhi_epi8(raw, raw), 8);
+
+			auto x = widenLow16(lo16), y = widenHigh16(lo16), z = widenLow16(hi16), w = widenHigh16(hi16);
+			transpose(x, y, z, w);
+			octahedralKernel(x, y, z, 127.f);
+			transpose(x, y, z, w);
+
+			const auto packed = _mm_packs_epi16(_mm_packs_epi32(x, y), _mm_packs_epi32(z, w));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i * 4), packed);
+		}
+		return i;
+	}
+
+	size_t decodeFilterOctahedral16SSE2(int16_t* data, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			//4 elements of 4 shorts, in 2 registers. Sign extend them to 4 x 4 int32
+			const auto raw0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+			const auto raw1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4 + 8));
+
+			auto x = widenLow16(raw0), y = widenHigh16(raw0), z = widenLow16(raw1), w = widenHigh16(raw1);
+			transpose(x, y, z, w);
+			octahedralKernel(x, y, z, 32767.f);
+			transpose(x, y, z, w);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i * 4), _mm_packs_epi32(x, y));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i * 4 + 8), _mm_packs_epi32(z, w));
+		}
+		return i;
+	}
+
+	size_t decodeFilterQuaternionSSE2(int16_t* data, size_t count)
+	{
+		const auto scale	= _mm_set1_ps(1.f / std::sqrt(2.f));
+		const auto one		= _mm_set1_ps(1.f);
+		const auto max		= _mm_set1_ps(32767.f);
+
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			const auto raw0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+			const auto raw1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4 + 8));
+
+			auto xi = widenLow16(raw0), yi = widenHigh16(raw0), zi = widenLow16(raw1), wi = widenHigh16(raw1);
+			transpose(xi, yi, zi, wi);
+
+			const auto ss = _mm_div_ps(scale, _mm_cvtepi32_ps(_mm_or_si128(wi, _mm_set1_epi32(3))));
+			const auto x  = _mm_mul_ps(_mm_cvtepi32_ps(xi), ss);
+			const auto y  = _mm_mul_ps(_mm_cvtepi32_ps(yi), ss);
+			const auto z  = _mm_mul_ps(_mm_cvtepi32_ps(zi), ss);
+			const auto ww = _mm_sub_ps(one, _mm_add_ps(_mm_mul_ps(x, x), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z))));
+			const auto w  = _mm_sqrt_ps(_mm_max_ps(ww, _mm_setzero_ps()));
+
+			alignas(16) int32_t components[4][4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(components[0]), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(w, max), _mm_set1_ps(0.5f))));
+			_mm_store_si128(reinterpret_cast<__m128i*>(components[1]), roundAwayFromZero(_mm_mul_ps(x, max)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(components[2]), roundAwayFromZero(_mm_mul_ps(y, max)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(components[3]), roundAwayFromZero(_mm_mul_ps(z, max)));
+
+			alignas(16) int32_t qcs[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(qcs), _mm_and_si128(wi, _mm_set1_epi32(3)));
+
+			//The position of each component in the output depends on the per element dropped component index
+			for(size_t j = 0; j < 4; ++j)
+			{
+				auto element = data + (i + j) * 4;
+				for(int c = 0; c < 4; ++c) element[(qcs[j] + c) & 3] = int16_t(components[c][j]);
+			}
+		}
+		return i;
+	}
+
+	size_t decodeFilterExponentialSSE2(uint32_t* data, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			const auto m = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+			const auto e = _mm_srai_epi32(v, 24);
+			const auto s = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(e, _mm_set1_epi32(127)), 23));
+			_mm_storeu_ps(reinterpret_cast<float*>(data + i), _mm_mul_ps(s, _mm_cvtepi32_ps(m)));
+		}
+		return i;
+	}
+#endif
+}
+
+bool Ogre_glTF::meshopt::decodeVertexBuffer(unsigned char* destination, size_t count, size_t byteStride, const unsigned char* source, size_t sourceSize)
+{
+	if(byteStride == 0 || byteStride > 256 || byteStride % 4 != 0) return false;
+
+	const unsigned char* data	 = source;
+	const unsigned char* dataEnd = source + sourceSize;
+
+	if(sourceSize < 1 + byteStride) return false;
+	const auto header = *data++;
+	if((header & 0xf0) != vertexHeader) return false;
+	if((header & 0x0f) > 0) return false; //Only version 0 exists
+
+	//The first vertex is delta encoded against this one, stored at the very end of the stream
+	unsigned char lastVertex[256];
+	memcpy(lastVertex, dataEnd - byteStride, byteStride);
+
+	const auto blockSize = getVertexBlockSize(byteStride);
+	for(size_t offset = 0; offset < count; offset += blockSize)
+	{
+		const auto currentBlockSize = offset + blockSize < count ? blockSize : count - offset;
+		data						= decodeVertexBlock(data, dataEnd, destination + offset * byteStride, currentBlockSize, byteStride, lastVertex);
+		if(!data) return false;
+	}
+
+	const auto tailSize = byteStride < vertexTailMinSize ? vertexTailMinSize : byteStride;
+	return size_t(dataEnd - data) == tailSize;
+}
+
+bool Ogre_glTF::meshopt::decodeIndexBuffer(unsigned char* destination, size_t count, size_t byteStride, const unsigned char* source, size_t sourceSize)
+{
+	if(count % 3 != 0 || (byteStride != 2 && byteStride != 4)) return false;
+
+	//Minimal valid encoding: header, one byte per triangle and the 16 bytes "codeaux" table
+	if(sourceSize < 1 + count / 3 + 16) return false;
+	if((source[0] & 0xf0) != indexHeader) return false;
+	const int version = source[0] & 0x0f;
+	if(version > 1) return false;
+
+	constexpr size_t codeAuxTableSize = 16;
+	indexFifos fifos;
+	unsigned int next = 0;
+	unsigned int last = 0;
+	const int fecMax  = version >= 1 ? 13 : 15;
+
+	const unsigned char* code		 = source + 1;
+	const unsigned char* data		 = code + count / 3;
+	const unsigned char* dataSafeEnd = source + sourceSize - codeAuxTableSize;
+	const unsigned char* codeAux	 = dataSafeEnd;
+
+	for(size_t i = 0; i < count; i += 3)
+	{
+		//A triangle read at most 16 bytes, the codeaux table at the end of the stream protect us from reading past the end
+		if(data > dataSafeEnd) return false;
+
+		const unsigned char codeTri = *code++;
+
+		if(codeTri < 0xf0)
+		{
+			//Triangle that share an edge with a recent one
+			const int fe		 = codeTri >> 4;
+			const unsigned int a = fifos.edges[(fifos.edgeOffset - 1 - fe) & 15][0];
+			const unsigned int b = fifos.edges[(fifos.edgeOffset - 1 - fe) & 15][1];
+			const int fec		 = codeTri & 15;
+
+			if(fec < fecMax)
+			{
+				const unsigned int c = fec == 0 ? next : fifos.vertices[(fifos.vertexOffset - 1 - fec) & 15];
+				next += fec == 0;
+
+				writeTriangle(destination, i, byteStride, a, b, c);
+				fifos.pushVertex(c, fec == 0);
+				fifos.pushEdge(c, b);
+				fifos.pushEdge(a, c);
+			}
+			else
+			{
+				//13 and 14 encode last -1 and last +1, 15 a free index
+				const unsigned int c = last = fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+
+				writeTriangle(destination, i, byteStride, a, b, c);
+				fifos.pushVertex(c);
+				fifos.pushEdge(c, b);
+				fifos.pushEdge(a, c);
+			}
+		}
+		else if(codeTri < 0xfe)
+		{
+			//Fast path, the vertex fifo references are in the codeaux table
+			const unsigned char aux = codeAux[codeTri & 15];
+			const int feb			= aux >> 4;
+			const int fec			= aux & 15;
+
+			const unsigned int a = next++;
+			const unsigned int b = feb == 0 ? next : fifos.vertices[(fifos.vertexOffset - feb) & 15];
+			next += feb == 0;
+			const unsigned int c = fec == 0 ? next : fifos.vertices[(fifos.vertexOffset - fec) & 15];
+			next += fec == 0;
+
+			writeTriangle(destination, i, byteStride, a, b, c);
+			fifos.pushVertex(a);
+			fifos.pushVertex(b, feb == 0);
+			fifos.pushVertex(c, fec == 0);
+			fifos.pushEdge(b, a);
+			fifos.pushEdge(c, b);
+			fifos.pushEdge(a, c);
+		}
+		else
+		{
+			//Slow path, codeaux is stored as a full byte
+			const unsigned char aux = *data++;
+			const int fea			= codeTri == 0xfe ? 0 : 15;
+			const int feb			= aux >> 4;
+			const int fec			= aux & 15;
+
+			//Reset : codeaux is 0 but was not encoded with the table
+			if(aux == 0) next = 0;
+
+			unsigned int a = fea == 0 ? next++ : 0;
+			unsigned int b = feb == 0 ? next++ : fifos.vertices[(fifos.vertexOffset - feb) & 15];
+			unsigned int c = fec == 0 ? next++ : fifos.vertices[(fifos.vertexOffset - fec) & 15];
+
+			if(fea == 15) last = a = decodeIndex(data, last);
+			if(feb == 15) last = b = decodeIndex(data, last);
+			if(fec == 15) last = c = decodeIndex(data, last);
+
+			writeTriangle(destination, i, byteStride, a, b, c);
+			fifos.pushVertex(a);
+			fifos.pushVertex(b, feb == 0 || feb == 15);
+			fifos.pushVertex(c, fec == 0 || fec == 15);
+			fifos.pushEdge(b, a);
+			fifos.pushEdge(c, b);
+			fifos.pushEdge(a, c);
+		}
+	}
+
+	//We should have stopped exactly at the start of the codeaux table
+	return data == dataSafeEnd;
+}
+
+bool Ogre_glTF::meshopt::decodeIndexSequence(unsigned char* destination, size_t count, size_t byteStride, const unsigned char* source, size_t sourceSize)
+{
+	if(byteStride != 2 && byteStride != 4) return false;
+
+	//Minimal valid encoding: header, one byte per index and a 4 bytes tail
+	if(sourceSize < 1 + count + 4) return false;
+	if((source[0] & 0xf0) != sequenceHeader) return false;
+	if((source[0] & 0x0f) > 1) return false;
+
+	const unsigned char* data		 = source + 1;
+	const unsigned char* dataSafeEnd = source + sourceSize - 4;
+
+	//Indices are delta encoded against one of the two last decoded values. The low bit selects the baseline
+	unsigned int last[2] = { 0, 0 };
+	for(size_t i = 0; i < count; ++i)
+	{
+		if(data >= dataSafeEnd) return false;
+
+		auto v				 = decodeVByte(data);
+		const auto current	 = v & 1;
+		v					 = v >> 1;
+		const auto d		 = (v >> 1) ^ static_cast<unsigned int>(-int(v & 1));
+		const auto index	 = last[current] + d;
+		last[current]		 = index;
+
+		writeIndex(destination, i, byteStride, index);
+	}
+
+	return data == dataSafeEnd;
+}
+
+bool Ogre_glTF::meshopt::decodeFilterOctahedral(unsigned char* data, size_t count, size_t byteStride)
+{
+	if(byteStride != 4 && byteStride != 8) return false;
+
+	size_t done = 0;
+	if(byteStride == 4)
+	{
+		auto typed = reinterpret_cast<int8_t*>(data);
+#if Ogre_glTF_SIMD_SSE2
+		done = decodeFilterOctahedral8SSE2(typed, count);
+#endif
+		decodeFilterOctahedralScalar(typed + done * 4, count - done);
+	}
+	else
+	{
+		auto typed = reinterpret_cast<int16_t*>(data);
+#if Ogre_glTF_SIMD_SSE2
+		done = decodeFilterOctahedral16SSE2(typed, count);
+#endif
+		decodeFilterOctahedralScalar(typed + done * 4, count - done);
+	}
+	return true;
+}
+
+bool Ogre_glTF::meshopt::decodeFilterQuaternion(unsigned char* data, size_t count, size_t byteStride)
+{
+	if(byteStride != 8) return false;
+
+	auto typed	= reinterpret_cast<int16_t*>(data);
+	size_t done = 0;
+#if Ogre_glTF_SIMD_SSE2
+	done = decodeFilterQuaternionSSE2(typed, count);
+#endif
+	decodeFilterQuaternionScalar(typed + done * 4, count - done);
+	return true;
+}
+
+bool Ogre_glTF::meshopt::decodeFilterExponential(unsigned char* data, size_t count, size_t byteStride)
+{
+	if(byteStride % 4 != 0) return false;
+
+	const auto valueCount = count * (byteStride / 4);
+	auto typed			  = reinterpret_cast<uint32_t*>(data);
+	size_t done			  = 0;
+#if Ogre_glTF_SIMD_SSE2
+	done = decodeFilterExponentialSSE2(typed, valueCount);
+#endif
+	decodeFilterExponentialScalar(typed + done, valueCount - done);
+	return true;
+}
@@ -0,0 +1,151 @@
+#include "Ogre_glTF_mipChain.hpp"
+#include "Ogre_glTF_simd.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+using namespace Ogre_glTF;
+
+namespace
+{
+	///Conversion tables between sRGB bytes and 16 bit linear values. 16 bits keep the darkest sRGB values apart
+	struct gammaTables
+	{
+		///Linear value of each sRGB byte, scaled to [0; 65535]
+		std::array<std::uint16_t, 256> toLinear;
+
+		///sRGB byte of each 16 bit linear value
+		std::vector<Ogre::uchar> toSRGB;
+
+		gammaTables() : toSRGB(65536)
+		{
+			for(size_t i { 0 }; i < toLinear.size(); i++)
+			{
+				const auto value  = double(i) / 255.0;
+				const auto linear = value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+				toLinear[i]		  = std::uint16_t(std::lround(linear * 65535.0));
+			}
+			for(size_t i { 0 }; i < toSRGB.size(); i++)
+			{
+				const auto linear = double(i) / 65535.0;
+				const auto value  = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+				toSRGB[i]		  = Ogre::uchar(std::lround(value * 255.0));
+			}
+		}
+	};
+
+	///Get the gamma tables, built the first time they are needed
+	const gammaTables& getGammaTables()
+	{
+		static const gammaTables tables;
+		return tables;
+	}
+
+	///Average 2x2 blocks of pixels of two rows into one row. The last column is repeated for odd widths
+	/// \param top first row of the source pixels
+	/// \param bottom second row of the source pixels. Same as top for the last row of images with an odd height
+	/// \param sourceWidth number of pixels in the source rows
+	/// \param pixelSize number of bytes per pixel
+	/// \param colorChannels number of the first channels of each pixel that are sRGB, the others are averaged as they are
+	/// \param destination where to write the averaged pixels
+	/// \param width number of pixels to write
+	void downsampleRow(const Ogre::uchar* top,
+					   const Ogre::uchar* bottom,
+					   size_t sourceWidth,
+					   size_t pixelSize,
+					   size_t colorChannels,
+					   Ogre::uchar* destination,
+					   size_t width)
+	{
+		size_t x { 0 };
+#if Ogre_glTF_SIMD_SSE2
+		//Linear RGBA : 4 destination pixels at a time, the channels are widened to 16 bits to be summed
+		if(colorChannels == 0 && pixelSize == 4)
+		{
+			const auto zero		= _mm_setzero_si128();
+			const auto rounding = _mm_set1_epi16(2);
+			const auto average	= [&](__m128i up, __m128i down) {
+				 const auto left  = _mm_add_epi16(_mm_unpacklo_epi8(up, zero), _mm_unpacklo_epi8(down, zero));
+				 const auto right = _mm_add_epi16(_mm_unpackhi_epi8(up, zero), _mm_unpackhi_epi8(down, zero));
+				 const auto sums  = _mm_unpacklo_epi64(_mm_add_epi16(left, _mm_srli_si128(left, 8)), _mm_add_epi16(right, _mm_srli_si128(right, 8)));
+				 return _mm_srli_epi16(_mm_add_epi16(sums, rounding), 2);
+			};
+			for(; 2 * x + 8 <= sourceWidth && x + 4 <= width; x += 4)
+			{
+				const auto up	= reinterpret_cast<const __m128i*>(top + x * 8);
+				const auto down = reinterpret_cast<const __m128i*>(bottom + x * 8);
+				const auto left	 = average(_mm_loadu_si128(up), _mm_loadu_si128(down));
+				const auto right = average(_mm_loadu_si128(up + 1), _mm_loadu_si128(down + 1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x * 4), _mm_packus_epi16(left, right));
+			}
+		}
+#endif
+		const auto& tables = getGammaTables();
+		for(; x < width; x++)
+		{
+			const auto left	 = 2 * x * pixelSize;
+			const auto right = std::min(2 * x + 1, sourceWidth - 1) * pixelSize;
+			for(size_t c { 0 }; c < pixelSize; c++)
+			{
+				const auto pixel = destination + x * pixelSize + c;
+				if(c < colorChannels)
+					*pixel = tables.toSRGB[(unsigned(tables.toLinear[top[left + c]]) + tables.toLinear[top[right + c]] + tables.toLinear[bottom[left + c]]
+											+ tables.toLinear[bottom[right + c]] + 2)
+										   / 4];
+				else
+					*pixel = Ogre::uchar((unsigned(top[left + c]) + top[right + c] + bottom[left + c] + bottom[right + c] + 2) / 4);
+			}
+		}
+	}
+}
+
+mipChain::mipChain(const Ogre::uchar* pixels, size_t imageWidth, size_t imageHeight, size_t bytesPerPixel, bool sRGB, bool mipmaps) :
+ image { pixels }, width { imageWidth }, height { imageHeight }, pixelSize { bytesPerPixel }, gamma { sRGB }
+{
+	levels.resize(countLevels(width, height, mipmaps) - 1);
+	for(size_t level { 1 }; level < getLevelCount(); level++) levels[level - 1].resize(getWidth(level) * getHeight(level) * pixelSize);
+}
+
+size_t mipChain::countLevels(size_t width, size_t height, bool mipmaps)
+{
+	size_t count { 1 };
+	if(mipmaps)
+		for(auto size = std::max(width, height); size > 1; size /= 2) count++;
+	return count;
+}
+
+size_t mipChain::getLevelCount() const { return levels.size() + 1; }
+
+size_t mipChain::getWidth(size_t level) const { return std::max<size_t>(1, width >> level); }
+
+size_t mipChain::getHeight(size_t level) const { return std::max<size_t>(1, height >> level); }
+
+size_t mipChain::getPixelSize() const { return pixelSize; }
+
+const Ogre::uchar* mipChain::getPixels(size_t level) const { return level == 0 ? image : levels[level - 1].data(); }
+
+void mipChain::downsampleRows(size_t level, size_t firstRow, size_t lastRow)
+{
+	//The alpha of RGBA and grey + alpha pixels is never sRGB
+	const auto colorChannels = gamma ? (pixelSize == 2 || pixelSize == 4 ? pixelSize - 1 : pixelSize) : 0;
+	const auto source		 = getPixels(level - 1);
+	const auto sourceWidth	 = getWidth(level - 1);
+	const auto sourceHeight	 = getHeight(level - 1);
+	const auto destination	 = levels[level - 1].data();
+	for(auto y = firstRow; y < lastRow; y++)
+		downsampleRow(source + 2 * y * sourceWidth * pixelSize,
+					  source + std::min(2 * y + 1, sourceHeight - 1) * sourceWidth * pixelSize,
+					  sourceWidth,
+					  pixelSize,
+					  colorChannels,
+					  destination + y * getWidth(level) * pixelSize,
+					  getWidth(level));
+}
+
+void mipChain::keepImage()
+{
+	if(!ownImage.empty()) return;
+	ownImage.assign(image, image + width * height * pixelSize);
+	image = ownImage.data();
+}
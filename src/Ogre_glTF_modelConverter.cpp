@@ -4,14 +4,112 @@
 #include <OgreMeshManager2.h>
 #include <OgreSubMesh2.h>
 #include "Ogre_glTF_internal_utils.hpp"
+#include "Ogre_glTF_residency.hpp"
+#include "Ogre_glTF_simd.hpp"
+#include <limits>
+#include <map>
 
 using namespace Ogre_glTF;
 
+namespace
+{
+	///Copy 3D float vectors from a strided buffer into a tightly packed one, and compute their bounding box in the same pass
+	/// \param destination where to write the vectors, 3 floats each
+	/// \param source where to read the vectors from
+	/// \param byteStride number of bytes between two vectors in the source
+	/// \param count number of vectors
+	/// \param minimum set to the minimum of each component
+	/// \param maximum set to the maximum of each component
+	void copyPositions(float* destination, const unsigned char* source, size_t byteStride, size_t count, Ogre::Vector3& minimum, Ogre::Vector3& maximum)
+	{
+		if(count == 0)
+		{
+			minimum = maximum = Ogre::Vector3::ZERO;
+			return;
+		}
+
+#if Ogre_glTF_SIMD_SSE2
+		auto minimums = simd::load3(source);
+		auto maximums = minimums;
+		for(size_t i = 0; i < count; ++i)
+		{
+			const auto position = simd::load3(source + i * byteStride);
+			simd::store3(destination + i * 3, position);
+			minimums = _mm_min_ps(minimums, position);
+			maximums = _mm_max_ps(maximums, position);
+		}
+
+		alignas(16) float result[4];
+		_mm_store_ps(result, minimums);
+		minimum = Ogre::Vector3 { result[0], result[1], result[2] };
+		_mm_store_ps(result, maximums);
+		maximum = Ogre::Vector3 { result[0], result[1], result[2] };
+#else
+		memcpy(&minimum, source, 3 * sizeof(float));
+		maximum = minimum;
+		for(size_t i = 0; i < count; ++i)
+		{
+			Ogre::Vector3 position;
+			memcpy(&position, source + i * byteStride, 3 * sizeof(float));
+			memcpy(destination + i * 3, &position, 3 * sizeof(float));
+			minimum.makeFloor(position);
+			maximum.makeCeil(position);
+		}
+#endif
+	}
+
+	///Get the radius of the smallest sphere centered on a point that contains all the vectors of a tightly packed array
+	/// \param positions 3 floats per vector
+	/// \param count number of vectors
+	/// \param center center of the sphere
+	Ogre::Real getBoundingRadius(const float* positions, size_t count, const Ogre::Vector3& center)
+	{
+#if Ogre_glTF_SIMD_SSE2
+		const auto centers	 = _mm_setr_ps(center.x, center.y, center.z, 0);
+		auto squaredDistance = _mm_setzero_ps();
+		for(size_t i = 0; i < count; ++i)
+		{
+			auto offset = _mm_sub_ps(simd::load3(positions + i * 3), centers);
+			offset		= _mm_mul_ps(offset, offset);
+			offset		= _mm_add_ss(_mm_add_ss(offset, _mm_shuffle_ps(offset, offset, _MM_SHUFFLE(1, 1, 1, 1))), _mm_movehl_ps(offset, offset));
+			squaredDistance = _mm_max_ss(squaredDistance, offset);
+		}
+		return std::sqrt(_mm_cvtss_f32(squaredDistance));
+#else
+		Ogre::Real squaredDistance { 0 };
+		for(size_t i = 0; i < count; ++i)
+			squaredDistance = std::max(squaredDistance, center.squaredDistance({ positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2] }));
+		return std::sqrt(squaredDistance);
+#endif
+	}
+}
+
 size_t vertexBufferPart::getPartStride() const { return buffer->elementSize() * perVertex; }
 
-modelConverter::modelConverter(tinygltf::Model& input) : model { input } {}
+modelConverter::modelConverter(tinygltf::Model& input, bufferViewDecoder& decoder) : model { input }, bufferViews { decoder } {}
+
+modelConverter::~modelConverter()
+{
+	for(const auto& meshName : acquiredMeshes) residencyManager::getSingleton().release(residencyManager::Kind::Mesh, meshName);
+}
+
+void modelConverter::acquireMesh(const std::string& meshName)
+{
+	if(acquiredMeshes.insert(meshName).second) residencyManager::getSingleton().acquire(residencyManager::Kind::Mesh, meshName);
+}
 
-Ogre::VertexBufferPackedVec modelConverter::constructVertexBuffer(const std::vector<vertexBufferPart>& parts) const
+Ogre::MeshPtr modelConverter::findMesh(const std::string& meshName)
+{
+	auto ogreMesh = Ogre::MeshManager::getSingleton().getByName(meshName);
+	if(ogreMesh) acquireMesh(meshName);
+	return ogreMesh;
+}
+
+void modelConverter::setSourceIdentifier(const std::string& identifier) { sourceIdentifier = identifier; }
+
+std::string modelConverter::getMeshName(size_t meshIdx) const { return "glTF_mesh_" + sourceIdentifier + "_" + std::to_string(meshIdx); }
+
+Ogre::VertexBufferPackedVec modelConverter::constructVertexBuffer(const std::vector<vertexBufferPart>& parts, Ogre::BufferType bufferType) const
 {
 	Ogre::VertexElement2Vec vertexElements;
 
@@ -51,7 +149,7 @@ Ogre::VertexBufferPackedVec modelConverter::constructVertexBuffer(const std::vec
 	}
 
 	Ogre::VertexBufferPackedVec vec;
-	auto vertexBuffer = getVaoManager()->createVertexBuffer(vertexElements, vertexCount, Ogre::BT_IMMUTABLE, finalBuffer.data(), false);
+	auto vertexBuffer = getVaoManager()->createVertexBuffer(vertexElements, vertexCount, bufferType, finalBuffer.data(), false);
 
 	vec.push_back(vertexBuffer);
 	return vec;
@@ -82,20 +180,34 @@ Ogre::MeshPtr modelConverter::getOgreMesh(const Ogre::String& name)
 
 Ogre::MeshPtr modelConverter::getOgreMesh(size_t meshIdx)
 {
-	Ogre::Aabb boundingBox;
-	auto& mesh = model.meshes[meshIdx];
+	const auto& mesh = model.meshes[meshIdx];
 	OgreLog("Found mesh " + mesh.name + " in glTF file");
 
-	auto ogreMesh = Ogre::MeshManager::getSingleton().getByName(mesh.name);
+	//The name identify the content of the file and the mesh in it, so a mesh found here is the same one
+	const auto meshName = getMeshName(meshIdx);
+	auto ogreMesh		= findMesh(meshName);
 	if(ogreMesh)
 	{
-		OgreLog("Found mesh " + mesh.name + " in Ogre::MeshManager(v2)");
+		OgreLog("Found mesh " + meshName + " in Ogre::MeshManager(v2)");
 		return ogreMesh;
 	}
 
+	return createMesh(meshIdx, meshName, nullptr);
+}
+
+Ogre::MeshPtr modelConverter::createMorphableMesh(size_t meshIdx, const std::string& name, std::vector<Ogre::VertexBufferPacked*>& morphedBuffers)
+{
+	return createMesh(meshIdx, name, &morphedBuffers);
+}
+
+Ogre::MeshPtr modelConverter::createMesh(size_t meshIdx, const std::string& meshName, std::vector<Ogre::VertexBufferPacked*>* morphedBuffers)
+{
+	auto& mesh = model.meshes[meshIdx];
+	std::vector<subMeshBounds> bounds;
+
 	OgreLog("Loading mesh from glTF file");
 	OgreLog("mesh has " + std::to_string(mesh.primitives.size()) + " primitives");
-	ogreMesh = Ogre::MeshManager::getSingleton().createManual(mesh.name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	auto ogreMesh = Ogre::MeshManager::getSingleton().createManual(meshName, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
 	OgreLog("Created mesh on v2 MeshManager");
 
 	for(const auto& primitive : mesh.primitives)
@@ -105,11 +217,36 @@ Ogre::MeshPtr modelConverter::getOgreMesh(size_t meshIdx)
 		const auto indexBuffer = extractIndexBuffer(primitive.indices);
 
 		std::vector<vertexBufferPart> parts;
+		subMeshBounds primitiveBounds {};
 		//OgreLog("\tprimitive has : " + std::to_string(primitive.attributes.size()) + " atributes");
 		for(const auto& atribute : primitive.attributes)
 		{
 			//OgreLog("\t " + atribute.first);
-			parts.push_back(std::move(extractVertexBuffer(atribute, boundingBox)));
+			parts.push_back(std::move(extractVertexBuffer(atribute, primitiveBounds)));
+		}
+		bounds.push_back(primitiveBounds);
+
+		Ogre::VertexBufferPackedVec vertexBuffers;
+		if(morphedBuffers)
+		{
+			//The morphed attributes get their own buffer, that the morphBlender will overwrite with the blended vertices
+			std::vector<vertexBufferPart> morphedParts;
+			for(const auto semantic : { Ogre::VES_POSITION, Ogre::VES_NORMAL })
+			{
+				const auto part = std::find_if(std::begin(parts), std::end(parts), [&](const vertexBufferPart& candidate) { return candidate.semantic == semantic; });
+				if(part == std::end(parts)) continue;
+				morphedParts.push_back(std::move(*part));
+				parts.erase(part);
+			}
+
+			vertexBuffers = constructVertexBuffer(morphedParts, Ogre::BT_DEFAULT);
+			morphedBuffers->push_back(vertexBuffers.front());
+		}
+
+		if(!parts.empty())
+		{
+			const auto staticVertexBuffers = constructVertexBuffer(parts);
+			vertexBuffers.insert(vertexBuffers.end(), staticVertexBuffers.begin(), staticVertexBuffers.end());
 		}
 
 		//Get (if they exist) the blend weights and bone index parts of our vertex array object content
@@ -121,8 +258,7 @@ Ogre::MeshPtr modelConverter::getOgreMesh(size_t meshIdx)
 			return (vertexBufferPart.semantic == Ogre::VertexElementSemantic::VES_BLEND_WEIGHTS);
 		});
 
-		const auto vertexBuffers = constructVertexBuffer(parts);
-		auto vao				 = getVaoManager()->createVertexArrayObject(vertexBuffers, indexBuffer, [&]() -> Ogre::OperationType {
+		auto vao = getVaoManager()->createVertexArrayObject(vertexBuffers, indexBuffer, [&]() -> Ogre::OperationType {
 			switch(primitive.mode)
 			{
 				case TINYGLTF_MODE_LINE: OgreLog("Line List"); return Ogre::OT_LINE_LIST;
@@ -189,12 +325,53 @@ Ogre::MeshPtr modelConverter::getOgreMesh(size_t meshIdx)
 		}
 	}
 
-	ogreMesh->_setBounds(boundingBox, true);
-	//OgreLog("Setting 'bounding sphere radius' from bounds : " + std::to_string(boundingBox.getRadius()));
+	//Skinned meshes are only bounded in their bind pose, keep some margin for them
+	const auto meshBounds = mergeBounds(bounds);
+	const auto skinned	  = std::any_of(mesh.primitives.begin(), mesh.primitives.end(), [](const tinygltf::Primitive& primitive) {
+		return primitive.attributes.find("JOINTS_0") != primitive.attributes.end();
+	});
+	ogreMesh->_setBounds(meshBounds.box, skinned);
+	if(!skinned) ogreMesh->_setBoundingSphereRadius(meshBounds.radius);
+	OgreLog("Setting 'bounding sphere radius' : " + std::to_string(ogreMesh->getBoundingSphereRadius()));
+
+	subMeshesBounds[meshIdx] = std::move(bounds);
 
+	//The meshes of morphed items can't be reused, their morphController destroys them instead of the residencyManager
+	if(!morphedBuffers) acquireMesh(meshName);
 	return ogreMesh;
 }
 
+subMeshBounds modelConverter::mergeBounds(const std::vector<subMeshBounds>& bounds)
+{
+	if(bounds.empty()) return { Ogre::Aabb::BOX_ZERO, 0 };
+
+	auto box = bounds.front().box;
+	for(const auto& submesh : bounds) box.merge(submesh.box);
+
+	//The sphere is centered on the box : it contains the spheres of the submeshes
+	Ogre::Real radius { 0 };
+	for(const auto& submesh : bounds) radius = std::max(radius, box.mCenter.distance(submesh.box.mCenter) + submesh.radius);
+	return { box, std::min(radius, box.getRadius()) };
+}
+
+const std::vector<subMeshBounds>& modelConverter::getSubMeshBounds(size_t meshIdx)
+{
+	auto computed = subMeshesBounds.find(meshIdx);
+	if(computed != subMeshesBounds.end()) return computed->second;
+
+	//The mesh was converted by another loader of the same file, only read the positions again
+	std::vector<subMeshBounds> bounds;
+	for(const auto& primitive : model.meshes[meshIdx].primitives)
+	{
+		subMeshBounds primitiveBounds {};
+		const auto position = primitive.attributes.find("POSITION");
+		if(position != primitive.attributes.end()) extractVertexBuffer(*position, primitiveBounds);
+		bounds.push_back(primitiveBounds);
+	}
+
+	return subMeshesBounds[meshIdx] = std::move(bounds);
+}
+
 void modelConverter::debugDump() const
 {
 	std::stringstream gltfContentDump;
@@ -228,15 +405,12 @@ Ogre::VaoManager* modelConverter::getVaoManager()
 Ogre::IndexBufferPacked* modelConverter::extractIndexBuffer(int accessorID) const
 {
 	OgreLog("Extracting index buffer");
-	const auto& accessor   = model.accessors[accessorID];
-	const auto& bufferView = model.bufferViews[accessor.bufferView];
-	auto& buffer		   = model.buffers[bufferView.buffer];
-	const auto byteStride  = accessor.ByteStride(bufferView);
-	const auto indexCount  = accessor.count;
+	const auto& accessor  = model.accessors[accessorID];
+	const auto data		  = bufferViews.getAccessorData(accessor);
+	const auto byteStride = bufferViews.getAccessorByteStride(accessor);
+	const auto indexCount = accessor.count;
 	Ogre::IndexBufferPacked::IndexType type;
 
-	if(byteStride < 0) throw LoadingError("Can't get valid bytestride from accessor and bufferview. Loading data not possible");
-
 	auto convertTo16Bit { false };
 	switch(accessor.componentType)
 	{
@@ -249,13 +423,9 @@ Ogre::IndexBufferPacked* modelConverter::extractIndexBuffer(int accessorID) cons
 			type			= Ogre::IndexBufferPacked::IT_16BIT;
 			auto geomBuffer = geometryBuffer<Ogre::uint16>(indexCount);
 			if(convertTo16Bit)
-				loadIndexBuffer(geomBuffer.data(), buffer.data.data(), indexCount, bufferView.byteOffset + accessor.byteOffset, byteStride);
+				loadIndexBuffer(geomBuffer.data(), data, indexCount, 0, byteStride);
 			else
-				loadIndexBuffer(geomBuffer.data(),
-								reinterpret_cast<Ogre::uint16*>(buffer.data.data()),
-								indexCount,
-								bufferView.byteOffset + accessor.byteOffset,
-								byteStride);
+				loadIndexBuffer(geomBuffer.data(), reinterpret_cast<const Ogre::uint16*>(data), indexCount, 0, byteStride);
 			return getVaoManager()->createIndexBuffer(type, indexCount, Ogre::BT_IMMUTABLE, geomBuffer.dataAddress(), false);
 		}
 		case TINYGLTF_COMPONENT_TYPE_INT:;
@@ -263,8 +433,7 @@ Ogre::IndexBufferPacked* modelConverter::extractIndexBuffer(int accessorID) cons
 		{
 			type			= Ogre::IndexBufferPacked::IT_32BIT;
 			auto geomBuffer = geometryBuffer<Ogre::uint32>(indexCount);
-			loadIndexBuffer(
-				geomBuffer.data(), reinterpret_cast<Ogre::uint32*>(buffer.data.data()), indexCount, bufferView.byteOffset + accessor.byteOffset, byteStride);
+			loadIndexBuffer(geomBuffer.data(), reinterpret_cast<const Ogre::uint32*>(data), indexCount, 0, byteStride);
 			return getVaoManager()->createIndexBuffer(type, indexCount, Ogre::BT_IMMUTABLE, geomBuffer.dataAddress(), false);
 		}
 	}
@@ -294,15 +463,12 @@ Ogre::VertexElementSemantic modelConverter::getVertexElementScemantic(const std:
 	return Ogre::VES_COUNT; //Returning this means returning "invalid" here
 }
 
-vertexBufferPart modelConverter::extractVertexBuffer(const std::pair<std::string, int>& attribute, Ogre::Aabb& boundingBox) const
+vertexBufferPart modelConverter::extractVertexBuffer(const std::pair<std::string, int>& attribute, subMeshBounds& bounds) const
 {
 	const auto elementScemantic			= getVertexElementScemantic(attribute.first);
 	const auto& accessor				= model.accessors[attribute.second];
-	const auto& bufferView				= model.bufferViews[accessor.bufferView];
-	const auto& buffer					= model.buffers[bufferView.buffer];
-	const auto vertexBufferByteLen		= bufferView.byteLength;
+	const auto data						= bufferViews.getBaseData(accessor);
 	const auto numberOfElementPerVertex = getVertexBufferElementsPerVertexCount(accessor.type);
-	const auto elementOffsetInBuffer	= bufferView.byteOffset + accessor.byteOffset;
 	size_t bufferLenghtInBufferBasicType { 0 };
 
 	std::unique_ptr<geometryBuffer_base> geomBuffer { nullptr };
@@ -312,14 +478,14 @@ vertexBufferPart modelConverter::extractVertexBuffer(const std::pair<std::string
 	{
 		case TINYGLTF_COMPONENT_TYPE_DOUBLE: throw LoadingError("Double precision not implemented!");
 		case TINYGLTF_COMPONENT_TYPE_FLOAT:
-			bufferLenghtInBufferBasicType = (vertexBufferByteLen / sizeof(float));
+			bufferLenghtInBufferBasicType = accessor.count * numberOfElementPerVertex;
 			geomBuffer					  = std::make_unique<geometryBuffer<float>>(bufferLenghtInBufferBasicType);
 			if(numberOfElementPerVertex == 2) elementType = Ogre::VET_FLOAT2;
 			if(numberOfElementPerVertex == 3) elementType = Ogre::VET_FLOAT3;
 			if(numberOfElementPerVertex == 4) elementType = Ogre::VET_FLOAT4;
 			break;
 		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-			bufferLenghtInBufferBasicType = (vertexBufferByteLen / sizeof(unsigned short));
+			bufferLenghtInBufferBasicType = accessor.count * numberOfElementPerVertex;
 			geomBuffer					  = std::make_unique<geometryBuffer<unsigned short>>(bufferLenghtInBufferBasicType);
 			if(numberOfElementPerVertex == 2) elementType = Ogre::VET_USHORT2;
 			if(numberOfElementPerVertex == 4) elementType = Ogre::VET_USHORT4;
@@ -330,37 +496,244 @@ vertexBufferPart modelConverter::extractVertexBuffer(const std::pair<std::string
 	//if(bufferView.byteStride == 0)
 	//	OgreLog("Vertex buffer is 'tightly packed'");
 
-	const auto byteStride				  = accessor.ByteStride(bufferView);
+	const auto byteStride				  = bufferViews.getBaseByteStride(accessor);
 	const auto vertexCount				  = accessor.count;
 	const auto vertexElementLenghtInBytes = numberOfElementPerVertex * geomBuffer->elementSize();
 
-	if(byteStride < 0) throw LoadingError("Can't get valid bytestride from accessor and bufferview. Loading data not possible");
+	//A sparse accessor without bufferView start as all zeros
+	if(!data) memset(geomBuffer->dataAddress(), 0, vertexCount * vertexElementLenghtInBytes);
 
-	//OgreLog("A vertex element on this buffer is " + std::to_string(vertexElementLenghtInBytes) + " bytes long");
-	for(size_t vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++)
+	if(elementScemantic == Ogre::VES_POSITION && elementType == Ogre::VET_FLOAT3)
 	{
-		const auto destOffset   = vertexIndex * vertexElementLenghtInBytes;
-		const auto sourceOffset = elementOffsetInBuffer + vertexIndex * byteStride;
-
-		memcpy((geomBuffer->dataAddress() + destOffset), (buffer.data.data() + sourceOffset), vertexElementLenghtInBytes);
-	}
+		//The min/max of the accessor can be missing or loose : compute the exact bounds while copying the positions.
+		//Sparse values are written over the copy, the bounds are then computed again in place
+		Ogre::Vector3 minBounds, maxBounds;
+		const auto positions = reinterpret_cast<float*>(geomBuffer->dataAddress());
+		if(data) copyPositions(positions, data, byteStride, vertexCount, minBounds, maxBounds);
+		if(!data || accessor.sparse.isSparse)
+		{
+			bufferViews.applySparseValues(accessor, geomBuffer->dataAddress(), vertexElementLenghtInBytes);
+			copyPositions(positions, geomBuffer->dataAddress(), vertexElementLenghtInBytes, vertexCount, minBounds, maxBounds);
+		}
+		bounds.box	  = Ogre::Aabb::newFromExtents(minBounds, maxBounds);
+		bounds.radius = getBoundingRadius(positions, vertexCount, bounds.box.mCenter);
 
-	//Update the bounding sizes once, when vertex positions has been read.
-	if(elementScemantic == Ogre::VES_POSITION)
-	{
-		//Convert to float and load into Ogre::Vector3 objects
-		std::array<Ogre::Real, 3> floatVector {};
-		internal_utils::container_double_to_real(accessor.minValues, floatVector);
-		const Ogre::Vector3 minBounds { floatVector.data() };
-		internal_utils::container_double_to_real(accessor.maxValues, floatVector);
-		const Ogre::Vector3 maxBounds { floatVector.data() };
-
-		OgreLog("Updating bounding box size: ");
 		OgreLog("Setting Min size: " + std::to_string(minBounds.x) + " " + std::to_string(minBounds.y) + " " + std::to_string(minBounds.z));
 		OgreLog("Setting Max size: " + std::to_string(maxBounds.x) + " " + std::to_string(maxBounds.y) + " " + std::to_string(maxBounds.z));
-		boundingBox.merge(Ogre::Aabb::newFromExtents(minBounds, maxBounds));
+	}
+	else
+	{
+		//OgreLog("A vertex element on this buffer is " + std::to_string(vertexElementLenghtInBytes) + " bytes long");
+		for(size_t vertexIndex = 0; data && vertexIndex < vertexCount; vertexIndex++)
+		{
+			const auto destOffset	= vertexIndex * vertexElementLenghtInBytes;
+			const auto sourceOffset = vertexIndex * byteStride;
+
+			memcpy((geomBuffer->dataAddress() + destOffset), (data + sourceOffset), vertexElementLenghtInBytes);
+		}
+		bufferViews.applySparseValues(accessor, geomBuffer->dataAddress(), vertexElementLenghtInBytes);
 	}
 
 	//geometryBuffer->_debugContentToLog();
 	return { std::move(geomBuffer), elementType, elementScemantic, vertexCount, numberOfElementPerVertex };
 }
+
+bool modelConverter::isBakeable(size_t meshIdx) const
+{
+	for(const auto& primitive : model.meshes[meshIdx].primitives)
+	{
+		if(primitive.mode != TINYGLTF_MODE_TRIANGLES) return false;
+		if(primitive.attributes.find("POSITION") == primitive.attributes.end()) return false;
+		if(primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) return false;
+		for(const auto& attribute : primitive.attributes)
+			if(getVertexElementScemantic(attribute.first) == Ogre::VES_COUNT) return false;
+	}
+
+	return true;
+}
+
+size_t modelConverter::getVertexCount(size_t meshIdx) const
+{
+	size_t vertexCount { 0 };
+	for(const auto& primitive : model.meshes[meshIdx].primitives)
+	{
+		const auto position = primitive.attributes.find("POSITION");
+		if(position != primitive.attributes.end()) vertexCount += model.accessors[position->second].count;
+	}
+
+	return vertexCount;
+}
+
+std::vector<Ogre::uint32> modelConverter::extractIndices(int accessorID) const
+{
+	const auto& accessor  = model.accessors[accessorID];
+	const auto data		  = bufferViews.getAccessorData(accessor);
+	const auto byteStride = bufferViews.getAccessorByteStride(accessor);
+	std::vector<Ogre::uint32> indices(accessor.count);
+
+	switch(accessor.componentType)
+	{
+		default: throw LoadingError("Unrecognized index data format");
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: loadIndexBuffer(indices.data(), data, indices.size(), 0, byteStride); break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			loadIndexBuffer(indices.data(), reinterpret_cast<const Ogre::uint16*>(data), indices.size(), 0, byteStride);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_INT:
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+			loadIndexBuffer(indices.data(), reinterpret_cast<const Ogre::uint32*>(data), indices.size(), 0, byteStride);
+			break;
+	}
+
+	return indices;
+}
+
+modelConverter::primitiveGeometry modelConverter::extractPrimitiveGeometry(const tinygltf::Primitive& primitive) const
+{
+	primitiveGeometry geometry;
+	subMeshBounds unusedBounds;
+	for(const auto& attribute : primitive.attributes) geometry.parts.push_back(extractVertexBuffer(attribute, unusedBounds));
+
+	if(primitive.indices >= 0)
+		geometry.indices = extractIndices(primitive.indices);
+	else
+	{
+		//Non indexed geometry : generate the trivial index sequence
+		geometry.indices.resize(geometry.parts.empty() ? 0 : geometry.parts.front().vertexCount);
+		for(size_t i = 0; i < geometry.indices.size(); ++i) geometry.indices[i] = Ogre::uint32(i);
+	}
+
+	return geometry;
+}
+
+Ogre::MeshPtr modelConverter::createBakedMesh(const std::string& name, const std::vector<std::vector<bakedPrimitive>>& subMeshes)
+{
+	auto ogreMesh = Ogre::MeshManager::getSingleton().createManual(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	Ogre::Aabb boundingBox;
+	bool hasBounds { false };
+
+	//The same primitive is usually baked many times, only read it once
+	std::map<std::pair<size_t, size_t>, primitiveGeometry> sources;
+	const auto getSource = [&](const bakedPrimitive& baked) -> primitiveGeometry& {
+		const auto key = std::make_pair(baked.mesh, baked.primitive);
+		auto it		   = sources.find(key);
+		if(it == sources.end()) it = sources.emplace(key, extractPrimitiveGeometry(model.meshes[baked.mesh].primitives[baked.primitive])).first;
+		return it->second;
+	};
+
+	for(const auto& bakedPrimitives : subMeshes)
+	{
+		if(bakedPrimitives.empty()) continue;
+
+		//The first primitive defines the vertex format of the whole submesh
+		const auto& format = getSource(bakedPrimitives.front()).parts;
+		size_t vertexCount { 0 }, indexCount { 0 };
+		for(const auto& baked : bakedPrimitives)
+		{
+			const auto& source = getSource(baked);
+			if(source.parts.size() != format.size()) throw LoadingError("Primitives baked in the same submesh have different vertex formats");
+			for(size_t i = 0; i < format.size(); ++i)
+				if(source.parts[i].type != format[i].type || source.parts[i].semantic != format[i].semantic)
+					throw LoadingError("Primitives baked in the same submesh have different vertex formats");
+
+			vertexCount += source.parts.front().vertexCount;
+			indexCount += source.indices.size();
+		}
+
+		std::vector<vertexBufferPart> parts;
+		for(const auto& part : format)
+		{
+			std::unique_ptr<geometryBuffer_base> buffer;
+			if(part.buffer->elementSize() == sizeof(float))
+				buffer = std::make_unique<geometryBuffer<float>>(vertexCount * part.perVertex);
+			else
+				buffer = std::make_unique<geometryBuffer<unsigned short>>(vertexCount * part.perVertex);
+			parts.push_back({ std::move(buffer), part.type, part.semantic, vertexCount, part.perVertex });
+		}
+
+		std::vector<Ogre::uint32> indices;
+		indices.reserve(indexCount);
+		size_t baseVertex { 0 };
+
+		for(const auto& baked : bakedPrimitives)
+		{
+			auto& source				 = getSource(baked);
+			const auto sourceVertexCount = source.parts.front().vertexCount;
+			Ogre::Matrix3 linear;
+			baked.transform.extract3x3Matrix(linear);
+			const auto normalMatrix = linear.Inverse().Transpose();
+
+			//A mirroring transform turns the triangles inside out, and flips the bitangent computed from the normal and the tangent
+			const auto mirrored = linear.Determinant() < 0;
+
+			for(size_t i = 0; i < parts.size(); ++i)
+			{
+				const auto stride = parts[i].getPartStride();
+				auto destination  = parts[i].buffer->dataAddress() + baseVertex * stride;
+				memcpy(destination, source.parts[i].buffer->dataAddress(), sourceVertexCount * stride);
+
+				if(parts[i].buffer->elementSize() != sizeof(float) || parts[i].perVertex < 3) continue;
+				auto vectors = reinterpret_cast<float*>(destination);
+				for(size_t vertex = 0; vertex < sourceVertexCount; ++vertex)
+				{
+					auto vector = vectors + vertex * parts[i].perVertex;
+					Ogre::Vector3 value { vector[0], vector[1], vector[2] };
+					switch(parts[i].semantic)
+					{
+						case Ogre::VES_POSITION:
+							value = baked.transform.transformAffine(value);
+							if(hasBounds)
+								boundingBox.merge(value);
+							else
+								boundingBox = Ogre::Aabb(value, Ogre::Vector3::ZERO);
+							hasBounds = true;
+							break;
+						case Ogre::VES_NORMAL: value = (normalMatrix * value).normalisedCopy(); break;
+						case Ogre::VES_TANGENT:
+							value = (linear * value).normalisedCopy();
+							if(mirrored && parts[i].perVertex == 4) vector[3] = -vector[3];
+							break;
+						default: continue;
+					}
+					vector[0] = value.x;
+					vector[1] = value.y;
+					vector[2] = value.z;
+				}
+			}
+
+			//Restore the winding order of the mirrored triangles
+			for(size_t i = 0; i + 2 < source.indices.size(); i += 3)
+			{
+				indices.push_back(Ogre::uint32(baseVertex + source.indices[i]));
+				indices.push_back(Ogre::uint32(baseVertex + source.indices[mirrored ? i + 2 : i + 1]));
+				indices.push_back(Ogre::uint32(baseVertex + source.indices[mirrored ? i + 1 : i + 2]));
+			}
+
+			baseVertex += sourceVertexCount;
+		}
+
+		Ogre::IndexBufferPacked* indexBuffer;
+		if(vertexCount <= (std::numeric_limits<Ogre::uint16>::max)())
+		{
+			geometryBuffer<Ogre::uint16> geomBuffer(indices.size());
+			std::copy(indices.begin(), indices.end(), geomBuffer.data());
+			indexBuffer = getVaoManager()->createIndexBuffer(Ogre::IndexBufferPacked::IT_16BIT, indices.size(), Ogre::BT_IMMUTABLE, geomBuffer.dataAddress(), false);
+		}
+		else
+		{
+			geometryBuffer<Ogre::uint32> geomBuffer(indices.size());
+			std::copy(indices.begin(), indices.end(), geomBuffer.data());
+			indexBuffer = getVaoManager()->createIndexBuffer(Ogre::IndexBufferPacked::IT_32BIT, indices.size(), Ogre::BT_IMMUTABLE, geomBuffer.dataAddress(), false);
+		}
+
+		auto subMesh = ogreMesh->createSubMesh();
+		auto vao	 = getVaoManager()->createVertexArrayObject(constructVertexBuffer(parts), indexBuffer, Ogre::OT_TRIANGLE_LIST);
+		subMesh->mVao[Ogre::VpNormal].push_back(vao);
+		subMesh->mVao[Ogre::VpShadow].push_back(vao);
+	}
+
+	ogreMesh->_setBounds(boundingBox, true);
+	acquireMesh(name);
+	return ogreMesh;
+}
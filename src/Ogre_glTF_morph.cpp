@@ -0,0 +1,207 @@
+#include "Ogre_glTF_morph.hpp"
+#include "Ogre_glTF_morphTargetImporter.hpp"
+#include "Ogre_glTF_threadPool.hpp"
+#include "Ogre_glTF_simd.hpp"
+#include "Ogre_glTF_common.hpp"
+#include <OgreMeshManager2.h>
+#include <Vao/OgreVertexBufferPacked.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace Ogre_glTF;
+
+namespace
+{
+	///Add weight * delta to the position, and to the normal if there's one, of each moved vertex.
+	///The vectors of the vertices are accessed 3 floats at a time, so that stores of consecutive vertices never overlap. The deltas are padded to 4 floats
+	/// \param vertices interleaved vertex data we are blending
+	/// \param floatsPerVertex stride of the vertex data in floats. The position is at the start of the vertex, and the normal just after it
+	/// \param target sparse deltas of the target
+	/// \param weight weight of the target
+	void accumulateDeltas(float* vertices, size_t floatsPerVertex, const morphTargetData& target, float weight)
+	{
+		const auto count	 = target.vertices.size();
+		const auto moved	 = target.vertices.data();
+		const auto positions = target.positionDeltas.data();
+		const auto normals	 = target.normalDeltas.empty() ? nullptr : target.normalDeltas.data();
+#if Ogre_glTF_SIMD_SSE2
+		const auto weights = _mm_set1_ps(weight);
+		for(size_t i = 0; i < count; ++i)
+		{
+			auto vertex = vertices + moved[i] * floatsPerVertex;
+			simd::store3(vertex, _mm_add_ps(simd::load3(vertex), _mm_mul_ps(weights, _mm_loadu_ps(positions + i * 4))));
+			if(normals) simd::store3(vertex + 3, _mm_add_ps(simd::load3(vertex + 3), _mm_mul_ps(weights, _mm_loadu_ps(normals + i * 4))));
+		}
+#else
+		for(size_t i = 0; i < count; ++i)
+		{
+			auto vertex = vertices + moved[i] * floatsPerVertex;
+			for(size_t c = 0; c < 3; ++c) vertex[c] += weight * positions[i * 4 + c];
+			if(normals)
+				for(size_t c = 0; c < 3; ++c) vertex[3 + c] += weight * normals[i * 4 + c];
+		}
+#endif
+	}
+
+	///Blend all the targets of a primitive
+	/// \param primitive the morph targets of the primitive
+	/// \param weights weight of each target
+	/// \param output where to write the blended vertices
+	void blendPrimitive(const morphPrimitiveData& primitive, const std::vector<float>& weights, std::vector<float>& output)
+	{
+		std::copy(primitive.baseVertices.begin(), primitive.baseVertices.end(), output.begin());
+
+		for(size_t i = 0; i < primitive.targets.size(); ++i)
+		{
+			if(weights[i] == 0) continue;
+			accumulateDeltas(output.data(), primitive.floatsPerVertex, primitive.targets[i], weights[i]);
+		}
+	}
+}
+
+morphController::morphController(Ogre::Item* morphedItem,
+								 std::shared_ptr<const morphMeshData> data,
+								 std::vector<Ogre::VertexBufferPacked*> buffers,
+								 std::shared_ptr<const morphAnimationList> weightAnimations,
+								 std::vector<float> initialWeights) :
+ item { morphedItem },
+ mesh { morphedItem->getMesh() },
+ morphData { std::move(data) },
+ animations { std::move(weightAnimations) },
+ vertexBuffers { std::move(buffers) },
+ weights { std::move(initialWeights) }
+{
+	weights.resize(morphData->defaultWeights.size(), 0.0f);
+
+	for(const auto& primitive : morphData->primitives) blendedVertices.emplace_back(primitive.baseVertices.size(), 0.0f);
+}
+
+morphController::~morphController()
+{
+	//Adapters can outlive Ogre, the mesh is gone with the MeshManager then
+	const auto meshManager = Ogre::MeshManager::getSingletonPtr();
+	if(mesh && meshManager) meshManager->remove(mesh->getName());
+}
+
+Ogre::Item* morphController::getItem() const { return item; }
+
+size_t morphController::getTargetCount() const { return weights.size(); }
+
+std::string morphController::getTargetName(size_t target) const { return morphData->targetNames.at(target); }
+
+float morphController::getWeight(size_t target) const { return weights.at(target); }
+
+void morphController::setWeight(size_t target, float weight)
+{
+	if(weights.at(target) == weight) return;
+	weights[target] = weight;
+	weightsChanged	= true;
+}
+
+std::vector<std::string> morphController::getAnimationNames() const
+{
+	std::vector<std::string> names;
+	for(const auto& animation : animations->animations) names.push_back(animation.name);
+	return names;
+}
+
+float morphController::getAnimationLength(const std::string& animation) const
+{
+	for(const auto& weightAnimation : animations->animations)
+		if(weightAnimation.name == animation) return weightAnimation.times.empty() ? 0 : weightAnimation.times.back();
+	return 0;
+}
+
+bool morphController::setAnimationTime(const std::string& animation, float time)
+{
+	const auto weightAnimation = std::find_if(
+		animations->animations.begin(), animations->animations.end(), [&](const morphWeightAnimation& candidate) { return candidate.name == animation; });
+	if(weightAnimation == animations->animations.end()) return false;
+
+	const auto& times = weightAnimation->times;
+	if(times.empty()) return true;
+
+	const auto targetCount = weights.size();
+	const auto isCubic	   = weightAnimation->interpolation == morphWeightAnimation::interpolationType::cubicSpline;
+	const auto frameSize   = isCubic ? 3 * targetCount : targetCount;
+	const auto valueOffset = isCubic ? targetCount : 0;
+	if(weightAnimation->weights.size() < times.size() * frameSize) return false;
+	const auto frame = [&](size_t keyFrame) { return weightAnimation->weights.data() + keyFrame * frameSize; };
+
+	//Find the keyframes around the time
+	const auto next = size_t(std::upper_bound(times.begin(), times.end(), time) - times.begin());
+	if(next == 0 || next == times.size())
+	{
+		const auto keyFrame = next == 0 ? 0 : times.size() - 1;
+		for(size_t i = 0; i < targetCount; ++i) setWeight(i, frame(keyFrame)[valueOffset + i]);
+		return true;
+	}
+
+	const auto previous = next - 1;
+	const auto duration = times[next] - times[previous];
+	const auto t		= duration > 0 ? (time - times[previous]) / duration : 0.0f;
+
+	for(size_t i = 0; i < targetCount; ++i)
+	{
+		switch(weightAnimation->interpolation)
+		{
+			case morphWeightAnimation::interpolationType::step: setWeight(i, frame(previous)[i]); break;
+			case morphWeightAnimation::interpolationType::linear: setWeight(i, frame(previous)[i] * (1 - t) + frame(next)[i] * t); break;
+			case morphWeightAnimation::interpolationType::cubicSpline:
+			{
+				//Hermite spline, with the out-tangent of the previous keyframe and the in-tangent of the next one
+				const auto t2 = t * t, t3 = t2 * t;
+				setWeight(i,
+						  (2 * t3 - 3 * t2 + 1) * frame(previous)[targetCount + i] + (t3 - 2 * t2 + t) * duration * frame(previous)[2 * targetCount + i]
+							  + (-2 * t3 + 3 * t2) * frame(next)[targetCount + i] + (t3 - t2) * duration * frame(next)[i]);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+morphBlender::morphBlender(size_t threadCount) : threads { std::make_unique<threadPool>(threadCount) } {}
+
+morphBlender::~morphBlender() = default;
+
+void morphBlender::addController(std::shared_ptr<morphController> controller) { controllers.push_back(std::move(controller)); }
+
+void morphBlender::removeController(const std::shared_ptr<morphController>& controller)
+{
+	controllers.erase(std::remove(controllers.begin(), controllers.end(), controller), controllers.end());
+}
+
+void morphBlender::blend()
+{
+	//Each primitive of each controller is blended independently
+	std::vector<std::pair<morphController*, size_t>> jobs;
+	for(const auto& controller : controllers)
+	{
+		if(!controller->weightsChanged) continue;
+		for(size_t i = 0; i < controller->morphData->primitives.size(); ++i) jobs.emplace_back(controller.get(), i);
+		controller->weightsChanged = false;
+		controller->uploadPending  = true;
+	}
+
+	threads->parallelFor(jobs.size(), [&](size_t i) {
+		const auto controller = jobs[i].first;
+		const auto primitive  = jobs[i].second;
+		blendPrimitive(controller->morphData->primitives[primitive], controller->weights, controller->blendedVertices[primitive]);
+	});
+}
+
+void morphBlender::update()
+{
+	blend();
+
+	//Ogre can only be called from the thread that render
+	for(const auto& controller : controllers)
+	{
+		if(!controller->uploadPending) continue;
+		for(size_t i = 0; i < controller->vertexBuffers.size(); ++i)
+			controller->vertexBuffers[i]->upload(controller->blendedVertices[i].data(), 0, controller->morphData->primitives[i].vertexCount);
+		controller->uploadPending = false;
+	}
+}
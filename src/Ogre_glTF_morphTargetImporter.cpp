@@ -0,0 +1,163 @@
+#include "Ogre_glTF_morphTargetImporter.hpp"
+#include "Ogre_glTF_common.hpp"
+#include "Ogre_glTF.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Ogre_glTF;
+
+morphTargetImporter::morphTargetImporter(tinygltf::Model& input, accessorReader& reader) : model { input }, accessors { reader } {}
+
+bool morphTargetImporter::isMorphable(size_t meshIdx) const
+{
+	const auto& mesh = model.meshes[meshIdx];
+	if(mesh.primitives.empty()) return false;
+
+	const auto isFloat = [&](const std::map<std::string, int>& attributes, const std::string& name) {
+		const auto attribute = attributes.find(name);
+		return attribute == attributes.end() || model.accessors[attribute->second].componentType == TINYGLTF_COMPONENT_TYPE_FLOAT;
+	};
+
+	for(const auto& primitive : mesh.primitives)
+	{
+		if(primitive.targets.empty() || primitive.targets.size() != mesh.primitives.front().targets.size()) return false;
+		if(primitive.attributes.find("POSITION") == primitive.attributes.end()) return false;
+
+		//The blended attributes are uploaded as floats, the vertex buffer needs to store them as floats too
+		if(!isFloat(primitive.attributes, "POSITION") || !isFloat(primitive.attributes, "NORMAL")) return false;
+	}
+
+	return true;
+}
+
+morphPrimitiveData morphTargetImporter::loadPrimitive(const tinygltf::Primitive& primitive, std::vector<Ogre::Vector3>& displacements)
+{
+	morphPrimitiveData data;
+
+	std::vector<float> positions, normals;
+	accessors.readFloats(primitive.attributes.at("POSITION"), positions);
+	const auto normalAttribute = primitive.attributes.find("NORMAL");
+	if(normalAttribute != primitive.attributes.end()) accessors.readFloats(normalAttribute->second, normals);
+
+	data.vertexCount	 = positions.size() / 3;
+	data.floatsPerVertex = normals.empty() ? 3 : 6;
+
+	//Interleave the attributes the same way they are in the vertex buffer
+	data.baseVertices.resize(data.vertexCount * data.floatsPerVertex);
+	for(size_t vertex = 0; vertex < data.vertexCount; ++vertex)
+	{
+		std::copy_n(&positions[vertex * 3], 3, &data.baseVertices[vertex * data.floatsPerVertex]);
+		if(!normals.empty()) std::copy_n(&normals[vertex * 3], 3, &data.baseVertices[vertex * data.floatsPerVertex + 3]);
+	}
+
+	for(size_t targetIdx = 0; targetIdx < primitive.targets.size(); ++targetIdx)
+	{
+		const auto& target = primitive.targets[targetIdx];
+
+		//Only read the vertices that are moved by the target. Sparse targets are never expanded to the whole primitive
+		std::vector<Ogre::uint32> positionVertices, normalVertices;
+		std::vector<float> positionDeltas, normalDeltas;
+		const auto positionAttribute = target.find("POSITION");
+		if(positionAttribute != target.end()) accessors.readNonZeroFloats(positionAttribute->second, positionVertices, positionDeltas);
+		const auto normalDeltaAttribute = target.find("NORMAL");
+		if(!normals.empty() && normalDeltaAttribute != target.end()) accessors.readNonZeroFloats(normalDeltaAttribute->second, normalVertices, normalDeltas);
+
+		for(const auto attribute : { positionAttribute, normalDeltaAttribute })
+			if(attribute != target.end() && model.accessors[attribute->second].count != data.vertexCount)
+				throw LoadingError("Morph target " + std::to_string(targetIdx) + " doesn't have the same number of vertices as its primitive");
+
+		//Merge the two sorted lists of moved vertices
+		morphTargetData targetData;
+		Ogre::Vector3 displacement { Ogre::Vector3::ZERO };
+		const auto end = std::numeric_limits<Ogre::uint32>::max();
+		size_t positionIdx { 0 }, normalIdx { 0 };
+		while(positionIdx < positionVertices.size() || normalIdx < normalVertices.size())
+		{
+			const auto positionVertex = positionIdx < positionVertices.size() ? positionVertices[positionIdx] : end;
+			const auto normalVertex	  = normalIdx < normalVertices.size() ? normalVertices[normalIdx] : end;
+			const auto vertex		  = std::min(positionVertex, normalVertex);
+			targetData.vertices.push_back(vertex);
+
+			const auto positionDelta = vertex == positionVertex ? &positionDeltas[3 * positionIdx++] : nullptr;
+			for(size_t i = 0; i < 3; ++i)
+			{
+				const auto delta = positionDelta ? positionDelta[i] : 0.0f;
+				targetData.positionDeltas.push_back(delta);
+				displacement[i] = std::max(displacement[i], std::abs(delta));
+			}
+			targetData.positionDeltas.push_back(0);
+
+			if(!normals.empty())
+			{
+				const auto normalDelta = vertex == normalVertex ? &normalDeltas[3 * normalIdx++] : nullptr;
+				for(size_t i = 0; i < 3; ++i) targetData.normalDeltas.push_back(normalDelta ? normalDelta[i] : 0.0f);
+				targetData.normalDeltas.push_back(0);
+			}
+		}
+
+		if(displacements.size() <= targetIdx) displacements.resize(targetIdx + 1, Ogre::Vector3::ZERO);
+		displacements[targetIdx].makeCeil(displacement);
+		data.targets.push_back(std::move(targetData));
+	}
+
+	return data;
+}
+
+std::shared_ptr<const morphMeshData> morphTargetImporter::getMorphData(size_t meshIdx)
+{
+	const auto loaded = loadedMeshes.find(meshIdx);
+	if(loaded != loadedMeshes.end()) return loaded->second;
+
+	const auto& mesh = model.meshes[meshIdx];
+	auto data		 = std::make_shared<morphMeshData>();
+	data->meshIndex	 = meshIdx;
+
+	std::vector<Ogre::Vector3> displacements;
+	for(const auto& primitive : mesh.primitives) data->primitives.push_back(loadPrimitive(primitive, displacements));
+
+	//The displacements of the targets add up when they are all fully applied
+	for(const auto& displacement : displacements) data->maxDisplacement += displacement;
+
+	const auto targetCount = data->primitives.empty() ? 0 : data->primitives.front().targets.size();
+	data->defaultWeights.assign(targetCount, 0.0f);
+	for(size_t i = 0; i < std::min(targetCount, mesh.weights.size()); ++i) data->defaultWeights[i] = float(mesh.weights[i]);
+
+	//Target names are not part of the specification, but most exporters write them in the extras of the mesh
+	if(mesh.extras.IsObject() && mesh.extras.Has("targetNames") && mesh.extras.Get("targetNames").IsArray())
+	{
+		const auto& names = mesh.extras.Get("targetNames");
+		for(size_t i = 0; i < names.ArrayLen(); ++i) data->targetNames.push_back(names.Get(int(i)).IsString() ? names.Get(int(i)).Get<std::string>() : "");
+	}
+	data->targetNames.resize(targetCount);
+
+	OgreLog("Loaded " + std::to_string(targetCount) + " morph targets for mesh " + mesh.name);
+	loadedMeshes[meshIdx] = data;
+	return data;
+}
+
+std::shared_ptr<const morphAnimationList> morphTargetImporter::getWeightAnimations(size_t nodeIdx)
+{
+	auto list = std::make_shared<morphAnimationList>();
+
+	for(size_t animationIdx = 0; animationIdx < model.animations.size(); ++animationIdx)
+	{
+		const auto& animation = model.animations[animationIdx];
+		for(const auto& channel : animation.channels)
+		{
+			if(channel.target_node != int(nodeIdx) || channel.target_path != "weights") continue;
+
+			const auto& sampler = animation.samplers[channel.sampler];
+			morphWeightAnimation weightAnimation;
+			weightAnimation.name = !animation.name.empty() ? animation.name : "morphAnimation" + std::to_string(animationIdx);
+			if(sampler.interpolation == "STEP") weightAnimation.interpolation = morphWeightAnimation::interpolationType::step;
+			if(sampler.interpolation == "CUBICSPLINE") weightAnimation.interpolation = morphWeightAnimation::interpolationType::cubicSpline;
+
+			accessors.readFloats(sampler.input, weightAnimation.times);
+			accessors.readFloats(sampler.output, weightAnimation.weights);
+			list->animations.push_back(std::move(weightAnimation));
+		}
+	}
+
+	return list;
+}
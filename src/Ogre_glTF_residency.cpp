@@ -0,0 +1,239 @@
+#include "Ogre_glTF_residency.hpp"
+#include "Ogre_glTF_textureRegistry.hpp"
+#include "Ogre_glTF_common.hpp"
+#include <OgreLogManager.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreRoot.h>
+#include <OgreMesh2.h>
+#include <OgreSubMesh2.h>
+#include <OgreMeshManager2.h>
+#include <OgreHlmsManager.h>
+#include <OgreHlms.h>
+#include <OgreHlmsPbsDatablock.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <unordered_set>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///State of the residencyManager
+	struct residencyManagerState
+	{
+		///A tracked resource
+		struct resource
+		{
+			///System memory used by the resource, in bytes
+			size_t cpuMemory;
+
+			///Video memory used by the resource, in bytes
+			size_t gpuMemory;
+
+			///Number of adapters that hold the resource
+			size_t references;
+
+			///Last frame the resource was held or used by an item
+			unsigned long lastUse;
+		};
+
+		///The tracked resources, by kind and name
+		std::map<std::pair<residencyManager::Kind, std::string>, resource> resources;
+
+		///Memory budgets, in bytes
+		size_t cpuBudget = std::numeric_limits<size_t>::max(), gpuBudget = std::numeric_limits<size_t>::max();
+
+		///Number of resources evicted so far
+		size_t evictedCount = 0;
+	};
+}
+
+using namespace Ogre_glTF;
+
+namespace
+{
+	///What a tracked resource is used for
+	enum class Status { Gone, InUse, Unused };
+
+	///Get the frame that is being prepared, used as the time of the last use of the resources
+	unsigned long getFrame()
+	{
+		const auto root = Ogre::Root::getSingletonPtr();
+		return root ? root->getNextFrameNumber() : 0;
+	}
+
+	///Get the Hlms PBS, where the datablocks are
+	Ogre::Hlms* getHlmsPbs() { return Ogre::Root::getSingleton().getHlmsManager()->getHlms(Ogre::HLMS_PBS); }
+
+	///Add the size of the vertex and index buffers of a mesh to its memory. Buffers shared by several vertex array objects are only counted once
+	/// \param mesh the mesh
+	/// \param cpuMemory where to add the size of the shadow copies of the buffers
+	/// \param gpuMemory where to add the size of the buffers
+	void addMeshMemory(const Ogre::MeshPtr& mesh, size_t& cpuMemory, size_t& gpuMemory)
+	{
+		std::unordered_set<const Ogre::BufferPacked*> counted;
+		const auto count = [&](const Ogre::BufferPacked* buffer) {
+			if(!buffer || !counted.insert(buffer).second) return;
+			gpuMemory += buffer->getTotalSizeBytes();
+			if(buffer->getShadowCopy()) cpuMemory += buffer->getTotalSizeBytes();
+		};
+
+		for(unsigned s = 0; s < mesh->getNumSubMeshes(); ++s)
+			for(const auto& vaos : mesh->getSubMesh(s)->mVao)
+				for(const auto vao : vaos)
+				{
+					for(const auto buffer : vao->getVertexBuffers()) count(buffer);
+					count(vao->getIndexBuffer());
+				}
+	}
+
+	///Check what a resource is used for
+	/// \param kind kind of the resource
+	/// \param name name of the resource
+	/// \param references number of adapters that hold the resource
+	Status getStatus(residencyManager::Kind kind, const std::string& name, size_t references)
+	{
+		if(kind == residencyManager::Kind::Mesh)
+		{
+			//When no item uses the mesh, the resource system and this pointer are the only owners
+			const auto mesh = Ogre::MeshManager::getSingleton().getByName(name);
+			if(!mesh) return Status::Gone;
+			if(references > 0) return Status::InUse;
+			return mesh.useCount() > Ogre::ResourceGroupManager::RESOURCE_SYSTEM_NUM_REFERENCE_COUNTS + 1 ? Status::InUse : Status::Unused;
+		}
+
+		const auto datablock = getHlmsPbs()->getDatablock(Ogre::IdString(name));
+		if(!datablock) return Status::Gone;
+		return references > 0 || !datablock->getLinkedRenderables().empty() ? Status::InUse : Status::Unused;
+	}
+
+	///Destroy a resource that is not used
+	/// \param kind kind of the resource
+	/// \param name name of the resource
+	void evict(residencyManager::Kind kind, const std::string& name)
+	{
+		if(kind == residencyManager::Kind::Mesh)
+		{
+			OgreLog("Evicting the mesh " + name);
+			Ogre::MeshManager::getSingleton().remove(name);
+			return;
+		}
+
+		//The textures only this datablock was using go with it
+		OgreLog("Evicting the datablock " + name);
+		getHlmsPbs()->destroyDatablock(Ogre::IdString(name));
+		textureRegistry::collect();
+	}
+}
+
+residencyManager::residencyManager() : state { std::make_unique<residencyManagerState>() } {}
+
+residencyManager::~residencyManager() = default;
+
+residencyManager& residencyManager::getSingleton()
+{
+	static residencyManager manager;
+	return manager;
+}
+
+void residencyManager::setBudget(size_t cpuBytes, size_t gpuBytes)
+{
+	state->cpuBudget = cpuBytes;
+	state->gpuBudget = gpuBytes;
+}
+
+void residencyManager::acquire(Kind kind, const std::string& name)
+{
+	const auto key = std::make_pair(kind, name);
+	auto found	   = state->resources.find(key);
+	if(found == state->resources.end())
+	{
+		//The size is measured once, the resources made by the adapters don't change once they are created
+		residencyManagerState::resource resource { 0, 0, 0, getFrame() };
+		if(kind == Kind::Mesh)
+		{
+			const auto mesh = Ogre::MeshManager::getSingleton().getByName(name);
+			if(!mesh) return;
+			addMeshMemory(mesh, resource.cpuMemory, resource.gpuMemory);
+		}
+		else
+			resource.cpuMemory = sizeof(Ogre::HlmsPbsDatablock);
+		found = state->resources.insert({ key, resource }).first;
+	}
+
+	++found->second.references;
+	found->second.lastUse = getFrame();
+}
+
+void residencyManager::release(Kind kind, const std::string& name)
+{
+	const auto found = state->resources.find({ kind, name });
+	if(found == state->resources.end() || found->second.references == 0) return;
+	--found->second.references;
+	found->second.lastUse = getFrame();
+}
+
+size_t residencyManager::update()
+{
+	//Adapters can outlive Ogre, there is nothing to evict then
+	if(!Ogre::Root::getSingletonPtr() || !Ogre::MeshManager::getSingletonPtr()) return 0;
+	const auto frame = getFrame();
+
+	//Forget the resources the application destroyed, and find the ones nothing uses anymore
+	std::vector<decltype(state->resources)::iterator> unused;
+	for(auto resource = state->resources.begin(); resource != state->resources.end();)
+	{
+		const auto status = getStatus(resource->first.first, resource->first.second, resource->second.references);
+		if(status == Status::Gone)
+		{
+			resource = state->resources.erase(resource);
+			continue;
+		}
+		if(status == Status::InUse)
+			resource->second.lastUse = frame;
+		else
+			unused.push_back(resource);
+		++resource;
+	}
+
+	//Evict the least recently used resources first, until both budgets are respected
+	std::stable_sort(unused.begin(), unused.end(), [](decltype(state->resources)::iterator a, decltype(state->resources)::iterator b) {
+		return a->second.lastUse < b->second.lastUse;
+	});
+	auto cpuMemory = getCpuMemory();
+	auto gpuMemory = getGpuMemory();
+	size_t evicted { 0 };
+	for(const auto resource : unused)
+	{
+		if(cpuMemory <= state->cpuBudget && gpuMemory <= state->gpuBudget) break;
+
+		const auto kind = resource->first.first;
+		cpuMemory -= resource->second.cpuMemory;
+		gpuMemory -= resource->second.gpuMemory;
+		evict(kind, resource->first.second);
+		state->resources.erase(resource);
+		++evicted;
+
+		//Evicting a datablock can free textures, they are counted again
+		if(kind == Kind::Datablock) gpuMemory = getGpuMemory();
+	}
+
+	state->evictedCount += evicted;
+	return evicted;
+}
+
+size_t residencyManager::getCpuMemory() const
+{
+	size_t memory { 0 };
+	for(const auto& resource : state->resources) memory += resource.second.cpuMemory;
+	return memory;
+}
+
+size_t residencyManager::getGpuMemory() const
+{
+	size_t memory { textureRegistry::getMemory() };
+	for(const auto& resource : state->resources) memory += resource.second.gpuMemory;
+	return memory;
+}
+
+size_t residencyManager::getEvictedCount() const { return state->evictedCount; }
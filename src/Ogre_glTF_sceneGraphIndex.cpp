@@ -0,0 +1,109 @@
+#include "Ogre_glTF_sceneGraphIndex.hpp"
+#include "Ogre_glTF_common.hpp"
+#include "Ogre_glTF.hpp"
+
+using namespace Ogre_glTF;
+
+sceneGraphIndex::sceneGraphIndex(tinygltf::Model& input) : model { input } {}
+
+void sceneGraphIndex::build()
+{
+	const auto nodeCount = model.nodes.size();
+	joints.assign(nodeCount, false);
+	parents.assign(nodeCount, -1);
+	subtreeSizes.assign(nodeCount, 1);
+	orderPositions.assign(nodeCount, 0);
+	order.clear();
+	order.reserve(nodeCount);
+
+	for(size_t nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx)
+		for(const auto child : model.nodes[nodeIdx].children)
+		{
+			if(child < 0 || size_t(child) >= nodeCount) throw LoadingError("Node " + std::to_string(nodeIdx) + " has an invalid child");
+			if(parents[child] >= 0)
+			{
+				OgreLog("Node " + std::to_string(child) + " has more than one parent, only the first one is used");
+				continue;
+			}
+			parents[child] = int(nodeIdx);
+		}
+
+	//A joint is a root of its skin when its parent isn't a joint of the same skin
+	std::vector<int> skinOfJoint(nodeCount, -1);
+	skinRoots.assign(model.skins.size(), {});
+	for(size_t skinIdx = 0; skinIdx < model.skins.size(); ++skinIdx)
+	{
+		const auto& skinJoints = model.skins[skinIdx].joints;
+		for(const auto joint : skinJoints)
+		{
+			joints[joint]	   = true;
+			skinOfJoint[joint] = int(skinIdx);
+		}
+		for(const auto joint : skinJoints)
+			if(parents[joint] < 0 || skinOfJoint[parents[joint]] != int(skinIdx)) skinRoots[skinIdx].push_back(joint);
+	}
+
+	//Depth first walk from every root node, with an explicit stack. Children are pushed in reverse to be visited in the file's order
+	std::vector<int> pending;
+	for(size_t root = 0; root < nodeCount; ++root)
+	{
+		if(parents[root] >= 0) continue;
+		pending.push_back(int(root));
+		while(!pending.empty())
+		{
+			const auto nodeIdx = pending.back();
+			pending.pop_back();
+			orderPositions[nodeIdx] = order.size();
+			order.push_back(nodeIdx);
+
+			const auto& children = model.nodes[nodeIdx].children;
+			for(auto child = children.rbegin(); child != children.rend(); ++child)
+				if(parents[*child] == nodeIdx) pending.push_back(*child);
+		}
+	}
+
+	//Nodes that can't be reached from a root are part of a cycle
+	if(order.size() != nodeCount) throw LoadingError("The node hierarchy of the glTF file contains a cycle");
+
+	//Children are after their parent in the order, so walking it backward sums the subtrees from the leaves up
+	for(auto position = order.rbegin(); position != order.rend(); ++position)
+		if(parents[*position] >= 0) subtreeSizes[parents[*position]] += subtreeSizes[*position];
+
+	built = true;
+}
+
+bool sceneGraphIndex::isJoint(size_t node)
+{
+	if(!built) build();
+	return joints[node];
+}
+
+int sceneGraphIndex::getParent(size_t node)
+{
+	if(!built) build();
+	return parents[node];
+}
+
+const std::vector<int>& sceneGraphIndex::getSkinRoots(size_t skin)
+{
+	if(!built) build();
+	return skinRoots[skin];
+}
+
+const std::vector<int>& sceneGraphIndex::getTopologicalOrder()
+{
+	if(!built) build();
+	return order;
+}
+
+size_t sceneGraphIndex::getOrderPosition(size_t node)
+{
+	if(!built) build();
+	return orderPositions[node];
+}
+
+size_t sceneGraphIndex::getSubtreeSize(size_t node)
+{
+	if(!built) build();
+	return subtreeSizes[node];
+}
@@ -6,6 +6,8 @@
 #include <OgreOldBone.h>
 #include <OgreLogManager.h>
 #include <OgreKeyFrame.h>
+#include <algorithm>
+#include <unordered_map>
 #include "Ogre_glTF.hpp"
 
 using namespace Ogre_glTF;
@@ -14,9 +16,16 @@ int skeletonImporter::skeletonID = 0;
 
 void skeletonImporter::addChidren(const std::vector<int>& childs, Ogre::v1::OldBone* parent)
 {
+	//Walk the hierarchy with an explicit stack, deep skeletons would overflow the call stack. Children are pushed in reverse to keep the file's order
+	std::vector<std::pair<int, Ogre::v1::OldBone*>> pending;
+	for(auto child = childs.rbegin(); child != childs.rend(); ++child) pending.emplace_back(*child, parent);
 
-	for(auto child : childs)
+	while(!pending.empty())
 	{
+		const auto child	  = pending.back().first;
+		const auto parentBone = pending.back().second;
+		pending.pop_back();
+
 		const auto& node = model.nodes[child];
 		
 		if(node.mesh >= 0)
@@ -28,7 +37,7 @@ void skeletonImporter::addChidren(const std::vector<int>& childs, Ogre::v1::OldB
 		auto bone = skeleton->getBone(nodeToJointMap[child]);
 		if(!bone) { throw InitError("could not get bone " + std::to_string(bone->getHandle())); }
 
-		parent->addChild(bone);
+		parentBone->addChild(bone);
 
 		auto bindMatrix = bindMatrices[nodeToJointMap[child]];
 
@@ -37,11 +46,11 @@ void skeletonImporter::addChidren(const std::vector<int>& childs, Ogre::v1::OldB
 
 		bindMatrix.decomposition(translation, scale, rotation);
 
-		bone->setPosition(parent->convertWorldToLocalPosition(translation));
-		bone->setOrientation(parent->convertWorldToLocalOrientation(rotation));
-		bone->setScale(parent->_getDerivedScale() / scale);
+		bone->setPosition(parentBone->convertWorldToLocalPosition(translation));
+		bone->setOrientation(parentBone->convertWorldToLocalOrientation(rotation));
+		bone->setScale(parentBone->_getDerivedScale() / scale);
 
-		addChidren(model.nodes[child].children, bone);
+		for(auto grandChild = node.children.rbegin(); grandChild != node.children.rend(); ++grandChild) pending.emplace_back(*grandChild, bone);
 	}
 }
 
@@ -77,164 +86,95 @@ void skeletonImporter::loadBoneHierarchy(int boneIndex)
 	addChidren(node.children, rootBone);
 }
 
-skeletonImporter::skeletonImporter(tinygltf::Model& input) : model { input } {}
-
-void skeletonImporter::loadTimepointFromSamplerToKeyFrame(int bone, int frameID, int& count, keyFrame& animationFrame, tinygltf::AnimationSampler& sampler)
+skeletonImporter::skeletonImporter(
+	tinygltf::Model& input, bufferViewDecoder& decoder, accessorReader& reader, sceneGraphIndex& index, const importOptions& importSettings) :
+ model { input }, bufferViews { decoder }, accessors { reader }, sceneGraph { index }, options { importSettings }
 {
-	auto& input				 = model.accessors[sampler.input];
-	count					 = static_cast<int>(input.count);
-	auto& bufferView		 = model.bufferViews[input.bufferView];
-	auto& buffer			 = model.buffers[bufferView.buffer];
-	unsigned char* dataStart = buffer.data.data() + bufferView.byteOffset + input.byteOffset;
-	const size_t byteStride  = input.ByteStride(bufferView);
-
-	assert(input.type == TINYGLTF_TYPE_SCALAR); //Need to be a scalar, since it's a timepoint
-	float data;
-	if(input.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) { data = *reinterpret_cast<float*>(dataStart + frameID * byteStride); }
-	else if(input.componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE)
-	{
-		data = static_cast<float>(*reinterpret_cast<double*>(dataStart + frameID * byteStride));
-	}
-
-	if(animationFrame.timePoint < 0)
-		animationFrame.timePoint = data;
-	else if(animationFrame.timePoint != data)
-	{
-		throw FileIOError("Mismatch of timecode while loading an animation keyframe for bone joint " + std::to_string(bone)
-								 + "\n"
-								   "read from file : "
-								 + std::to_string(data) + " while animationFrame recorded " + std::to_string(animationFrame.timePoint));
-	}
 }
 
-void skeletonImporter::loadVector3FromSampler(int frameID, int& count, tinygltf::AnimationSampler& sampler, Ogre::Vector3& vector)
+void skeletonImporter::decodeSampler(const tinygltf::AnimationSampler& sampler, size_t componentCount, samplerData& output)
 {
-	auto& output			 = model.accessors[sampler.output];
-	count					 = static_cast<int>(output.count);
-	auto& bufferView		 = model.bufferViews[output.bufferView];
-	auto& buffer			 = model.buffers[bufferView.buffer];
-	unsigned char* dataStart = buffer.data.data() + bufferView.byteOffset + output.byteOffset;
-	const size_t byteStride  = output.ByteStride(bufferView);
-
-	assert(output.type == TINYGLTF_TYPE_VEC3); //Need to be a 3D vector since it's a translation vector
-
-	if(output.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) { vector = Ogre::Vector3(reinterpret_cast<float*>(dataStart + frameID * byteStride)); }
-	else if(output.componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE) //need double to float conversion
+	if(sampler.input < 0 || size_t(sampler.input) >= model.accessors.size() || sampler.output < 0 || size_t(sampler.output) >= model.accessors.size())
+		return;
+	const auto& input = model.accessors[sampler.input];
+	if(input.type != TINYGLTF_TYPE_SCALAR || accessorReader::getComponentCount(model.accessors[sampler.output].type) != componentCount)
 	{
-		std::array<Ogre::Real, 3> vectFloat {};
-		std::array<double, 3> vectDouble {};
-
-		memcpy(vectDouble.data(), reinterpret_cast<double*>(dataStart + frameID * byteStride), 3 * sizeof(double));
-		internal_utils::container_double_to_real(vectDouble, vectFloat);
-
-		vector = Ogre::Vector3(vectFloat.data());
+		OgreLog("Skipping an animation sampler whose accessors don't have the expected type");
+		return;
 	}
-}
-
-void skeletonImporter::loadQuatFromSampler(int frameID, int& count, tinygltf::AnimationSampler& sampler, Ogre::Quaternion& quat) const
-{
-	auto& output			 = model.accessors[sampler.output];
-	count					 = static_cast<int>(output.count);
-	auto& bufferView		 = model.bufferViews[output.bufferView];
-	auto& buffer			 = model.buffers[bufferView.buffer];
-	unsigned char* dataStart = buffer.data.data() + bufferView.byteOffset + output.byteOffset;
-	const size_t byteStride  = output.ByteStride(bufferView);
-
-	assert(output.type == TINYGLTF_TYPE_VEC4); //Need to be a 4D vector since it's a quaternion
 
-	if(output.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+	//Cubic spline samplers store an in-tangent, the value, and an out-tangent for each keyframe. Only the values are kept
+	accessors.readFloats(sampler.input, output.times);
+	accessors.readFloats(sampler.output, output.values);
+	output.step = sampler.interpolation == "STEP";
+	const auto keyFrameCount = output.times.size();
+	if(sampler.interpolation == "CUBICSPLINE" && output.values.size() >= keyFrameCount * componentCount * 3)
 	{
-		float* quat_data = reinterpret_cast<float*>(dataStart + frameID * byteStride);
-		quat			 = Ogre::Quaternion(quat_data[3], quat_data[0], quat_data[1], quat_data[2]);
+		for(size_t i { 0 }; i < keyFrameCount; i++)
+			std::copy_n(output.values.begin() + (i * 3 + 1) * componentCount, componentCount, output.values.begin() + i * componentCount);
+		output.values.resize(keyFrameCount * componentCount);
 	}
-	else if(output.componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE) //need double to float conversion
-	{
-		std::array<Ogre::Real, 4> vectFloat {};
-		std::array<double, 4> vectDouble {};
-
-		memcpy(vectDouble.data(), reinterpret_cast<double*>(dataStart + frameID * byteStride), 4 * sizeof(double));
-		internal_utils::container_double_to_real(vectDouble, vectFloat);
 
-		quat = Ogre::Quaternion(vectFloat[3], vectFloat[0], vectFloat[1], vectFloat[2]);
-	}
-}
-
-void skeletonImporter::detectAnimationChannel(const channelList& channels,
-											  tinygltf::AnimationChannel*& translation,
-											  tinygltf::AnimationChannel*& rotation,
-											  tinygltf::AnimationChannel*& scale,
-											  tinygltf::AnimationChannel*& weights) const
-{
-	const auto translationIt
-		= std::find_if(channels.begin(), channels.end(), [](const tinygltf::AnimationChannel& c) { return c.target_path == "translation"; });
-	if(translationIt != channels.end()) translation = &(*translationIt).get();
-
-	const auto rotationIt = std::find_if(channels.begin(), channels.end(), [](const tinygltf::AnimationChannel& c) { return c.target_path == "rotation"; });
-	if(rotationIt != channels.end()) rotation = &(*rotationIt).get();
-
-	const auto scaleIt = std::find_if(channels.begin(), channels.end(), [](const tinygltf::AnimationChannel& c) { return c.target_path == "scale"; });
-	if(scaleIt != channels.end()) scale = &(*scaleIt).get();
-
-	const auto weightsIt = std::find_if(channels.begin(), channels.end(), [](const tinygltf::AnimationChannel& c) { return c.target_path == "weights"; });
-	if(weightsIt != channels.end()) weights = &(*weightsIt).get();
-}
-
-void skeletonImporter::loadKeyFrameDataFromSampler(const tinygltf::Animation& animation,
-												   int bone,
-												   tinygltf::AnimationChannel* translation,
-												   tinygltf::AnimationChannel* rotation,
-												   tinygltf::AnimationChannel* scale,
-												   tinygltf::AnimationChannel* weights,
-												   int frameID,
-												   int& count,
-												   keyFrame& animationFrame)
-{
-	if(translation)
-	{
-		auto sampler = animation.samplers[translation->sampler];
-		loadTimepointFromSamplerToKeyFrame(bone, frameID, count, animationFrame, sampler);
-		loadVector3FromSampler(frameID, count, sampler, animationFrame.position);
-	}
-	if(rotation)
-	{
-		auto sampler = animation.samplers[rotation->sampler];
-		loadTimepointFromSamplerToKeyFrame(bone, frameID, count, animationFrame, sampler);
-		loadQuatFromSampler(frameID, count, sampler, animationFrame.rotation);
-	}
-	if(scale)
-	{
-		auto sampler = animation.samplers[scale->sampler];
-		loadTimepointFromSamplerToKeyFrame(bone, frameID, count, animationFrame, sampler);
-		loadVector3FromSampler(frameID, count, sampler, animationFrame.scale);
-	}
-	if(weights)
+	if(output.values.size() < keyFrameCount * componentCount)
 	{
-		auto sampler = animation.samplers[weights->sampler];
-		loadTimepointFromSamplerToKeyFrame(bone, frameID, count, animationFrame, sampler);
-		//TODO load the scalar... but well, we don't do anything with that in a skeletal animation, so... do nothing
+		OgreLog("Skipping an animation sampler that has fewer values than keyframes");
+		output.times.clear();
+		output.values.clear();
 	}
 }
 
-void skeletonImporter::loadKeyFrames(const tinygltf::Animation& animation,
-									 int bone,
-									 keyFrameList& keyFrames,
-									 tinygltf::AnimationChannel* translation,
-									 tinygltf::AnimationChannel* rotation,
-									 tinygltf::AnimationChannel* scale,
-									 tinygltf::AnimationChannel* weights)
+void skeletonImporter::loadKeyFrames(const boneSamplers& samplers, keyFrameList& keyFrames) const
 {
-	bool endOfTimeLine = false;
-	int frameID		   = 0;
-	int count		   = 0;
-	while(!endOfTimeLine)
+	//An Ogre keyframe holds the translation, the rotation and the scale : the track has a keyframe at each time of any of the samplers.
+	//Samplers that share their times, which is common, don't add any
+	std::vector<float> times;
+	for(const auto sampler : { samplers.translation, samplers.rotation, samplers.scale })
 	{
-		keyFrame animationFrame;
+		if(!sampler || sampler->times == times) continue;
+		std::vector<float> merged;
+		merged.reserve(times.size() + sampler->times.size());
+		std::set_union(times.begin(), times.end(), sampler->times.begin(), sampler->times.end(), std::back_inserter(merged));
+		times.swap(merged);
+	}
 
-		loadKeyFrameDataFromSampler(animation, bone, translation, rotation, scale, weights, frameID, count, animationFrame);
+	//Find the keyframe of a sampler at or before a time, and how far the time is to the next one. The times are increasing, the keyframe
+	//index only moves forward. Before the first keyframe and after the last one, the sampler keeps their value
+	const auto locate = [](const samplerData& sampler, float time, size_t& key) {
+		while(key + 1 < sampler.times.size() && sampler.times[key + 1] <= time) key++;
+		if(sampler.step || key + 1 >= sampler.times.size() || time <= sampler.times[key]) return 0.0f;
+		return (time - sampler.times[key]) / (sampler.times[key + 1] - sampler.times[key]);
+	};
+	const auto getVector = [](const samplerData& sampler, size_t key, float factor) {
+		const Ogre::Vector3 value(&sampler.values[key * 3]);
+		return factor > 0 ? value + (Ogre::Vector3(&sampler.values[key * 3 + 3]) - value) * factor : value;
+	};
+	const auto getQuaternion = [](const samplerData& sampler, size_t key) {
+		const auto value = &sampler.values[key * 4];
+		return Ogre::Quaternion(value[3], value[0], value[1], value[2]);
+	};
 
-		keyFrames.push_back(animationFrame);
-		++frameID;
-		if(frameID >= count) endOfTimeLine = true;
+	size_t translationKey { 0 }, rotationKey { 0 }, scaleKey { 0 };
+	keyFrames.resize(times.size());
+	for(size_t i { 0 }; i < keyFrames.size(); i++)
+	{
+		auto& keyFrame	   = keyFrames[i];
+		keyFrame.timePoint = times[i];
+		if(samplers.translation)
+		{
+			const auto factor = locate(*samplers.translation, times[i], translationKey);
+			keyFrame.position = getVector(*samplers.translation, translationKey, factor);
+		}
+		if(samplers.scale)
+		{
+			const auto factor = locate(*samplers.scale, times[i], scaleKey);
+			keyFrame.scale	  = getVector(*samplers.scale, scaleKey, factor);
+		}
+		if(samplers.rotation)
+		{
+			const auto factor = locate(*samplers.rotation, times[i], rotationKey);
+			keyFrame.rotation = getQuaternion(*samplers.rotation, rotationKey);
+			if(factor > 0) keyFrame.rotation = Ogre::Quaternion::Slerp(factor, keyFrame.rotation, getQuaternion(*samplers.rotation, rotationKey + 1), true);
+		}
 	}
 }
 
@@ -243,11 +183,13 @@ void skeletonImporter::loadSkeletonAnimations(const tinygltf::Skin skin, const s
 	//List all the animations that own at least one channel that target one of the bones of our skeleton
 	OgreLog("Searching for animations for skeleton " + skeleton->getName());
 	std::vector<std::reference_wrapper<tinygltf::Animation>> animations;
+	std::vector<bool> isSkinJoint(model.nodes.size(), false);
+	for(const auto joint : skin.joints) isSkinJoint[joint] = true;
 	for(auto& animation : model.animations)
 	{
 		for(const auto& channel : animation.channels)
 		{
-			if(std::find(skin.joints.begin(), skin.joints.end(), channel.target_node) != skin.joints.end())
+			if(channel.target_node >= 0 && isSkinJoint[channel.target_node])
 			{
 				//animation is targeting our skeleton, just save that information
 				animations.emplace_back(animation);
@@ -255,88 +197,98 @@ void skeletonImporter::loadSkeletonAnimations(const tinygltf::Skin skin, const s
 			}
 		}
 	}
+	if(animations.empty()) return;
 
-	std::unordered_map<tinygltfJointNodeIndex, keyFrameList> boneIndexedKeyFrames;
-
-	const auto getAnimationLength = [](const keyFrameList& l) {
-		if(l.empty()) return 0.0f;
-		return l.back().timePoint;
+	//Decode each sampler that moves a bone at once, into arrays of times and values. Morph target weights are not part of the skeletal
+	//animation, the morphTargetImporter loads them
+	struct boneTrack
+	{
+		size_t animation;
+		int bone;
+		boneSamplers samplers;
+		keyFrameList keyFrames;
 	};
-
-	std::unordered_map<tinygltfJointNodeIndex, channelList> boneRawAnimationChannels;
-
-	if(!animations.empty())
+	std::vector<std::vector<samplerData>> samplers(animations.size());
+	std::vector<boneTrack> tracks;
+	for(size_t a { 0 }; a < animations.size(); a++)
 	{
-		int i = 0;
-		for(auto animation_rw : animations)
+		const auto& animation = animations[a].get();
+		samplers[a].resize(animation.samplers.size());
+		std::unordered_map<int, size_t> trackIndices;
+		for(const auto& channel : animation.channels)
 		{
-			//Get animation
-			auto animation			  = animation_rw.get();
-			std::string animationName = animation.name;
-			if(animation.name.empty()) animationName = skeletonName + "Animation" + std::to_string(i++);
-
-			OgreLog("parsing channels for animation " + animationName);
+			if(channel.target_node < 0 || !isSkinJoint[channel.target_node] || channel.sampler < 0 || size_t(channel.sampler) >= animation.samplers.size())
+				continue;
+			const auto translation = channel.target_path == "translation";
+			const auto rotation	   = channel.target_path == "rotation";
+			const auto scale	   = channel.target_path == "scale";
+			if(!translation && !rotation && !scale) continue;
+
+			auto& sampler = samplers[a][size_t(channel.sampler)];
+			if(sampler.times.empty()) decodeSampler(animation.samplers[size_t(channel.sampler)], rotation ? 4 : 3, sampler);
+			if(sampler.times.empty()) continue;
+
+			const auto bone	 = nodeToJointMap[channel.target_node];
+			const auto found = trackIndices.insert({ bone, tracks.size() });
+			if(found.second) tracks.push_back({ a, bone, {}, {} });
+			auto& trackSamplers = tracks[found.first->second].samplers;
+			(translation ? trackSamplers.translation : rotation ? trackSamplers.rotation : trackSamplers.scale) = &sampler;
+		}
+	}
 
-			float maxLen = 0;
-			for(auto& channel : animation.channels)
-			{
-				const auto joint					   = nodeToJointMap[channel.target_node];
-				const auto& boneRawAnimationChannelIt = boneRawAnimationChannels.find(joint);
-				if(boneRawAnimationChannelIt == boneRawAnimationChannels.end()) boneRawAnimationChannels[joint];
+	//Build the keyframes of all the bones of all the animations, on the animation threads. Errors are thrown from the calling thread
+	std::vector<std::string> errors(tracks.size());
+	if(!threads) threads = std::make_unique<threadPool>(options.animationThreadCount);
+	threads->parallelFor(tracks.size(), [&](size_t i) {
+		try
+		{
+			loadKeyFrames(tracks[i].samplers, tracks[i].keyFrames);
+		}
+		catch(const std::exception& e)
+		{
+			errors[i] = e.what();
+		}
+	});
+	for(const auto& error : errors)
+		if(!error.empty()) throw FileIOError(error);
 
-				boneRawAnimationChannels[joint].push_back(channel);
-			}
+	auto track = tracks.begin();
+	int unnamed { 0 };
+	for(size_t a { 0 }; a < animations.size(); a++)
+	{
+		const auto& animation	  = animations[a].get();
+		std::string animationName = animation.name;
+		if(animation.name.empty()) animationName = skeletonName + "Animation" + std::to_string(unnamed++);
+		OgreLog("Creating animation " + animationName);
+
+		//The animation lasts until the last keyframe of its bones
+		const auto first = track;
+		while(track != tracks.end() && track->animation == a) ++track;
+		float length { 0 };
+		for(auto bone = first; bone != track; ++bone)
+			if(!bone->keyFrames.empty()) length = std::max(length, bone->keyFrames.back().timePoint);
+
+		auto ogreAnimation = skeleton->createAnimation(animationName, length);
+		ogreAnimation->setInterpolationMode(Ogre::v1::Animation::InterpolationMode::IM_LINEAR);
+
+		//For each bone's list of keyframes
+		for(auto keyFrameForBone = first; keyFrameForBone != track; ++keyFrameForBone)
+		{
+			//Add a node to the animation track
+			auto nodeAnimTrack = ogreAnimation->createOldNodeTrack(keyFrameForBone->bone);
+			auto bone		   = skeleton->getBone(keyFrameForBone->bone);
 
-			//from here, bones -> channel map has been built;
-			for(auto& boneChannels : boneRawAnimationChannels)
+			//for each keyframe
+			for(const auto& keyFrame : keyFrameForBone->keyFrames)
 			{
-				auto bone	 = boneChannels.first;
-				auto channels = boneChannels.second;
-
-				keyFrameList keyFrames;
-
-				tinygltf::AnimationChannel* translation = nullptr;
-				tinygltf::AnimationChannel* rotation	= nullptr;
-				tinygltf::AnimationChannel* scale		= nullptr;
-				tinygltf::AnimationChannel* weights		= nullptr;
-
-				detectAnimationChannel(channels, translation, rotation, scale, weights);
-				loadKeyFrames(animation, bone, keyFrames, translation, rotation, scale, weights);
-
-				//here, we have a list of all key frames for one bone
-				boneIndexedKeyFrames[bone] = keyFrames;
-				maxLen					   = getAnimationLength(keyFrames);
-			}
-
-			//Create animation
-			auto ogreAnimation = skeleton->createAnimation(animationName, maxLen);
-			ogreAnimation->setInterpolationMode(Ogre::v1::Animation::InterpolationMode::IM_LINEAR);
+				//Add a transform to apply
+				Ogre::v1::TransformKeyFrame* transformKeyFrame = nodeAnimTrack->createNodeKeyFrame(keyFrame.timePoint);
 
-			//For each bone's list of keyframes
-			for(auto& keyFrameForBone : boneIndexedKeyFrames)
-			{
-				//Get the bone index
-				const auto boneIndex	 = keyFrameForBone.first;
-				const auto ogreBoneIndex = boneIndex;
-
-				//Add a node to the animation track
-				auto nodeAnimTrack = ogreAnimation->createOldNodeTrack(ogreBoneIndex);
-				auto bone		   = skeleton->getBone(boneIndex);
-
-				//for each keyframe
-				for(auto& keyFrame : keyFrameForBone.second)
-				{
-					//Add a transform to apply
-					Ogre::v1::TransformKeyFrame* transformKeyFrame = nodeAnimTrack->createNodeKeyFrame(keyFrame.timePoint);
-
-					//Set the data
-					transformKeyFrame->setRotation(bone->getOrientation().Inverse() * keyFrame.rotation);
-					transformKeyFrame->setTranslate(bone->getPosition() - keyFrame.position);
-					transformKeyFrame->setScale(keyFrame.scale / bone->getScale());
-				}
+				//Set the data
+				transformKeyFrame->setRotation(bone->getOrientation().Inverse() * keyFrame.rotation);
+				transformKeyFrame->setTranslate(bone->getPosition() - keyFrame.position);
+				transformKeyFrame->setScale(keyFrame.scale / bone->getScale());
 			}
-
-			//Need to use the keyframe 0 as base keyframe
 		}
 	}
 }
@@ -380,10 +332,8 @@ Ogre::v1::SkeletonPtr skeletonImporter::getSkeleton(size_t index)
 	{
 		const auto inverseBindMatricesID		= skin.inverseBindMatrices;
 		const auto& inverseBindMatricesAccessor = model.accessors[inverseBindMatricesID];
-		const auto& bufferView					= model.bufferViews[inverseBindMatricesAccessor.bufferView];
-		const auto byteStride					= inverseBindMatricesAccessor.ByteStride(bufferView);
-		const auto& buffer						= model.buffers[bufferView.buffer];
-		const unsigned char* dataStart			= buffer.data.data() + bufferView.byteOffset + inverseBindMatricesAccessor.byteOffset;
+		const auto byteStride					= bufferViews.getAccessorByteStride(inverseBindMatricesAccessor);
+		const unsigned char* dataStart			= bufferViews.getAccessorData(inverseBindMatricesAccessor);
 
 		assert(inverseBindMatricesAccessor.count == skin.joints.size());
 		assert(inverseBindMatricesAccessor.type == TINYGLTF_TYPE_MAT4);
@@ -427,14 +377,6 @@ Ogre::v1::SkeletonPtr skeletonImporter::getSkeleton(size_t index)
 		}
 	}
 
-	std::vector<int> rootBones;
-	std::vector<int> allChildren;
-	for(const auto& nodeIndex : skin.joints)
-	{
-		const auto& node = model.nodes[nodeIndex];
-		allChildren.insert(allChildren.end(), node.children.begin(), node.children.end());
-	}
-
 	//Build the "node to joint map". In the vertex buffer, property "JOINT_0" refer to the joints that affect a particular vertex of the skined mesh.
 	//To refer to theses joints, it refer to the index of the node in the skin.joints array.
 	//We need to be able to get the index for each of theses joints in the array easilly, so we are builind a dictionarry to be able to reverse-search them
@@ -451,13 +393,9 @@ Ogre::v1::SkeletonPtr skeletonImporter::getSkeleton(size_t index)
 
 		//Create bone with index "i"
 		auto bone = skeleton->createBone(!name.empty() ? name : skeletonName + std::to_string(i), i);
-
-		if(std::find(allChildren.begin(), allChildren.end(), jointNode) == allChildren.end()) {
-			rootBones.push_back(jointNode);
-		}
 	}
 
-	for(int boneIndex : rootBones)
+	for(int boneIndex : sceneGraph.getSkinRoots(index))
 	{
 		loadBoneHierarchy(boneIndex);
 	}
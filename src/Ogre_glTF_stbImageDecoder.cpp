@@ -0,0 +1,27 @@
+#include "Ogre_glTF_stbImageDecoder.hpp"
+#include "tiny_gltf.h"
+
+using namespace Ogre_glTF;
+
+bool stbImageDecoder::decode(const unsigned char* file,
+							 size_t size,
+							 Layout layout,
+							 std::vector<unsigned char>& output,
+							 size_t& width,
+							 size_t& height,
+							 size_t& channels) const
+{
+	//The header tells if the image has an alpha channel : greyscale with alpha has 2 channels, RGBA has 4
+	int imageWidth, imageHeight, imageChannels;
+	if(!stbi_info_from_memory(file, int(size), &imageWidth, &imageHeight, &imageChannels)) return false;
+	const auto requested = layout == Layout::Color && imageChannels % 2 == 0 ? 4 : 3;
+
+	const auto pixels = stbi_load_from_memory(file, int(size), &imageWidth, &imageHeight, &imageChannels, requested);
+	if(!pixels) return false;
+	width	 = size_t(imageWidth);
+	height	 = size_t(imageHeight);
+	channels = size_t(requested);
+	output.assign(pixels, pixels + width * height * channels);
+	stbi_image_free(pixels);
+	return true;
+}
@@ -0,0 +1,471 @@
+#include "Ogre_glTF_textureCompressor.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+using namespace Ogre_glTF;
+
+namespace
+{
+	///A color with up to 4 channels, in the [0; 255] range
+	using color = std::array<float, 4>;
+
+	///The 16 texels of a block, row by row
+	using texelBlock = std::array<color, 16>;
+
+	///Interpolation weights of the 4 bit indices of BC7, in 64th
+	const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	///Write values of a few bits in a block, from the least significant bit
+	struct bitWriter
+	{
+		///Where the block is written
+		Ogre::uchar* output;
+
+		///Number of bits already written
+		size_t position = 0;
+
+		///Write the bits of a value
+		/// \param value the value to write
+		/// \param bits number of bits of the value
+		void write(std::uint32_t value, size_t bits)
+		{
+			for(size_t bit = 0; bit < bits; ++bit, ++position)
+				if(value & (1u << bit))
+					output[position / 8] |= Ogre::uchar(1u << (position % 8));
+				else
+					output[position / 8] &= Ogre::uchar(~(1u << (position % 8)));
+		}
+	};
+
+	///Squared distance between two colors
+	float distance(const color& a, const color& b, size_t channels)
+	{
+		float sum = 0;
+		for(size_t c = 0; c < channels; ++c) sum += (a[c] - b[c]) * (a[c] - b[c]);
+		return sum;
+	}
+
+	///Find the two endpoints of the segment that best represents the texels of a block
+	/// \param texels the block
+	/// \param channels number of channels to fit
+	/// \param principalAxis if set, the segment follow the principal axis of the texels. Otherwise, it is the diagonal of their bounding box that
+	///goes the same way as the channels are correlated
+	/// \param low set to the first endpoint
+	/// \param high set to the second endpoint
+	void fitEndpoints(const texelBlock& texels, size_t channels, bool principalAxis, color& low, color& high)
+	{
+		color mean {}, minimum, maximum;
+		minimum.fill(255);
+		maximum.fill(0);
+		for(const auto& texel : texels)
+			for(size_t c = 0; c < channels; ++c)
+			{
+				mean[c] += texel[c] / 16;
+				minimum[c] = std::min(minimum[c], texel[c]);
+				maximum[c] = std::max(maximum[c], texel[c]);
+			}
+
+		//Covariance of the channels
+		float covariance[4][4] {};
+		for(const auto& texel : texels)
+			for(size_t i = 0; i < channels; ++i)
+				for(size_t j = 0; j < channels; ++j) covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+
+		color axis {};
+		if(principalAxis)
+		{
+			//Power iteration, starting from the diagonal of the bounding box
+			for(size_t c = 0; c < channels; ++c) axis[c] = maximum[c] - minimum[c] + 1;
+			for(size_t iteration = 0; iteration < 8; ++iteration)
+			{
+				color next {};
+				float length = 0;
+				for(size_t i = 0; i < channels; ++i)
+				{
+					for(size_t j = 0; j < channels; ++j) next[i] += covariance[i][j] * axis[j];
+					length = std::max(length, std::abs(next[i]));
+				}
+				if(length == 0) break;
+				for(size_t c = 0; c < channels; ++c) axis[c] = next[c] / length;
+			}
+		}
+		else
+		{
+			//Flip the channels that go against the one with the largest range
+			size_t reference = 0;
+			for(size_t c = 1; c < channels; ++c)
+				if(covariance[c][c] > covariance[reference][reference]) reference = c;
+			for(size_t c = 0; c < channels; ++c) axis[c] = (maximum[c] - minimum[c]) * (covariance[reference][c] < 0 ? -1.0f : 1.0f);
+		}
+
+		//Extent of the texels along the axis
+		float first = std::numeric_limits<float>::max(), last = -first, axisLength = 0;
+		for(size_t c = 0; c < channels; ++c) axisLength += axis[c] * axis[c];
+		if(axisLength == 0)
+		{
+			low = high = mean;
+			return;
+		}
+		for(const auto& texel : texels)
+		{
+			float projection = 0;
+			for(size_t c = 0; c < channels; ++c) projection += (texel[c] - mean[c]) * axis[c];
+			first = std::min(first, projection / axisLength);
+			last  = std::max(last, projection / axisLength);
+		}
+
+		for(size_t c = 0; c < channels; ++c)
+		{
+			low[c]	= std::min(255.0f, std::max(0.0f, mean[c] + first * axis[c]));
+			high[c] = std::min(255.0f, std::max(0.0f, mean[c] + last * axis[c]));
+		}
+	}
+
+	///Solve the least square problem that gives the endpoints minimizing the error of the texels, when their position on the segment is known
+	/// \param texels the block
+	/// \param weights position of each texel on the segment, from 0 (low) to 1 (high)
+	/// \param channels number of channels to fit
+	/// \param low set to the first endpoint
+	/// \param high set to the second endpoint
+	/// \return false if all the texels are at the same position, the endpoints are not changed
+	bool refineEndpoints(const texelBlock& texels, const float* weights, size_t channels, color& low, color& high)
+	{
+		float lowLow = 0, lowHigh = 0, highHigh = 0;
+		color lowSum {}, highSum {};
+		for(size_t i = 0; i < 16; ++i)
+		{
+			const auto w = weights[i];
+			lowLow += (1 - w) * (1 - w);
+			lowHigh += (1 - w) * w;
+			highHigh += w * w;
+			for(size_t c = 0; c < channels; ++c)
+			{
+				lowSum[c] += (1 - w) * texels[i][c];
+				highSum[c] += w * texels[i][c];
+			}
+		}
+
+		const auto determinant = lowLow * highHigh - lowHigh * lowHigh;
+		if(std::abs(determinant) < 1e-6f) return false;
+		for(size_t c = 0; c < channels; ++c)
+		{
+			low[c]	= std::min(255.0f, std::max(0.0f, (highHigh * lowSum[c] - lowHigh * highSum[c]) / determinant));
+			high[c] = std::min(255.0f, std::max(0.0f, (lowLow * highSum[c] - lowHigh * lowSum[c]) / determinant));
+		}
+		return true;
+	}
+
+	///Index of the palette entry closest to a texel
+	size_t closest(const color& texel, const color* palette, size_t paletteSize, size_t channels, float& error)
+	{
+		size_t best = 0;
+		error		= std::numeric_limits<float>::max();
+		for(size_t i = 0; i < paletteSize; ++i)
+		{
+			const auto candidate = distance(texel, palette[i], channels);
+			if(candidate < error)
+			{
+				error = candidate;
+				best  = i;
+			}
+		}
+		return best;
+	}
+
+	///A BC1 color block, with its error
+	struct bc1Candidate
+	{
+		std::uint16_t color0 = 0, color1 = 0;
+		std::uint32_t indices = 0;
+		float error			  = std::numeric_limits<float>::max();
+		float weights[16] {};
+	};
+
+	///Quantize a color to RGB 565
+	std::uint16_t to565(const color& value)
+	{
+		const auto r = std::uint16_t(std::lround(value[0] * 31 / 255));
+		const auto g = std::uint16_t(std::lround(value[1] * 63 / 255));
+		const auto b = std::uint16_t(std::lround(value[2] * 31 / 255));
+		return std::uint16_t(r << 11 | g << 5 | b);
+	}
+
+	///Expand an RGB 565 color to 8 bits per channel, like the GPU does
+	color from565(std::uint16_t value)
+	{
+		const auto r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+		return { float(r << 3 | r >> 2), float(g << 2 | g >> 4), float(b << 3 | b >> 2), 255 };
+	}
+
+	///Encode a BC1 block with given endpoints, always in 4 colors mode
+	bc1Candidate encodeBC1(const texelBlock& texels, const color& low, const color& high)
+	{
+		bc1Candidate block;
+		block.color0 = to565(high);
+		block.color1 = to565(low);
+		if(block.color0 < block.color1) std::swap(block.color0, block.color1);
+
+		//Equal endpoints decode in 3 colors mode, where index 0 is still color0
+		const auto color0 = from565(block.color0), color1 = from565(block.color1);
+		color palette[4];
+		const float positions[4] = { 1, 0, 2.0f / 3, 1.0f / 3 };
+		for(size_t i = 0; i < 4; ++i)
+			for(size_t c = 0; c < 3; ++c) palette[i][c] = positions[i] * color0[c] + (1 - positions[i]) * color1[c];
+
+		block.error = 0;
+		for(size_t i = 0; i < 16; ++i)
+		{
+			float error;
+			const auto index = block.color0 == block.color1 ? 0 : closest(texels[i], palette, 4, 3, error);
+			if(block.color0 == block.color1) error = distance(texels[i], palette[0], 3);
+			block.indices |= std::uint32_t(index) << (2 * i);
+			block.error += error;
+			block.weights[i] = positions[index];
+		}
+		return block;
+	}
+
+	///Encode the color part of a BC1 or BC3 block
+	void writeBC1(const texelBlock& texels, bool highQuality, Ogre::uchar* output)
+	{
+		color low, high;
+		fitEndpoints(texels, 3, highQuality, low, high);
+		auto best = encodeBC1(texels, low, high);
+
+		//Move the endpoints to where the chosen indices put the texels, while it improves the block
+		for(size_t iteration = 0; highQuality && iteration < 2 && best.error > 0; ++iteration)
+		{
+			if(!refineEndpoints(texels, best.weights, 3, low, high)) break;
+			const auto refined = encodeBC1(texels, low, high);
+			if(refined.error >= best.error) break;
+			best = refined;
+		}
+
+		const Ogre::uchar bytes[8] = { Ogre::uchar(best.color0),
+									   Ogre::uchar(best.color0 >> 8),
+									   Ogre::uchar(best.color1),
+									   Ogre::uchar(best.color1 >> 8),
+									   Ogre::uchar(best.indices),
+									   Ogre::uchar(best.indices >> 8),
+									   Ogre::uchar(best.indices >> 16),
+									   Ogre::uchar(best.indices >> 24) };
+		std::copy(bytes, bytes + 8, output);
+	}
+
+	///Encode one channel of a block as a BC4 block (also the alpha of BC3 and each channel of BC5)
+	void writeBC4(const texelBlock& texels, size_t channel, bool highQuality, Ogre::uchar* output)
+	{
+		int minimum = 255, maximum = 0, innerMinimum = 255, innerMaximum = 0;
+		for(const auto& texel : texels)
+		{
+			const auto value = int(texel[channel]);
+			minimum			 = std::min(minimum, value);
+			maximum			 = std::max(maximum, value);
+			if(value == 0 || value == 255) continue;
+			innerMinimum = std::min(innerMinimum, value);
+			innerMaximum = std::max(innerMaximum, value);
+		}
+
+		//Try some endpoints, keep the ones with the lowest error. With endpoint0 > endpoint1 there are 6 interpolated values, otherwise 4 plus 0 and 255
+		int bestEndpoints[2] = { maximum, minimum };
+		std::uint64_t bestIndices {};
+		auto bestError = std::numeric_limits<int>::max();
+		const auto tryEndpoints = [&](int endpoint0, int endpoint1) {
+			int palette[8] = { endpoint0, endpoint1 };
+			if(endpoint0 > endpoint1)
+				for(int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * endpoint0 + i * endpoint1 + 3) / 7;
+			else
+			{
+				for(int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * endpoint0 + i * endpoint1 + 2) / 5;
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+
+			std::uint64_t indices {};
+			auto error = 0;
+			for(size_t i = 0; i < 16; ++i)
+			{
+				const auto value = int(texels[i][channel]);
+				size_t index	 = 0;
+				for(size_t candidate = 1; candidate < 8; ++candidate)
+					if(std::abs(palette[candidate] - value) < std::abs(palette[index] - value)) index = candidate;
+				error += (palette[index] - value) * (palette[index] - value);
+				indices |= std::uint64_t(index) << (3 * i);
+			}
+
+			if(error >= bestError) return;
+			bestError		 = error;
+			bestIndices		 = indices;
+			bestEndpoints[0] = endpoint0;
+			bestEndpoints[1] = endpoint1;
+		};
+
+		tryEndpoints(maximum, minimum);
+		if(highQuality && bestError > 0)
+		{
+			//Blocks with a few fully black or white texels are better served by the mode that has 0 and 255 for free
+			if(innerMinimum <= innerMaximum) tryEndpoints(innerMinimum, innerMaximum);
+			for(int inset = 1; inset < 4 && maximum - minimum > 2 * inset; ++inset) tryEndpoints(maximum - inset, minimum + inset);
+		}
+
+		output[0] = Ogre::uchar(bestEndpoints[0]);
+		output[1] = Ogre::uchar(bestEndpoints[1]);
+		for(size_t i = 0; i < 6; ++i) output[2 + i] = Ogre::uchar(bestIndices >> (8 * i));
+	}
+
+	///A BC7 mode 6 block, with its error
+	struct bc7Candidate
+	{
+		std::array<int, 4> endpoints[2] {};
+		int pBits[2] {};
+		int indices[16] {};
+		float error = std::numeric_limits<float>::max();
+		float weights[16] {};
+	};
+
+	///Quantize an endpoint to 7 bits per channel plus a shared bit, choosing the shared bit that fits it best
+	void quantizeBC7Endpoint(const color& endpoint, std::array<int, 4>& quantized, int& pBit)
+	{
+		auto bestError = std::numeric_limits<float>::max();
+		for(int p = 0; p < 2; ++p)
+		{
+			std::array<int, 4> candidate;
+			float error = 0;
+			for(size_t c = 0; c < 4; ++c)
+			{
+				candidate[c]	 = std::min(127, std::max(0, int(std::lround((endpoint[c] - float(p)) / 2))));
+				const auto value = float(candidate[c] * 2 + p);
+				error += (value - endpoint[c]) * (value - endpoint[c]);
+			}
+			if(error >= bestError) continue;
+			bestError = error;
+			quantized = candidate;
+			pBit	  = p;
+		}
+	}
+
+	///Encode a BC7 mode 6 block with given endpoints
+	bc7Candidate encodeBC7(const texelBlock& texels, const color& low, const color& high)
+	{
+		bc7Candidate block;
+		quantizeBC7Endpoint(low, block.endpoints[0], block.pBits[0]);
+		quantizeBC7Endpoint(high, block.endpoints[1], block.pBits[1]);
+
+		color palette[16];
+		for(size_t i = 0; i < 16; ++i)
+			for(size_t c = 0; c < 4; ++c)
+			{
+				const auto endpoint0 = block.endpoints[0][c] * 2 + block.pBits[0], endpoint1 = block.endpoints[1][c] * 2 + block.pBits[1];
+				palette[i][c]		 = float(((64 - bc7Weights[i]) * endpoint0 + bc7Weights[i] * endpoint1 + 32) >> 6);
+			}
+
+		block.error = 0;
+		for(size_t i = 0; i < 16; ++i)
+		{
+			float error;
+			block.indices[i] = int(closest(texels[i], palette, 16, 4, error));
+			block.weights[i] = float(bc7Weights[block.indices[i]]) / 64;
+			block.error += error;
+		}
+		return block;
+	}
+
+	///Encode a block as BC7 mode 6
+	void writeBC7(const texelBlock& texels, bool highQuality, Ogre::uchar* output)
+	{
+		color low, high;
+		fitEndpoints(texels, 4, highQuality, low, high);
+		auto best = encodeBC7(texels, low, high);
+
+		for(size_t iteration = 0; highQuality && iteration < 2 && best.error > 0; ++iteration)
+		{
+			if(!refineEndpoints(texels, best.weights, 4, low, high)) break;
+			const auto refined = encodeBC7(texels, low, high);
+			if(refined.error >= best.error) break;
+			best = refined;
+		}
+
+		//The most significant bit of the index of the first texel is implicitly 0 : swap the endpoints if it's not
+		if(best.indices[0] >= 8)
+		{
+			std::swap(best.endpoints[0], best.endpoints[1]);
+			std::swap(best.pBits[0], best.pBits[1]);
+			for(auto& index : best.indices) index = 15 - index;
+		}
+
+		bitWriter writer { output };
+		writer.write(1 << 6, 7);
+		for(size_t c = 0; c < 4; ++c)
+		{
+			writer.write(std::uint32_t(best.endpoints[0][c]), 7);
+			writer.write(std::uint32_t(best.endpoints[1][c]), 7);
+		}
+		writer.write(std::uint32_t(best.pBits[0]), 1);
+		writer.write(std::uint32_t(best.pBits[1]), 1);
+		writer.write(std::uint32_t(best.indices[0]), 3);
+		for(size_t i = 1; i < 16; ++i) writer.write(std::uint32_t(best.indices[i]), 4);
+	}
+}
+
+textureCompressor::textureCompressor(bool quality) : highQuality { quality } {}
+
+Ogre::PixelFormat textureCompressor::getPixelFormat(Format format)
+{
+	switch(format)
+	{
+		case Format::BC1: return Ogre::PF_DXT1;
+		case Format::BC3: return Ogre::PF_DXT5;
+		case Format::BC4: return Ogre::PF_BC4_UNORM;
+		case Format::BC5: return Ogre::PF_BC5_UNORM;
+		case Format::BC7: return Ogre::PF_BC7_UNORM;
+	}
+	return Ogre::PF_UNKNOWN;
+}
+
+size_t textureCompressor::getBlockSize(Format format) { return format == Format::BC1 || format == Format::BC4 ? 8 : 16; }
+
+size_t textureCompressor::getEncodedSize(Format format, size_t width, size_t height) { return ((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format); }
+
+void textureCompressor::encodeBlockRow(Format format,
+									   const Ogre::uchar* pixels,
+									   size_t width,
+									   size_t height,
+									   size_t pixelSize,
+									   size_t channels,
+									   size_t blockRow,
+									   Ogre::uchar* output) const
+{
+	const auto blockSize = getBlockSize(format);
+	texelBlock texels;
+	for(size_t blockColumn = 0; blockColumn < (width + 3) / 4; ++blockColumn)
+	{
+		//Gather the texels of the block, repeating the last row and column of the image
+		for(size_t i = 0; i < 16; ++i)
+		{
+			const auto x	 = std::min(width - 1, blockColumn * 4 + i % 4);
+			const auto y	 = std::min(height - 1, blockRow * 4 + i / 4);
+			const auto pixel = pixels + (y * width + x) * pixelSize;
+			texels[i]		 = { 0, 0, 0, 255 };
+			for(size_t c = 0; c < channels; ++c) texels[i][c] = float(pixel[c]);
+		}
+
+		const auto block = output + blockColumn * blockSize;
+		switch(format)
+		{
+			case Format::BC1: writeBC1(texels, highQuality, block); break;
+			case Format::BC3:
+				writeBC4(texels, 3, highQuality, block);
+				writeBC1(texels, highQuality, block + 8);
+				break;
+			case Format::BC4: writeBC4(texels, 0, highQuality, block); break;
+			case Format::BC5:
+				writeBC4(texels, 0, highQuality, block);
+				writeBC4(texels, 1, highQuality, block + 8);
+				break;
+			case Format::BC7: writeBC7(texels, highQuality, block); break;
+		}
+	}
+}
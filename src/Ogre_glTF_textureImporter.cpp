@@ -8,25 +8,228 @@
 #include <OgreColourValue.h>
 #include <OgreRoot.h>
 #include <OgreRenderTarget.h>
+#include <OgreRenderSystemCapabilities.h>
+#include <algorithm>
+#include <fstream>
+#include <tuple>
 #include "Ogre_glTF.hpp"
+#include "Ogre_glTF_internal_utils.hpp"
+#include "Ogre_glTF_ktx2.hpp"
+#include "Ogre_glTF_mipChain.hpp"
+#include "Ogre_glTF_simd.hpp"
+#include "Ogre_glTF_stbImageDecoder.hpp"
+#include "Ogre_glTF_streamedTexture.hpp"
+#include "Ogre_glTF_threadPool.hpp"
 
 using namespace Ogre_glTF;
 
-//TODO pack the loaded textures in texture arrays (TEX_TYPE_2D_ARRAY) to optimize the way textures are binded to the slots of an HlmsPbsDatablock.
 //TODO rethink the oder of operations while loading texture. Some of them need to be interpreted differently for they usage (MetalRoughMap needs to be separated in two greyscale map, NormalMap need SNORM reformating). Knowing what the material is doing with them will help avoid uncessesary resource usage and load time.
 //TODO planned refactoring : pixel format selection code needs to be put into it's own method
 //TODO planned refactoring : Loading of texture via OgreImage needs to be put into it's own method
 //TODO investigate if HardwarePixelBuffer is going to be deprecated. Why is it in the Ogre::v1 namespace? What will happen in Ogre 2.2's "texture refactor"?
 
-size_t textureImporter::id { 0 };
-void textureImporter::loadTexture(const tinygltf::Texture& texture)
+namespace
 {
-	auto textureManager = Ogre::TextureManager::getSingletonPtr();
-	const auto& image   = model.images[texture.source];
-	const auto name		= "glTF_texture_" + image.name + std::to_string(id) + std::to_string(texture.source);
+#if Ogre_glTF_SIMD_SSE2
+	///Gather one channel of 16 RGBA pixels in a vector of 16 bytes : shift the channel to the low byte of each pixel, then narrow the pixels to bytes
+	/// \param quads 4 vectors of 4 pixels
+	/// \param shift position of the channel in the pixels, in bits
+	inline __m128i gatherChannel(const __m128i (&quads)[4], int shift)
+	{
+		const auto lowByte = _mm_set1_epi32(0xFF);
+		const auto channel = [&](size_t quad) { return _mm_and_si128(_mm_srli_epi32(quads[quad], shift), lowByte); };
+		return _mm_packus_epi16(_mm_packs_epi32(channel(0), channel(1)), _mm_packs_epi32(channel(2), channel(3)));
+	}
+#endif
+
+	///Copy the metalness (B) and the roughness (G) channels of a row of pixels to two single channel rows
+	/// \param source the pixels of the metallicRoughness image
+	/// \param pixelCount number of pixels in the row
+	/// \param pixelSize number of channels of the image, 3 or 4
+	/// \param metalness where to write the metalness of each pixel
+	/// \param roughness where to write the roughness of each pixel
+	void extractMetalRough(const Ogre::uchar* source, size_t pixelCount, size_t pixelSize, Ogre::uchar* metalness, Ogre::uchar* roughness)
+	{
+		size_t i { 0 };
+#if Ogre_glTF_SIMD_SSE2
+		//16 RGBA pixels at a time
+		if(pixelSize == 4)
+			for(; i + 16 <= pixelCount; i += 16)
+			{
+				const auto pixels	   = reinterpret_cast<const __m128i*>(source + i * 4);
+				const __m128i quads[4] = { _mm_loadu_si128(pixels), _mm_loadu_si128(pixels + 1), _mm_loadu_si128(pixels + 2), _mm_loadu_si128(pixels + 3) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(metalness + i), gatherChannel(quads, 16));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(roughness + i), gatherChannel(quads, 8));
+			}
+#endif
+		for(; i < pixelCount; i++)
+		{
+			metalness[i] = source[i * pixelSize + 2];
+			roughness[i] = source[i * pixelSize + 1];
+		}
+	}
+
+	///Copy one channel of some pixels to a single channel buffer
+	/// \param source the pixels
+	/// \param pixelCount number of pixels
+	/// \param pixelSize number of channels of the pixels
+	/// \param channel index of the channel to copy
+	/// \param destination where to write the channel of each pixel
+	void extractChannel(const Ogre::uchar* source, size_t pixelCount, size_t pixelSize, size_t channel, Ogre::uchar* destination)
+	{
+		for(size_t i { 0 }; i < pixelCount; i++) destination[i] = source[i * pixelSize + channel];
+	}
+
+	///Check if all the pixels of an RGBA image have an alpha of 255
+	/// \param pixels the RGBA pixels
+	/// \param pixelCount number of pixels
+	bool isOpaque(const Ogre::uchar* pixels, size_t pixelCount)
+	{
+		size_t i { 0 };
+#if Ogre_glTF_SIMD_SSE2
+		//The pixels are and-ed together 64 at a time, the alpha bytes stay at 255 only if they all are
+		const auto alphaMask = _mm_set1_epi32(int(0xFF000000));
+		for(; i + 64 <= pixelCount; i += 64)
+		{
+			const auto quads = reinterpret_cast<const __m128i*>(pixels + i * 4);
+			auto alpha		 = alphaMask;
+			for(size_t quad { 0 }; quad < 16; quad++) alpha = _mm_and_si128(alpha, _mm_loadu_si128(quads + quad));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) != 0xFFFF) return false;
+		}
+#endif
+		for(; i < pixelCount; i++)
+			if(pixels[i * 4 + 3] != 255) return false;
+		return true;
+	}
+
+	///Check if all the pixels of an image are the same as the first one
+	/// \param pixels the pixels
+	/// \param size size of the image in bytes
+	/// \param pixelSize number of bytes per pixel, from 1 to 4
+	bool isUniform(const Ogre::uchar* pixels, size_t size, size_t pixelSize)
+	{
+		//48 bytes hold a whole number of pixels of every size, the image is compared to the first pixel repeated over them
+		Ogre::uchar pattern[48];
+		if(size < pixelSize) return false;
+		for(size_t i { 0 }; i < sizeof pattern; i++) pattern[i] = pixels[i % pixelSize];
+
+		size_t i { 0 };
+#if Ogre_glTF_SIMD_SSE2
+		const __m128i repeated[3] = { _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern)),
+									  _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 16)),
+									  _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 32)) };
+		for(; i + sizeof pattern <= size; i += sizeof pattern)
+		{
+			const auto blocks = reinterpret_cast<const __m128i*>(pixels + i);
+			auto equal		  = _mm_cmpeq_epi8(_mm_loadu_si128(blocks), repeated[0]);
+			equal			  = _mm_and_si128(equal, _mm_cmpeq_epi8(_mm_loadu_si128(blocks + 1), repeated[1]));
+			equal			  = _mm_and_si128(equal, _mm_cmpeq_epi8(_mm_loadu_si128(blocks + 2), repeated[2]));
+			if(_mm_movemask_epi8(equal) != 0xFFFF) return false;
+		}
+#endif
+		for(; i < size; i++)
+			if(pixels[i] != pattern[i % sizeof pattern]) return false;
+		return true;
+	}
+
+	///Remove the alpha channel of an RGBA image, in place
+	/// \param pixels the RGBA pixels, resized to the RGB ones
+	/// \param pixelCount number of pixels
+	void dropAlpha(std::vector<Ogre::uchar>& pixels, size_t pixelCount)
+	{
+		for(size_t i { 0 }; i < pixelCount; i++)
+			for(size_t c { 0 }; c < 3; c++) pixels[i * 3 + c] = pixels[i * 4 + c];
+		pixels.resize(pixelCount * 3);
+		pixels.shrink_to_fit();
+	}
+
+	///Write the blocks of a compressed texture to the cache
+	/// \param path path of the cache file
+	/// \param header what identifies the blocks, written first
+	/// \param headerSize size of the header in bytes
+	/// \param blocks the blocks of all the levels, one level after the other
+	void writeCompressedCache(const std::string& path, const std::uint32_t* header, size_t headerSize, const std::vector<Ogre::uchar>& blocks)
+	{
+		std::ofstream cache(path, std::ios_base::binary);
+		cache.write(reinterpret_cast<const char*>(header), std::streamsize(headerSize));
+		cache.write(reinterpret_cast<const char*>(blocks.data()), std::streamsize(blocks.size()));
+		if(!cache) OgreLog("Could not write the compressed texture cache file " + path);
+	}
+
+	///Get the Ogre pixel format of a format Basis Universal images are transcoded to
+	Ogre::PixelFormat getTargetFormat(Ogre_glTF::basisTranscoder::Target target)
+	{
+		switch(target)
+		{
+			case Ogre_glTF::basisTranscoder::Target::BC1: return Ogre::PF_DXT1;
+			case Ogre_glTF::basisTranscoder::Target::BC3: return Ogre::PF_DXT5;
+			case Ogre_glTF::basisTranscoder::Target::BC5: return Ogre::PF_BC5_UNORM;
+			case Ogre_glTF::basisTranscoder::Target::BC7: return Ogre::PF_BC7_UNORM;
+			default: return Ogre::PF_BYTE_RGBA;
+		}
+	}
+
+	///Convert an UNORM byte to the SNORM byte that has the closest value : round((2 * value / 255 - 1) * 127). This is value - 128, plus 1 under 128
+	inline Ogre::uchar unormToSnorm(Ogre::uchar value) { return Ogre::uchar(value < 128 ? value - 127 : value - 128); }
 
-	auto OgreTexture = textureManager->getByName(name);
-	if(OgreTexture)
+#if Ogre_glTF_SIMD_SSE2
+	///Convert 16 UNORM bytes to SNORM, like unormToSnorm
+	inline __m128i unormToSnorm(__m128i values)
+	{
+		const auto centered = _mm_xor_si128(values, _mm_set1_epi8(char(0x80)));
+		return _mm_sub_epi8(centered, _mm_cmplt_epi8(centered, _mm_setzero_si128()));
+	}
+#endif
+
+	///Convert a row of a normal map from UNORM to SNORM. The channels keep their order, alpha is set to 1
+	/// \param source the pixels of the image
+	/// \param pixelCount number of pixels in the row
+	/// \param pixelSize number of channels of the image, 3 or 4
+	/// \param destination where to write the converted pixels
+	/// \param destinationPixelSize number of channels to write : 2 (only X and Y), or the same as pixelSize
+	void convertNormalRow(const Ogre::uchar* source, size_t pixelCount, size_t pixelSize, Ogre::uchar* destination, size_t destinationPixelSize)
+	{
+		size_t i { 0 };
+#if Ogre_glTF_SIMD_SSE2
+		const auto output = reinterpret_cast<__m128i*>(destination);
+		if(pixelSize == destinationPixelSize)
+		{
+			//Same layout : 16 bytes at a time, the alpha bytes of RGBA pixels are replaced by 1 (127). The pixel cut by the end of the
+			//last block is converted again by the scalar loop
+			const auto alphaMask = pixelSize == 4 ? _mm_set1_epi32(int(0xFF000000)) : _mm_setzero_si128();
+			const auto alphaOne	 = _mm_and_si128(alphaMask, _mm_set1_epi8(127));
+			const auto input	 = reinterpret_cast<const __m128i*>(source);
+			size_t block { 0 };
+			for(; (block + 1) * 16 <= pixelCount * pixelSize; block++)
+				_mm_storeu_si128(output + block, _mm_or_si128(_mm_andnot_si128(alphaMask, unormToSnorm(_mm_loadu_si128(input + block))), alphaOne));
+			i = block * 16 / pixelSize;
+		}
+		else if(pixelSize == 4 && destinationPixelSize == 2)
+		{
+			//RGBA to RG : 8 pixels at a time. Sign extend the low 16 bits of each pixel so that the narrowing doesn't saturate them
+			const auto input = reinterpret_cast<const __m128i*>(source);
+			for(; i + 8 <= pixelCount; i += 8)
+			{
+				const auto low	= _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(input + i / 4), 16), 16);
+				const auto high = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(input + i / 4 + 1), 16), 16);
+				_mm_storeu_si128(output + i / 8, unormToSnorm(_mm_packs_epi32(low, high)));
+			}
+		}
+#endif
+		for(; i < pixelCount; i++)
+		{
+			for(size_t c { 0 }; c < std::min<size_t>(destinationPixelSize, 3); c++)
+				destination[i * destinationPixelSize + c] = unormToSnorm(source[i * pixelSize + c]);
+			if(destinationPixelSize == 4) destination[i * destinationPixelSize + 3] = 127;
+		}
+	}
+}
+
+size_t textureImporter::id { 0 };
+void textureImporter::loadTexture(int gltfTextureID)
+{
+	const auto name = getTextureName(gltfTextureID);
+	if(isTextureCreated(name))
 	{
 		//OgreLog("Texture " + name + " already loaded in Ogre::TextureManager");
 		return;
@@ -34,6 +237,19 @@ void textureImporter::loadTexture(const tinygltf::Texture& texture)
 
 	OgreLog("Loading texture image " + name);
 
+	//KTX2 images are uploaded with all their mip levels, as they are stored or transcoded. The other images, and the KTX2 ones that can't
+	//be uploaded this way, are loaded from their decoded pixels
+	const auto ktx2 = getKtx2Image(gltfTextureID);
+	if(ktx2 >= 0 && createKtx2Texture(name, ktx2, false, isHardwareGammaEnabled(), getMaxSize(gltfTextureID))) return;
+
+	const auto decoded = getDecodedImage(gltfTextureID);
+	if(!decoded)
+	{
+		OgreLog("Texture " + name + " doesn't have an image that can be loaded");
+		return;
+	}
+	const auto& image = *decoded;
+
 	const auto pixelFormat = [&] {
 		if(image.component == 3) return Ogre::PF_BYTE_RGB;
 		if(image.component == 4) return Ogre::PF_BYTE_RGBA;
@@ -46,31 +262,540 @@ void textureImporter::loadTexture(const tinygltf::Texture& texture)
 	{
 		OgreLog("I have no idea what is going on with the image format");
 	}
+	if(image.image.size() < size_t(image.width) * size_t(image.height) * size_t(image.component))
+		throw InitError("The image of " + name + " is smaller than its size");
+
+	if(isCompressionEnabled(Ogre::RSC_TEXTURE_COMPRESSION_DXT))
+	{
+		//Only keep the alpha channel if it is used. Decoded images already had an unused one removed, not the transcoded KTX2 ones
+		auto channels = size_t(image.component);
+		if(channels == 4 && isOpaque(image.image.data(), size_t(image.width) * size_t(image.height))) channels = 3;
+
+		auto format = channels == 4 ? textureCompressor::Format::BC3 : textureCompressor::Format::BC1;
+		if(options.compressTextures == importOptions::TextureCompression::Quality && isCompressionEnabled(Ogre::RSC_TEXTURE_COMPRESSION_BC6H_BC7))
+			format = textureCompressor::Format::BC7;
+		createCompressedTexture(name, gltfTextureID, format, 0, channels, isHardwareGammaEnabled(), Use::Color);
+		mipChains.erase({ gltfTextureID, isHardwareGammaEnabled() });
+		return;
+	}
+
+	//Streamed textures copy their levels from their own chain, on the thread of the textureStreamer
+	if(isStreamed(size_t(image.width), size_t(image.height)))
+	{
+		const auto chain = getStreamedMipChain(gltfTextureID, isHardwareGammaEnabled());
+		createStreamedTexture(name,
+							  size_t(image.width),
+							  size_t(image.height),
+							  chain->getLevelCount(),
+							  pixelFormat,
+							  isHardwareGammaEnabled(),
+							  Use::Color,
+							  [chain](size_t level, Ogre::uchar* output) {
+								  std::copy(chain->getPixels(level),
+											chain->getPixels(level) + chain->getWidth(level) * chain->getHeight(level) * chain->getPixelSize(),
+											output);
+							  },
+							  {});
+		mipChains.erase({ gltfTextureID, isHardwareGammaEnabled() });
+		return;
+	}
+
+	//The whole mip chain is uploaded, the GPU doesn't generate anything
+	const auto& chain = getMipChain(gltfTextureID, isHardwareGammaEnabled());
+	const auto OgreTexture
+		= createTexture(name, size_t(image.width), size_t(image.height), chain.getLevelCount(), pixelFormat, isHardwareGammaEnabled(), Use::Color);
+	for(size_t level { 0 }; level < chain.getLevelCount(); level++) writeLevel(OgreTexture, name, level, chain.getPixels(level));
+	mipChains.erase({ gltfTextureID, isHardwareGammaEnabled() });
+}
+
+const size_t textureImporter::maxArraySlices { 256 };
+
+Ogre::TexturePtr textureImporter::createTexture(
+	const std::string& name, size_t width, size_t height, size_t levelCount, Ogre::PixelFormat format, bool gamma, Use use)
+{
+	if(staging)
+	{
+		auto& staged = stagedTextures[name];
+		staged		 = { name, width, height, format, gamma, use, std::vector<std::vector<Ogre::uchar>>(levelCount) };
+		for(size_t level { 0 }; level < levelCount; level++)
+			staged.levels[level].resize(Ogre::PixelUtil::getMemorySize(
+				Ogre::uint32(std::max<size_t>(1, width >> level)), Ogre::uint32(std::max<size_t>(1, height >> level)), 1, format));
+		return {};
+	}
+
+	auto texture = Ogre::TextureManager::getSingleton().createManual(name,
+																	 Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+																	 Ogre::TextureType::TEX_TYPE_2D_ARRAY,
+																	 Ogre::uint(width),
+																	 Ogre::uint(height),
+																	 1,
+																	 int(levelCount) - 1,
+																	 format,
+																	 Ogre::TU_STATIC_WRITE_ONLY,
+																	 nullptr,
+																	 gamma);
+	registerTexture(name, { texture });
+	return texture;
+}
+
+bool textureImporter::isStreamed(size_t width, size_t height) const
+{
+	return options.streamTextures && options.generateMipmaps && !staging && std::max(width, height) > options.streamedLevelSize;
+}
+
+Ogre::TexturePtr textureImporter::createStreamedTexture(const std::string& name,
+														size_t width,
+														size_t height,
+														size_t levelCount,
+														Ogre::PixelFormat format,
+														bool gamma,
+														Use use,
+														std::function<void(size_t, Ogre::uchar*)> computeLevel,
+														std::function<void(const std::vector<std::vector<Ogre::uchar>>&)> onComplete)
+{
+	//The small texture starts at the first level that isn't bigger than streamedLevelSize
+	size_t firstLevel { 0 };
+	while(firstLevel + 1 < levelCount && std::max(width >> firstLevel, height >> firstLevel) > options.streamedLevelSize) firstLevel++;
+	const auto smallWidth  = std::max<size_t>(1, width >> firstLevel);
+	const auto smallHeight = std::max<size_t>(1, height >> firstLevel);
+
+	OgreLog("Streaming " + name + " : its " + std::to_string(firstLevel) + " biggest levels are computed in the background");
+	const auto texture = createTexture(name, smallWidth, smallHeight, levelCount - firstLevel, format, gamma, use);
+	std::vector<Ogre::uchar> pixels;
+	for(auto level = firstLevel; level < levelCount; level++)
+	{
+		pixels.resize(Ogre::PixelUtil::getMemorySize(
+			Ogre::uint32(std::max<size_t>(1, width >> level)), Ogre::uint32(std::max<size_t>(1, height >> level)), 1, format));
+		computeLevel(level, pixels.data());
+		writeLevel(texture, name, level - firstLevel, pixels.data());
+	}
+
+	auto streamed		   = std::make_unique<streamedTexture>();
+	streamed->name		   = name;
+	streamed->width		   = width;
+	streamed->height	   = height;
+	streamed->levelCount   = levelCount;
+	streamed->format	   = format;
+	streamed->computeLevel = std::move(computeLevel);
+	streamed->onComplete   = std::move(onComplete);
+	textureStreamer::getSingleton().add(std::move(streamed));
+	++statistics.streamedTextureCount;
+	return texture;
+}
+
+Ogre::PixelBox textureImporter::lockLevel(const Ogre::TexturePtr& texture, const std::string& name, size_t level)
+{
+	if(!texture)
+	{
+		//Staged levels are tightly packed
+		auto& staged = stagedTextures.at(name);
+		return { Ogre::uint32(std::max<size_t>(1, staged.width >> level)),
+				 Ogre::uint32(std::max<size_t>(1, staged.height >> level)),
+				 1,
+				 staged.format,
+				 staged.levels[level].data() };
+	}
+
+	const auto buffer = texture->getBuffer(0, level);
+	return buffer->lock({ 0, 0, buffer->getWidth(), buffer->getHeight() }, Ogre::v1::HardwareBuffer::LockOptions::HBL_DISCARD);
+}
+
+void textureImporter::unlockLevel(const Ogre::TexturePtr& texture, size_t level)
+{
+	if(texture) texture->getBuffer(0, level)->unlock();
+}
+
+void textureImporter::writeLevel(const Ogre::TexturePtr& texture, const std::string& name, size_t level, const Ogre::uchar* data)
+{
+	if(!texture)
+	{
+		auto& pixels = stagedTextures.at(name).levels[level];
+		std::copy(data, data + pixels.size(), pixels.begin());
+		return;
+	}
+
+	const auto buffer = texture->getBuffer(0, level);
+	buffer->blitFromMemory(Ogre::PixelBox(buffer->getWidth(), buffer->getHeight(), 1, texture->getFormat(), const_cast<Ogre::uchar*>(data)));
+}
+
+textureSlice textureImporter::findTexture(const std::string& name)
+{
+	if(acquiredTextures.count(name)) return textureRegistry::find(name);
+
+	//Textures made by the importers of other adapters, from the same image, are shared
+	const auto texture = textureRegistry::acquire(name);
+	if(texture.texture)
+	{
+		OgreLog("Reusing the texture " + name);
+		acquiredTextures.insert(name);
+		++statistics.reusedTextureCount;
+	}
+	return texture;
+}
+
+bool textureImporter::isTextureCreated(const std::string& name) { return stagedTextures.count(name) || findTexture(name).texture; }
+
+void textureImporter::registerTexture(const std::string& name, const textureSlice& texture)
+{
+	textureRegistry::add(name, texture);
+	acquiredTextures.insert(name);
+}
+
+void textureImporter::packStagedTextures()
+{
+	//Textures can share an array if they have the same size, format, number of levels, gamma and use
+	using arrayKey = std::tuple<size_t, size_t, Ogre::PixelFormat, size_t, bool, Use>;
+	std::map<arrayKey, std::vector<stagedTexture*>> groups;
+	for(auto& staged : stagedTextures)
+	{
+		auto& texture = staged.second;
+		groups[arrayKey { texture.width, texture.height, texture.format, texture.levels.size(), texture.gamma, texture.use }].push_back(&texture);
+	}
+
+	//The arrays are numbered by the statistics, which count the arrays of all the calls of loadTextures
+	auto textureManager = Ogre::TextureManager::getSingletonPtr();
+	for(const auto& group : groups)
+		for(size_t first { 0 }; first < group.second.size(); first += maxArraySlices)
+		{
+			//A texture alone in its group is created as it would have been without packing
+			const auto sliceCount = std::min(maxArraySlices, group.second.size() - first);
+			const auto& front	  = *group.second[first];
+			const auto name = sliceCount == 1 ? front.name : "glTF_textureArray_" + std::to_string(id) + "_" + std::to_string(statistics.textureArrayCount);
+			OgreLog("Packing " + std::to_string(sliceCount) + " textures in " + name);
+
+			auto texture = textureManager->createManual(name,
+														Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+														Ogre::TextureType::TEX_TYPE_2D_ARRAY,
+														Ogre::uint(front.width),
+														Ogre::uint(front.height),
+														Ogre::uint(sliceCount),
+														int(front.levels.size()) - 1,
+														front.format,
+														Ogre::TU_STATIC_WRITE_ONLY,
+														nullptr,
+														front.gamma);
+			for(size_t slice { 0 }; slice < sliceCount; slice++)
+			{
+				auto& staged = *group.second[first + slice];
+				for(size_t level { 0 }; level < staged.levels.size(); level++)
+				{
+					const auto width  = Ogre::uint32(std::max<size_t>(1, staged.width >> level));
+					const auto height = Ogre::uint32(std::max<size_t>(1, staged.height >> level));
+					texture->getBuffer(0, level)->blitFromMemory(Ogre::PixelBox(width, height, 1, staged.format, staged.levels[level].data()),
+																 Ogre::Box(0, 0, Ogre::uint32(slice), width, height, Ogre::uint32(slice + 1)));
+				}
+				registerTexture(staged.name, { texture, Ogre::uint16(slice) });
+			}
+
+			if(sliceCount > 1)
+			{
+				statistics.packedTextureCount += sliceCount;
+				++statistics.textureArrayCount;
+			}
+		}
+
+	stagedTextures.clear();
+}
+
+bool textureImporter::isFormatSupported(Ogre::Capabilities formats)
+{
+	return Ogre::Root::getSingleton().getRenderSystem()->getCapabilities()->hasCapability(formats);
+}
+
+bool textureImporter::isCompressionEnabled(Ogre::Capabilities formats) const
+{
+	if(options.compressTextures == importOptions::TextureCompression::None) return false;
+	return isFormatSupported(formats);
+}
+
+Ogre::PixelFormat textureImporter::getKtx2Format(const ktx2Image& ktx2, bool normal, basisTranscoder::Target& target) const
+{
+	const auto bc5 = isFormatSupported(Ogre::RSC_TEXTURE_COMPRESSION_BC4_BC5);
+	switch(ktx2.getEncoding())
+	{
+		case ktx2Image::Encoding::Raw:
+		{
+			//Normal maps can only be uploaded as they are if they are BC5 blocks, the pixels of the other formats need to be converted to SNORM
+			const auto format = ktx2.getPixelFormat();
+			if(normal) return format == Ogre::PF_BC5_UNORM && bc5 ? format : Ogre::PF_UNKNOWN;
+			if(format == Ogre::PF_DXT1 || format == Ogre::PF_DXT5) return isFormatSupported(Ogre::RSC_TEXTURE_COMPRESSION_DXT) ? format : Ogre::PF_UNKNOWN;
+			if(format == Ogre::PF_BC4_UNORM || format == Ogre::PF_BC5_UNORM) return bc5 ? format : Ogre::PF_UNKNOWN;
+			if(format == Ogre::PF_BC7_UNORM) return isFormatSupported(Ogre::RSC_TEXTURE_COMPRESSION_BC6H_BC7) ? format : Ogre::PF_UNKNOWN;
+			return format;
+		}
+		case ktx2Image::Encoding::ETC1S:
+		case ktx2Image::Encoding::UASTC:
+			//Transcode to the best block format the render system can sample
+			if(!options.transcoder) return Ogre::PF_UNKNOWN;
+			if(normal)
+			{
+				target = basisTranscoder::Target::BC5;
+				return bc5 ? Ogre::PF_BC5_UNORM : Ogre::PF_UNKNOWN;
+			}
+			if(isFormatSupported(Ogre::RSC_TEXTURE_COMPRESSION_BC6H_BC7))
+			{
+				target = basisTranscoder::Target::BC7;
+				return Ogre::PF_BC7_UNORM;
+			}
+			if(isFormatSupported(Ogre::RSC_TEXTURE_COMPRESSION_DXT))
+			{
+				target = ktx2.hasAlpha() ? basisTranscoder::Target::BC3 : basisTranscoder::Target::BC1;
+				return ktx2.hasAlpha() ? Ogre::PF_DXT5 : Ogre::PF_DXT1;
+			}
+			target = basisTranscoder::Target::RGBA8;
+			return Ogre::PF_BYTE_RGBA;
+		default: return Ogre::PF_UNKNOWN;
+	}
+}
+
+void textureImporter::transcodeKtx2Levels(const std::vector<std::pair<int, basisTranscoder::Target>>& images)
+{
+	//One job per level of each image. The biggest level is 3/4 of the work of an image, the jobs of all the images keep the threads busy
+	std::vector<std::vector<std::vector<Ogre::uchar>>> levels(images.size());
+	std::vector<std::pair<size_t, size_t>> jobs;
+	for(size_t i { 0 }; i < images.size(); i++)
+	{
+		const auto& file = model.images[images[i].first].image;
+		levels[i].resize(ktx2Image(file.data(), file.size()).getLevelCount());
+		for(size_t level { 0 }; level < levels[i].size(); level++) jobs.push_back({ i, level });
+	}
+
+	parallelFor(jobs.size(), [&](size_t job) {
+		const auto& image = images[jobs[job].first];
+		const auto& file  = model.images[image.first].image;
+		auto& output	  = levels[jobs[job].first][jobs[job].second];
+		if(!options.transcoder->transcode(file.data(), file.size(), jobs[job].second, image.second, output)) output.clear();
+	});
+
+	//Images with a level that failed, or that doesn't have the size of its format, are kept empty
+	for(size_t i { 0 }; i < images.size(); i++)
+	{
+		const auto& file = model.images[images[i].first].image;
+		const ktx2Image ktx2 { file.data(), file.size() };
+		const auto format = getTargetFormat(images[i].second);
+		for(size_t level { 0 }; level < levels[i].size(); level++)
+			if(levels[i][level].size() < Ogre::PixelUtil::getMemorySize(Ogre::uint32(std::max<size_t>(1, ktx2.getWidth() >> level)),
+																		 Ogre::uint32(std::max<size_t>(1, ktx2.getHeight() >> level)),
+																		 1,
+																		 format))
+			{
+				OgreLog("Could not transcode level " + std::to_string(level) + " of the KTX2 image " + std::to_string(images[i].first));
+				levels[i].clear();
+				break;
+			}
+		transcodedLevels[images[i].first] = std::move(levels[i]);
+	}
+}
+
+bool textureImporter::createKtx2Texture(const std::string& name, int imageIndex, bool normal, bool gamma, size_t maxSize)
+{
+	const auto& file	   = model.images[imageIndex].image;
+	const ktx2Image ktx2 { file.data(), file.size() };
+	auto target			   = basisTranscoder::Target::RGBA8;
+	const auto pixelFormat = getKtx2Format(ktx2, normal, target);
+	const auto levelCount  = ktx2.getLevelCount();
+	if(pixelFormat == Ogre::PF_UNKNOWN)
+	{
+		OgreLog("The KTX2 image of " + name + " can't be uploaded as it is stored, or transcoded");
+		return false;
+	}
+
+	//Basis Universal levels are transcoded now, unless loadTextures already did it along with the other textures
+	std::vector<std::vector<Ogre::uchar>> transcoded;
+	if(ktx2.getEncoding() != ktx2Image::Encoding::Raw)
+	{
+		if(!transcodedLevels.count(imageIndex)) transcodeKtx2Levels({ { imageIndex, target } });
+		transcoded = std::move(transcodedLevels[imageIndex]);
+		transcodedLevels.erase(imageIndex);
+		if(transcoded.size() != levelCount) return false;
+	}
+
+	//The levels bigger than the maximum size are skipped, the smallest level is kept whatever its size
+	size_t firstLevel { 0 };
+	while(maxSize > 0 && firstLevel + 1 < levelCount && std::max(ktx2.getWidth() >> firstLevel, ktx2.getHeight() >> firstLevel) > maxSize) firstLevel++;
+	const auto width  = std::max<size_t>(1, ktx2.getWidth() >> firstLevel);
+	const auto height = std::max<size_t>(1, ktx2.getHeight() >> firstLevel);
+
+	OgreLog("Uploading the " + std::to_string(levelCount - firstLevel) + " mip levels of the KTX2 image of " + name);
+	const auto OgreTexture = createTexture(name, width, height, levelCount - firstLevel, pixelFormat, gamma, normal ? Use::Normal : Use::Color);
+	for(size_t level { firstLevel }; level < levelCount; level++)
+		writeLevel(OgreTexture, name, level - firstLevel, transcoded.empty() ? ktx2.getLevelData(level) : transcoded[level].data());
+
+	return true;
+}
+
+const std::uint32_t textureImporter::compressedCacheVersion { 2 };
+
+Ogre::TexturePtr textureImporter::createCompressedTexture(const std::string& name,
+														  int gltfTextureID,
+														  textureCompressor::Format format,
+														  size_t firstChannel,
+														  size_t channels,
+														  bool gamma,
+														  Use use)
+{
+	const auto& image	   = *getDecodedImage(gltfTextureID);
+	const auto width	   = size_t(image.width);
+	const auto height	   = size_t(image.height);
+	const auto pixelSize   = size_t(image.component);
+	const auto highQuality = options.compressTextures == importOptions::TextureCompression::Quality;
+	const auto levelCount  = mipChain::countLevels(width, height, options.generateMipmaps);
+	const auto pixelFormat = textureCompressor::getPixelFormat(format);
+
+	if(firstChannel + channels > pixelSize || image.image.size() < width * height * pixelSize)
+		throw InitError("Can't compress " + name + " : the image doesn't have the needed channels");
+
+	//The blocks of all the levels are stored one after the other
+	std::vector<size_t> levelOffsets { 0 };
+	for(size_t level { 0 }; level < levelCount; level++)
+		levelOffsets.push_back(levelOffsets.back()
+							   + textureCompressor::getEncodedSize(format, std::max<size_t>(1, width >> level), std::max<size_t>(1, height >> level)));
+	const auto encodedSize = levelOffsets.back();
+	std::vector<Ogre::uchar> blocks(encodedSize);
+
+	//The cached blocks are identified by the content of the image and by everything that changes the encoding
+	const std::uint32_t header[] = { 0x4342474F,
+									 compressedCacheVersion,
+									 std::uint32_t(format),
+									 std::uint32_t(firstChannel),
+									 std::uint32_t(channels),
+									 std::uint32_t(highQuality),
+									 std::uint32_t(width),
+									 std::uint32_t(height),
+									 std::uint32_t(levelCount),
+									 std::uint32_t(gamma) };
+	std::string cachePath;
+	auto cached = false;
+	if(!options.textureCacheDirectory.empty())
+	{
+		const auto key = internal_utils::hashBytes(header, sizeof header, getImageHash(gltfTextureID));
+		cachePath	   = options.textureCacheDirectory + "/glTF_" + internal_utils::hashToString(key) + ".bcn";
+
+		std::ifstream cache(cachePath, std::ios_base::binary);
+		std::uint32_t cachedHeader[sizeof header / sizeof header[0]] {};
+		cached = cache.read(reinterpret_cast<char*>(cachedHeader), sizeof cachedHeader) && std::equal(std::begin(header), std::end(header), cachedHeader)
+				 && cache.read(reinterpret_cast<char*>(blocks.data()), std::streamsize(encodedSize));
+	}
+
+	if(cached && isStreamed(width, height))
+	{
+		//The cached blocks only need to be uploaded, the streamer does it a few textures at a time
+		const auto cachedBlocks = std::make_shared<const std::vector<Ogre::uchar>>(std::move(blocks));
+		return createStreamedTexture(name,
+									 width,
+									 height,
+									 levelCount,
+									 pixelFormat,
+									 gamma,
+									 use,
+									 [cachedBlocks, levelOffsets](size_t level, Ogre::uchar* output) {
+										 std::copy(cachedBlocks->begin() + levelOffsets[level], cachedBlocks->begin() + levelOffsets[level + 1], output);
+									 },
+									 {});
+	}
+
+	if(!cached && isStreamed(width, height))
+	{
+		//The levels are encoded by the streamer from its own copy of the mip chain, and written to the cache once they are all encoded
+		OgreLog("Compressing " + name + " in the background");
+		const textureCompressor compressor { highQuality };
+		const auto chain = getStreamedMipChain(gltfTextureID, gamma);
+		return createStreamedTexture(
+			name,
+			width,
+			height,
+			levelCount,
+			pixelFormat,
+			gamma,
+			use,
+			[=](size_t level, Ogre::uchar* output) {
+				const auto levelWidth  = chain->getWidth(level);
+				const auto levelHeight = chain->getHeight(level);
+				const auto rowSize	   = textureCompressor::getEncodedSize(format, levelWidth, 4);
+				for(size_t blockRow { 0 }; blockRow < (levelHeight + 3) / 4; blockRow++)
+					compressor.encodeBlockRow(
+						format, chain->getPixels(level) + firstChannel, levelWidth, levelHeight, pixelSize, channels, blockRow, output + blockRow * rowSize);
+			},
+			[=](const std::vector<std::vector<Ogre::uchar>>& levels) {
+				if(cachePath.empty()) return;
+				std::vector<Ogre::uchar> encoded;
+				for(const auto& level : levels) encoded.insert(encoded.end(), level.begin(), level.end());
+				writeCompressedCache(cachePath, header, sizeof header, encoded);
+			});
+	}
+
+	if(!cached)
+	{
+		//The mip levels are computed here, and only here, when the blocks are not in the cache
+		OgreLog("Compressing " + name);
+		const textureCompressor compressor { highQuality };
+		const auto& chain = getMipChain(gltfTextureID, gamma);
+		for(size_t level { 0 }; level < levelCount; level++)
+		{
+			const auto levelWidth  = chain.getWidth(level);
+			const auto levelHeight = chain.getHeight(level);
+			const auto rowSize	   = textureCompressor::getEncodedSize(format, levelWidth, 4);
+			const auto output	   = blocks.data() + levelOffsets[level];
+			forEachRows((levelHeight + 3) / 4, [&](size_t first, size_t last) {
+				for(auto blockRow = first; blockRow < last; blockRow++)
+					compressor.encodeBlockRow(
+						format, chain.getPixels(level) + firstChannel, levelWidth, levelHeight, pixelSize, channels, blockRow, output + blockRow * rowSize);
+			});
+		}
+
+		if(!cachePath.empty()) writeCompressedCache(cachePath, header, sizeof header, blocks);
+	}
 
-	Ogre::Image OgreImage;
+	//Block compressed textures can't have their mipmaps generated by the GPU, the levels computed on the CPU are all uploaded
+	const auto OgreTexture = createTexture(name, width, height, levelCount, pixelFormat, gamma, use);
+	for(size_t level { 0 }; level < levelCount; level++) writeLevel(OgreTexture, name, level, blocks.data() + levelOffsets[level]);
+	return OgreTexture;
+}
 
-	//The OgreImage class *can* take ownership of the pointer to the data and automatically delete it.
-	//We *don't* want that. 6th argument needs to be set to false to prevent that.
-	//The rest of the funciton is not modifying the model.images[x].image object. We get the image as a const ref.
-	//In order to keep the rest of this code const correct, and knowing that the "autoDelete" is specifically
-	//set to `false`, we're casting away const on the pointer to get the image data.
-	OgreImage.loadDynamicImage(const_cast<Ogre::uchar*>(image.image.data()), image.width, image.height, 1, pixelFormat, false);
+void textureImporter::generateMipChains(const std::vector<std::pair<int, bool>>& textures)
+{
+	std::vector<mipChain*> chains;
+	for(const auto& texture : textures)
+	{
+		if(mipChains.count(texture)) continue;
+		const auto image = getDecodedImage(texture.first);
+		if(!image || image->component <= 0 || image->image.size() < size_t(image->width) * size_t(image->height) * size_t(image->component)) continue;
+		auto& chain = mipChains[texture];
+		chain		= std::make_shared<mipChain>(
+			  image->image.data(), size_t(image->width), size_t(image->height), size_t(image->component), texture.second, options.generateMipmaps);
+		chains.push_back(chain.get());
+	}
 
-	OgreTexture = textureManager->createManual(name,
-											   Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-											   Ogre::TextureType::TEX_TYPE_2D_ARRAY,
-											   image.width,
-											   image.height,
-											   1,
-											   1,
-											   pixelFormat,
-											   Ogre::TU_DEFAULT,
-											   nullptr,
-											   isHardwareGammaEnabled());
+	//Each level needs the previous one. The rows of the same level of all the images are computed together, in blocks of rows
+	const size_t rowsPerBlock { 64 };
+	for(size_t level { 1 };; level++)
+	{
+		std::vector<std::pair<mipChain*, size_t>> jobs;
+		for(const auto chain : chains)
+			if(level < chain->getLevelCount())
+				for(size_t row { 0 }; row < chain->getHeight(level); row += rowsPerBlock) jobs.push_back({ chain, row });
+		if(jobs.empty()) break;
 
-	OgreTexture->loadImage(OgreImage);
+		parallelFor(jobs.size(), [&](size_t job) {
+			const auto chain = jobs[job].first;
+			const auto first = jobs[job].second;
+			chain->downsampleRows(level, first, std::min(chain->getHeight(level), first + rowsPerBlock));
+		});
+	}
+}
 
-	loadedTextures.insert({ texture.source, OgreTexture });
+const mipChain& textureImporter::getMipChain(int gltfTextureID, bool gamma)
+{
+	generateMipChains({ { gltfTextureID, gamma } });
+	return *mipChains.at({ gltfTextureID, gamma });
+}
+
+std::shared_ptr<const mipChain> textureImporter::getStreamedMipChain(int gltfTextureID, bool gamma)
+{
+	generateMipChains({ { gltfTextureID, gamma } });
+	const auto& chain = mipChains.at({ gltfTextureID, gamma });
+	chain->keepImage();
+	return chain;
 }
 
 bool textureImporter::isHardwareGammaEnabled() const
@@ -102,145 +827,560 @@ bool textureImporter::isHardwareGammaEnabled() const
 	return false;
 }
 
-textureImporter::textureImporter(tinygltf::Model& input) : model { input } { id++; }
+textureImporter::textureImporter(tinygltf::Model& input, const importOptions& importSettings, loadStatistics& adapterStatistics) :
+ model { input }, options { importSettings }, statistics { adapterStatistics }
+{
+	id++;
+}
+
+textureImporter::~textureImporter()
+{
+	//The importer doesn't keep any texture alive once its references are released
+	loadedTextures.clear();
+	for(const auto& name : acquiredTextures) textureRegistry::release(name);
+}
+
+void textureImporter::parallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+	if(options.textureThreadCount == 1 || count <= 1)
+	{
+		for(size_t i { 0 }; i < count; i++) function(i);
+		return;
+	}
+
+	if(!threads) threads = std::make_unique<threadPool>(options.textureThreadCount);
+	threads->parallelFor(count, function);
+}
+
+void textureImporter::forEachRows(size_t height, const std::function<void(size_t, size_t)>& function)
+{
+	//Blocks of rows big enough to not spend more time dispatching than converting
+	const size_t rowsPerBlock { 64 };
+	parallelFor((height + rowsPerBlock - 1) / rowsPerBlock,
+				[&](size_t block) { function(block * rowsPerBlock, std::min(height, (block + 1) * rowsPerBlock)); });
+}
+
+std::string textureImporter::getTextureName(int gltfTextureID, const std::string& variant)
+{
+	const auto processing  = variant.empty() && isHardwareGammaEnabled() ? std::string("_sRGB") : variant;
+	const auto preset	   = options.compressTextures == importOptions::TextureCompression::Fast ? "_fast" : "_quality";
+	const auto compression = options.compressTextures == importOptions::TextureCompression::None ? "" : preset;
+	const auto maxSize	   = getMaxSize(gltfTextureID);
+	const auto resolution  = maxSize > 0 ? "_max" + std::to_string(maxSize) : std::string();
+	const auto storage	   = std::string(options.packTextureArrays ? "_packed" : "") + (options.streamTextures ? "_streamed" : "");
+	return "glTF_texture_" + internal_utils::hashToString(getImageHash(gltfTextureID)) + processing + compression + resolution
+		   + (options.generateMipmaps ? "" : "_noMips") + storage;
+}
+
+std::string textureImporter::getTextureKey(int gltfTextureID)
+{
+	//The name of the color texture covers every option but the format of the normal maps
+	return getTextureName(gltfTextureID) + (options.twoChannelNormalMaps ? "_NormalRG" : "");
+}
+
+int textureImporter::getKtx2Image(int gltfTextureID) const
+{
+	//KHR_texture_basisu gives the KTX2 image, the source of the texture is then an optional fallback for loaders without the extension
+	const auto& texture	 = model.textures[gltfTextureID];
+	const auto extension = internal_utils::findExtension(texture.extensions, "KHR_texture_basisu");
+	const auto source	 = extension ? int(internal_utils::getNumber(*extension, "source", -1)) : texture.source;
+	if(source < 0 || size_t(source) >= model.images.size()) return -1;
+
+	const auto& image = model.images[source];
+	return image.component == 0 && ktx2Image::isKtx2(image.image.data(), image.image.size()) ? source : -1;
+}
 
 void textureImporter::loadTextures()
 {
-	for(const auto& texture : model.textures) { loadTexture(texture); }
+	//Textures that materials only use as normal, metallicRoughness or occlusion maps never need a color texture. They are converted
+	//by their own functions, loading (and compressing) them as colors would be a waste
+	std::vector<bool> colorTextures(model.textures.size(), false), dataTextures(model.textures.size(), false);
+	std::vector<bool> metalRoughTextures(model.textures.size(), false), normalTextures(model.textures.size(), false);
+	for(const auto& material : model.materials)
+		for(const auto parameters : { &material.values, &material.additionalValues })
+			for(const auto& parameter : *parameters)
+			{
+				const auto index = parameter.second.json_double_value.find("index");
+				if(index == parameter.second.json_double_value.end() || index->second < 0 || size_t(index->second) >= model.textures.size()) continue;
+				const auto color = parameter.first == "baseColorTexture" || parameter.first == "emissiveTexture";
+				(color ? colorTextures : dataTextures)[size_t(index->second)] = true;
+				if(parameter.first == "metallicRoughnessTexture") metalRoughTextures[size_t(index->second)] = true;
+				if(parameter.first == "normalTexture") normalTextures[size_t(index->second)] = true;
+			}
+
+	std::vector<int> textures;
+	for(size_t texture { 0 }; texture < model.textures.size(); texture++)
+		if(colorTextures[texture] || !dataTextures[texture]) textures.push_back(int(texture));
+
+	//Transcode the Basis Universal images of all these textures at once, so that all their levels are spread on the threads
+	std::vector<std::pair<int, basisTranscoder::Target>> transcoded;
+	for(const auto texture : textures)
+	{
+		const auto image = getKtx2Image(texture);
+		if(image < 0 || transcodedLevels.count(image) || isTextureCreated(getTextureName(texture))) continue;
+
+		const auto& file = model.images[image].image;
+		const ktx2Image ktx2 { file.data(), file.size() };
+		auto target = basisTranscoder::Target::RGBA8;
+		if(ktx2.getEncoding() == ktx2Image::Encoding::Raw || getKtx2Format(ktx2, false, target) == Ogre::PF_UNKNOWN) continue;
+		if(std::find_if(transcoded.begin(), transcoded.end(), [&](const std::pair<int, basisTranscoder::Target>& pending) { return pending.first == image; })
+		   == transcoded.end())
+			transcoded.push_back({ image, target });
+	}
+	if(!transcoded.empty()) transcodeKtx2Levels(transcoded);
+
+	//Same for the mip chains of the other textures. Compressed textures that can be in the cache compute theirs only if they are not
+	const auto cached = !options.textureCacheDirectory.empty() && isCompressionEnabled(Ogre::RSC_TEXTURE_COMPRESSION_DXT);
+	std::vector<std::pair<int, bool>> chains;
+	for(const auto texture : textures)
+	{
+		if(cached || isTextureCreated(getTextureName(texture))) continue;
+		const auto image = getKtx2Image(texture);
+		auto target		 = basisTranscoder::Target::RGBA8;
+		if(image >= 0
+		   && getKtx2Format(ktx2Image(model.images[image].image.data(), model.images[image].image.size()), false, target) != Ogre::PF_UNKNOWN)
+			continue;
+		if(getDecodedImage(texture)) chains.push_back({ texture, isHardwareGammaEnabled() });
+	}
+	generateMipChains(chains);
+
+	if(!options.packTextureArrays)
+	{
+		for(const auto texture : textures) loadTexture(texture);
+		return;
+	}
+
+	//The metalness, roughness and normal textures are created here too. They are all staged in memory, then packed by size, format and use
+	staging = true;
+	try
+	{
+		for(const auto texture : textures) loadTexture(texture);
+		for(size_t texture { 0 }; texture < model.textures.size(); texture++)
+		{
+			if(metalRoughTextures[texture]) getMetalRoughTextures(int(texture));
+			if(normalTextures[texture]) getNormalSNORM(int(texture));
+		}
+	}
+	catch(...)
+	{
+		staging = false;
+		stagedTextures.clear();
+		throw;
+	}
+	staging = false;
+	packStagedTextures();
 }
 
-Ogre::TexturePtr textureImporter::getTexture(int glTFTextureSourceID)
+textureSlice textureImporter::getTexture(int gltfTextureID)
 {
-	auto texture = loadedTextures.find(glTFTextureSourceID);
-	if(texture == std::end(loadedTextures)) return {};
+	auto texture = loadedTextures.find(gltfTextureID);
+	if(texture == std::end(loadedTextures))
+	{
+		//Textures skipped by loadTextures are loaded the first time they are needed
+		if(gltfTextureID < 0 || size_t(gltfTextureID) >= model.textures.size()) return {};
+		loadTexture(gltfTextureID);
+		const auto slice = findTexture(getTextureName(gltfTextureID));
+		if(!slice.texture) return {};
+		texture = loadedTextures.insert({ gltfTextureID, slice }).first;
+	}
 
 	return texture->second;
 }
 
-Ogre::TexturePtr textureImporter::generateGreyScaleFromChannel(int gltfTextureSourceID, int channel)
+const tinygltf::Image* textureImporter::getDecodedImage(int gltfTextureID)
 {
-	auto textureManager = Ogre::TextureManager::getSingletonPtr();
-	const auto& image   = model.images[gltfTextureSourceID];
+	if(gltfTextureID < 0 || size_t(gltfTextureID) >= model.textures.size()) return nullptr;
 
-	assert(channel < 4 && channel >= 0 /*, "Channel needs to be between 0 and 3"*/);
-	const auto name = "glTF_texture_" + image.name + std::to_string(id) + std::to_string(gltfTextureSourceID) + "_greyscale_channel" + std::to_string(channel);
+	//The source image is decoded to the layout of the texture, unless it is a KTX2 image
+	const auto source = model.textures[gltfTextureID].source;
+	if(source >= 0 && size_t(source) < model.images.size())
+	{
+		const auto& sourceImage = model.images[source];
+		if(sourceImage.component > 0) return &sourceImage;
+		if(!ktx2Image::isKtx2(sourceImage.image.data(), sourceImage.image.size())) return decodeImage(gltfTextureID, source);
+	}
 
-	auto texture = textureManager->getByName(name);
-	if(texture)
+	//Textures that only have a KTX2 image get it as RGBA8 pixels, copied from the file or transcoded
+	const auto ktx2Index = getKtx2Image(gltfTextureID);
+	if(ktx2Index < 0) return nullptr;
+	auto decoded = decodedImages.find(gltfTextureID);
+	if(decoded == decodedImages.end())
 	{
-		//OgreLog("texture " + name + "Already loaded in Ogre::TextureManager");
-		return texture;
+		decoded			 = decodedImages.insert({ gltfTextureID, {} }).first;
+		auto& image		 = decoded->second;
+		const auto& file = model.images[ktx2Index].image;
+		const ktx2Image ktx2 { file.data(), file.size() };
+		const auto size = ktx2.getWidth() * ktx2.getHeight() * 4;
+		image.name		= model.images[ktx2Index].name;
+		image.width		= int(ktx2.getWidth());
+		image.height	= int(ktx2.getHeight());
+		image.component = 4;
+		image.bits		= 8;
+
+		if(ktx2.getEncoding() == ktx2Image::Encoding::Raw && ktx2.getPixelFormat() == Ogre::PF_BYTE_RGBA)
+			image.image.assign(ktx2.getLevelData(0), ktx2.getLevelData(0) + size);
+		else if(ktx2.getEncoding() != ktx2Image::Encoding::Raw && ktx2.getEncoding() != ktx2Image::Encoding::Unsupported && options.transcoder)
+		{
+			OgreLog("Transcoding the KTX2 image " + std::to_string(ktx2Index) + " to RGBA8 pixels");
+			if(!options.transcoder->transcode(file.data(), file.size(), 0, basisTranscoder::Target::RGBA8, image.image) || image.image.size() < size)
+				image.image.clear();
+		}
+
+		if(image.image.empty())
+			OgreLog("The KTX2 image " + std::to_string(ktx2Index) + " can't be decoded");
+		else
+			downscale(gltfTextureID, image);
 	}
 
-	OgreLog("Can't find texure " + name + ". Generating it from glTF");
+	return decoded->second.image.empty() ? nullptr : &decoded->second;
+}
+
+const tinygltf::Image* textureImporter::decodeImage(int gltfTextureID, int imageIndex)
+{
+	auto decoded = decodedImages.find(gltfTextureID);
+	if(decoded == decodedImages.end())
+	{
+		//The loader kept the encoded file. The decoder of the options is tried first, stb decodes the images it can't
+		const auto& encoded = model.images[imageIndex];
+		const auto layout	= getImageLayout(gltfTextureID);
+		OgreLog("Decoding image " + std::to_string(imageIndex));
+		decoded		= decodedImages.insert({ gltfTextureID, {} }).first;
+		auto& image = decoded->second;
+		size_t width { 0 }, height { 0 }, channels { 0 };
+		const auto decode = [&](const imageDecoder& decoder) {
+			if(!decoder.decode(encoded.image.data(), encoded.image.size(), layout, image.image, width, height, channels)) return false;
+			const auto validChannels = channels == 3 || (channels == 4 && layout == imageDecoder::Layout::Color);
+			return validChannels && width > 0 && height > 0 && image.image.size() >= width * height * channels;
+		};
+
+		if((options.decoder && decode(*options.decoder)) || decode(stbImageDecoder {}))
+		{
+			image.name		= encoded.name;
+			image.width		= int(width);
+			image.height	= int(height);
+			image.component = int(channels);
+			image.bits		= 8;
+
+			//An alpha channel that is 255 everywhere doesn't change anything, the texture, its mip chain and its compression do without it
+			if(channels == 4 && isOpaque(image.image.data(), width * height))
+			{
+				dropAlpha(image.image, width * height);
+				image.component = 3;
+			}
+			downscale(gltfTextureID, image);
+		}
+		else
+		{
+			OgreLog("The image " + std::to_string(imageIndex) + " can't be decoded");
+			image.image.clear();
+		}
+	}
+
+	return decoded->second.image.empty() ? nullptr : &decoded->second;
+}
+
+const std::array<bool, 3>& textureImporter::getUses(int gltfTextureID) const
+{
+	//The materials don't change once the file is loaded, the roles of all the textures are found once
+	if(textureUses.empty())
+	{
+		textureUses.resize(model.textures.size());
+		for(const auto& material : model.materials)
+			for(const auto values : { &material.values, &material.additionalValues })
+				for(const auto& value : *values)
+				{
+					const auto texture = value.second.TextureIndex();
+					if(texture < 0 || size_t(texture) >= textureUses.size()) continue;
+					const auto use = value.first == "metallicRoughnessTexture" ? Use::MetalRough
+									 : value.first == "normalTexture"		   ? Use::Normal
+																			   : Use::Color;
+					textureUses[size_t(texture)][size_t(use)] = true;
+				}
+
+		for(auto& uses : textureUses)
+			if(!uses[size_t(Use::MetalRough)] && !uses[size_t(Use::Normal)]) uses[size_t(Use::Color)] = true;
+	}
+
+	return textureUses[size_t(gltfTextureID)];
+}
 
-	assert(channel < image.component);
+imageDecoder::Layout textureImporter::getImageLayout(int gltfTextureID) const
+{
+	//The alpha of the metalness and roughness images is never read, it is dropped while decoding
+	const auto& uses = getUses(gltfTextureID);
+	return uses[size_t(Use::MetalRough)] && !uses[size_t(Use::Color)] && !uses[size_t(Use::Normal)] ? imageDecoder::Layout::RGB8
+																									 : imageDecoder::Layout::Color;
+}
 
-	//Greyscale the image by putting all channel to the same value, ignoring alpha
-	std::vector<Ogre::uchar> imageData(image.image.size());
-	const auto pixelCount { imageData.size() / image.component };
-	for(size_t i { 0 }; i < pixelCount; i++) //for each pixel
+size_t textureImporter::getMaxSize(int gltfTextureID) const
+{
+	//Each role has its own limit, or the global one. A role without any limit leaves the texture as it is
+	const size_t roleLimits[] = { options.maxColorTextureSize, options.maxMetalRoughTextureSize, options.maxNormalTextureSize };
+	const auto& uses		  = getUses(gltfTextureID);
+	size_t maxSize { 0 };
+	for(size_t use { 0 }; use < uses.size(); use++)
 	{
-		//Get the channel that has the value
-		Ogre::uchar grey = image.image[(i * image.component) + channel];
+		if(!uses[use]) continue;
+		const auto limit = roleLimits[use] > 0 ? roleLimits[use] : options.maxTextureSize;
+		if(limit == 0) return 0;
+		maxSize = std::max(maxSize, limit);
+	}
 
-		//Turn pixel at this specific shade of grey
-		for(size_t c { 0 }; c < 3; c++) imageData[i * image.component + c] = grey;
+	//The loader read the size of the images from their header, before decoding them
+	const auto ktx2	  = getKtx2Image(gltfTextureID);
+	const auto source = ktx2 >= 0 ? ktx2 : model.textures[gltfTextureID].source;
+	if(source < 0 || size_t(source) >= model.images.size()) return 0;
+	const auto& image = model.images[source];
+	return size_t(std::max(image.width, image.height)) > maxSize ? maxSize : 0;
+}
+
+void textureImporter::downscale(int gltfTextureID, tinygltf::Image& image)
+{
+	const auto maxSize = getMaxSize(gltfTextureID);
+	const auto width   = size_t(image.width);
+	const auto height  = size_t(image.height);
+	if(maxSize == 0 || std::max(width, height) <= maxSize) return;
 
-		//If there's an alpha channel, put it to 1.0f (255)
-		if(image.component > 3) imageData[i * image.component + 3] = 255;
+	//The levels of a mip chain are the halved images, filtered like the mipmaps of the texture will be. Colors are filtered as sRGB
+	const auto gamma = getUses(gltfTextureID)[size_t(Use::Color)] && isHardwareGammaEnabled();
+	mipChain chain { image.image.data(), width, height, size_t(image.component), gamma, true };
+	size_t level { 0 };
+	while(level + 1 < chain.getLevelCount() && std::max(chain.getWidth(level), chain.getHeight(level)) > maxSize)
+	{
+		level++;
+		forEachRows(chain.getHeight(level), [&](size_t first, size_t last) { chain.downsampleRows(level, first, last); });
 	}
 
-	const auto pixelFormat = [&] {
-		if(image.component == 3) return Ogre::PF_BYTE_RGB;
-		if(image.component == 4) return Ogre::PF_BYTE_RGBA;
+	OgreLog("Downscaling image " + image.name + " from " + std::to_string(width) + "x" + std::to_string(height) + " to "
+			+ std::to_string(chain.getWidth(level)) + "x" + std::to_string(chain.getHeight(level)));
+	std::vector<Ogre::uchar> pixels(chain.getPixels(level), chain.getPixels(level) + chain.getWidth(level) * chain.getHeight(level) * chain.getPixelSize());
+	image.image.swap(pixels);
+	image.width	 = int(chain.getWidth(level));
+	image.height = int(chain.getHeight(level));
+}
 
-		OgreLog("unrecognized pixel format from tinygltf image");
-		throw InitError("Can get " + name + "pixel format");
-	}();
+bool textureImporter::hasAlphaChannel(int gltfTextureID)
+{
+	if(gltfTextureID < 0 || size_t(gltfTextureID) >= model.textures.size()) return false;
 
-	Ogre::Image OgreImage;
-	Ogre::TexturePtr OgreTexture;
-
-	//TODO refactor this
-
-	//The OgreImage class *can* take ownership of the pointer to the data and automatically delete it.
-	//We *don't* want that. 6th argument needs to be set to false to prevent that.
-	//The rest of the funciton is not modifying the model.images[x].image object. We get the image as a const ref.
-	//In order to keep the rest of this code const correct, and knowing that the "autoDelete" is specifically
-	//set to `false`, we're casting away const on the pointer to get the image data.
-	OgreImage.loadDynamicImage(imageData.data(), image.width, image.height, 1, pixelFormat, false);
-
-	OgreTexture = textureManager->createManual(name,
-											   Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-											   Ogre::TextureType::TEX_TYPE_2D_ARRAY,
-											   image.width,
-											   image.height,
-											   1,
-											   1,
-											   pixelFormat,
-											   Ogre::TU_DEFAULT,
-											   nullptr,
-											   isHardwareGammaEnabled());
-	OgreTexture->loadImage(OgreImage);
-	return OgreTexture;
+	const auto ktx2 = getKtx2Image(gltfTextureID);
+	if(ktx2 >= 0) return ktx2Image(model.images[ktx2].image.data(), model.images[ktx2].image.size()).hasAlpha();
+
+	const auto image = getDecodedImage(gltfTextureID);
+	return image && image->component % 2 == 0;
 }
 
-Ogre::TexturePtr textureImporter::getNormalSNORM(int gltfTextureSourceID)
+std::uint64_t textureImporter::getImageHash(int gltfTextureID)
 {
-	auto textureManager = Ogre::TextureManager::getSingletonPtr();
-	const auto& image   = model.images[gltfTextureSourceID];
-	const auto name		= "glTF_texture_" + image.name + std::to_string(id) + std::to_string(gltfTextureSourceID) + "_NormalFixed";
+	if(gltfTextureID < 0 || size_t(gltfTextureID) >= model.textures.size()) return 0;
+	const auto hashed = imageHashes.find(gltfTextureID);
+	if(hashed != imageHashes.end()) return hashed->second;
+
+	//Images are hashed as they are stored in the file, without decoding or transcoding them
+	const auto ktx2	  = getKtx2Image(gltfTextureID);
+	const auto source = ktx2 >= 0 ? ktx2 : model.textures[gltfTextureID].source;
+	if(source < 0 || size_t(source) >= model.images.size()) return imageHashes[gltfTextureID] = 0;
+	const auto image = &model.images[source];
+
+	const std::int32_t size[] = { image->width, image->height, image->component };
+	return imageHashes[gltfTextureID] = internal_utils::hashBytes(image->image.data(), image->image.size(), internal_utils::hashBytes(size, sizeof size));
+}
+
+bool textureImporter::getUniformColor(int gltfTextureID, std::array<Ogre::uchar, 4>& color)
+{
+	auto checked = uniformColors.find(gltfTextureID);
+	if(checked == uniformColors.end())
+	{
+		const auto decoded = getDecodedImage(gltfTextureID);
+		std::pair<bool, std::array<Ogre::uchar, 4>> result { false, { { 0, 0, 0, 255 } } };
+
+		if(decoded && decoded->component >= 1 && decoded->component <= 4 && decoded->image.size() >= size_t(decoded->component))
+		{
+			const auto& image	 = *decoded;
+			const auto pixelSize = size_t(image.component);
+			result.first		 = isUniform(image.image.data(), size_t(image.width) * size_t(image.height) * pixelSize, pixelSize);
+
+			//Greyscale images have their value in the 3 color channels
+			std::copy(image.image.begin(), image.image.begin() + std::min<size_t>(pixelSize, 3), result.second.begin());
+			if(pixelSize < 3) result.second[1] = result.second[2] = result.second[0];
+			if(pixelSize == 2 || pixelSize == 4) result.second[3] = image.image[pixelSize - 1];
+		}
+
+		checked = uniformColors.insert({ gltfTextureID, result }).first;
+	}
+
+	color = checked->second.second;
+	return checked->second.first;
+}
 
-	auto texture = textureManager->getByName(name);
-	if(texture)
+std::pair<textureSlice, textureSlice> textureImporter::getMetalRoughTextures(int gltfTextureID)
+{
+	if(gltfTextureID < 0 || size_t(gltfTextureID) >= model.textures.size()) return {};
+	const auto metalnessName = getTextureName(gltfTextureID, "_channel2");
+	const auto roughnessName = getTextureName(gltfTextureID, "_channel1");
+
+	const std::pair<textureSlice, textureSlice> textures { findTexture(metalnessName), findTexture(roughnessName) };
+	if(textures.first.texture && textures.second.texture)
+	{
+		//OgreLog("texture " + metalnessName + "Already loaded in Ogre::TextureManager");
+		return textures;
+	}
+	if(stagedTextures.count(metalnessName)) return {};
+
+	OgreLog("Can't find textures " + metalnessName + " and " + roughnessName + ". Generating them from glTF");
+
+	const auto decoded = getDecodedImage(gltfTextureID);
+	if(!decoded) return {};
+	const auto& image = *decoded;
+
+	if(image.component < 3 || image.image.size() < size_t(image.width) * size_t(image.height) * size_t(image.component))
+		throw InitError("Can't extract the metalness and roughness of " + metalnessName + " : the image doesn't have a blue and a green channel");
+
+	if(isCompressionEnabled(Ogre::RSC_TEXTURE_COMPRESSION_BC4_BC5))
+	{
+		createCompressedTexture(metalnessName, gltfTextureID, textureCompressor::Format::BC4, 2, 1, false, Use::MetalRough);
+		createCompressedTexture(roughnessName, gltfTextureID, textureCompressor::Format::BC4, 1, 1, false, Use::MetalRough);
+		mipChains.erase({ gltfTextureID, false });
+		return { findTexture(metalnessName), findTexture(roughnessName) };
+	}
+
+	//Metal and rough are linear values, they are stored in single channel textures that are never gamma corrected
+	const auto width  = size_t(image.width);
+	const auto height = size_t(image.height);
+	if(isStreamed(width, height))
+	{
+		//Each streamed texture extracts its own channel from the shared chain
+		const auto chain = getStreamedMipChain(gltfTextureID, false);
+		for(const auto& channel : { std::make_pair(metalnessName, size_t(2)), std::make_pair(roughnessName, size_t(1)) })
+			createStreamedTexture(channel.first,
+								  width,
+								  height,
+								  chain->getLevelCount(),
+								  Ogre::PF_L8,
+								  false,
+								  Use::MetalRough,
+								  [chain, index = channel.second](size_t level, Ogre::uchar* output) {
+									  const auto pixelCount = chain->getWidth(level) * chain->getHeight(level);
+									  extractChannel(chain->getPixels(level), pixelCount, chain->getPixelSize(), index, output);
+								  },
+								  {});
+		mipChains.erase({ gltfTextureID, false });
+		return { findTexture(metalnessName), findTexture(roughnessName) };
+	}
+
+	const auto& chain = getMipChain(gltfTextureID, false);
+	const std::pair<Ogre::TexturePtr, Ogre::TexturePtr> created {
+		createTexture(metalnessName, width, height, chain.getLevelCount(), Ogre::PF_L8, false, Use::MetalRough),
+		createTexture(roughnessName, width, height, chain.getLevelCount(), Ogre::PF_L8, false, Use::MetalRough)
+	};
+
+	//Extract both channels of each level in one pass, straight into the texture buffers
+	for(size_t level { 0 }; level < chain.getLevelCount(); level++)
+	{
+		const auto metalness = lockLevel(created.first, metalnessName, level);
+		const auto roughness = lockLevel(created.second, roughnessName, level);
+		const auto rowSize	 = chain.getWidth(level) * chain.getPixelSize();
+		for(size_t y { 0 }; y < chain.getHeight(level); y++)
+			extractMetalRough(chain.getPixels(level) + y * rowSize,
+							  chain.getWidth(level),
+							  chain.getPixelSize(),
+							  static_cast<Ogre::uchar*>(metalness.data) + y * metalness.rowPitch,
+							  static_cast<Ogre::uchar*>(roughness.data) + y * roughness.rowPitch);
+		unlockLevel(created.first, level);
+		unlockLevel(created.second, level);
+	}
+	mipChains.erase({ gltfTextureID, false });
+
+	return { findTexture(metalnessName), findTexture(roughnessName) };
+}
+
+textureSlice textureImporter::getNormalSNORM(int gltfTextureID)
+{
+	if(gltfTextureID < 0 || size_t(gltfTextureID) >= model.textures.size()) return {};
+	const auto compressed  = isCompressionEnabled(Ogre::RSC_TEXTURE_COMPRESSION_BC4_BC5);
+	const auto twoChannels = options.twoChannelNormalMaps;
+	const auto name		   = getTextureName(gltfTextureID, compressed ? "_NormalBC5" : twoChannels ? "_NormalRG" : "_NormalFixed");
+
+	const auto texture = findTexture(name);
+	if(texture.texture)
 	{
 		//OgreLog("texture " + name + "Already loaded in Ogre::TextureManager");
 		return texture;
 	}
+	if(stagedTextures.count(name)) return {};
 
 	OgreLog("Can't find texure " + name + ". Generating it from glTF");
 
-	const auto pixelFormat = [&] {
-		if(image.component == 3) return Ogre::PF_BYTE_RGB;
-		if(image.component == 4) return Ogre::PF_BYTE_RGBA;
+	//KTX2 normal maps are uploaded with their mip levels when they are, or can be transcoded to, BC5
+	const auto ktx2 = getKtx2Image(gltfTextureID);
+	if(ktx2 >= 0 && createKtx2Texture(name, ktx2, true, false, getMaxSize(gltfTextureID))) return findTexture(name);
 
-		OgreLog("unrecognized pixel format from tinygltf image");
-		throw InitError("Can get " + name + "pixel format");
-	}();
+	const auto decoded = getDecodedImage(gltfTextureID);
+	if(!decoded) return {};
+	const auto& image = *decoded;
+
+	//BC5 keeps the X and Y of the image as UNORM, the Hlms PBS remaps them and reconstructs Z
+	if(compressed && image.component >= 3)
+	{
+		createCompressedTexture(name, gltfTextureID, textureCompressor::Format::BC5, 0, 2, false, Use::Normal);
+		mipChains.erase({ gltfTextureID, false });
+		return findTexture(name);
+	}
 
 	const auto pixelFormatSnorm = [&] {
-		if(image.component == 3) return Ogre::PF_R8G8B8_SNORM;
-		if(image.component == 4) return Ogre::PF_R8G8B8A8_SNORM;
+		if(image.component == 3) return twoChannels ? Ogre::PF_R8G8_SNORM : Ogre::PF_R8G8B8_SNORM;
+		if(image.component == 4) return twoChannels ? Ogre::PF_R8G8_SNORM : Ogre::PF_R8G8B8A8_SNORM;
 		throw InitError("Can get " + name + "pixel format");
 	}();
 
-	Ogre::TexturePtr OgreTexture = textureManager->createManual(name,
-																Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-																Ogre::TextureType::TEX_TYPE_2D_ARRAY,
-																image.width,
-																image.height,
-																1,
-																1,
-																pixelFormatSnorm,
-																Ogre::TU_DEFAULT,
-																nullptr,
-																isHardwareGammaEnabled());
-
-	auto pixels = OgreTexture->getBuffer()->lock({ 0, 0, unsigned(image.width), unsigned(image.height) }, //PixelBox that take the whole image
-												 Ogre::v1::HardwareBuffer::LockOptions::HBL_NORMAL);
-	//This loop convert BGR to RGB image data while also putting the value in the SNORM range [-1.0; +1.0]
-	for(size_t y { 0 }; y < image.height; y++)
-		for(size_t x { 0 }; x < image.width; x++)
-			pixels.setColourAt(Ogre::ColourValue(2.0f * (float(image.image[image.component * (y * image.width + x) + 2]) / 255.0f) - 1.0f, //R to B
-												 2.0f * (float(image.image[image.component * (y * image.width + x) + 1]) / 255.0f) - 1.0f, //G to G
-												 2.0f * (float(image.image[image.component * (y * image.width + x) + 0]) / 255.0f) - 1.0f, //B to R
-												 1.0f),
-							   x,
-							   y,
-							   0);
-
-	OgreTexture->getBuffer()->unlock();
+	if(image.image.size() < size_t(image.width) * size_t(image.height) * size_t(image.component))
+		throw InitError("The image of " + name + " is smaller than its size");
 
-	return OgreTexture;
+	//The levels are filtered as UNORM values, then converted like the image
+	const auto pixelSize	   = size_t(image.component);
+	const auto destinationSize = twoChannels ? size_t(2) : pixelSize;
+	if(isStreamed(size_t(image.width), size_t(image.height)))
+	{
+		const auto chain = getStreamedMipChain(gltfTextureID, false);
+		createStreamedTexture(name,
+							  size_t(image.width),
+							  size_t(image.height),
+							  chain->getLevelCount(),
+							  pixelFormatSnorm,
+							  isHardwareGammaEnabled(),
+							  Use::Normal,
+							  [chain, pixelSize, destinationSize](size_t level, Ogre::uchar* output) {
+								  const auto width = chain->getWidth(level);
+								  for(size_t y { 0 }; y < chain->getHeight(level); y++)
+									  convertNormalRow(chain->getPixels(level) + y * width * pixelSize,
+													   width,
+													   pixelSize,
+													   output + y * width * destinationSize,
+													   destinationSize);
+							  },
+							  {});
+		mipChains.erase({ gltfTextureID, false });
+		return findTexture(name);
+	}
+
+	const auto& chain	   = getMipChain(gltfTextureID, false);
+	const auto OgreTexture = createTexture(
+		name, size_t(image.width), size_t(image.height), chain.getLevelCount(), pixelFormatSnorm, isHardwareGammaEnabled(), Use::Normal);
+
+	//Put the value in the SNORM range [-1.0; +1.0], whole rows at a time. The bytes keep the order of the channels of the image
+	for(size_t level { 0 }; level < chain.getLevelCount(); level++)
+	{
+		const auto width	   = chain.getWidth(level);
+		const auto pixels	   = lockLevel(OgreTexture, name, level);
+		const auto destination = static_cast<Ogre::uchar*>(pixels.data);
+		forEachRows(chain.getHeight(level), [&](size_t first, size_t last) {
+			for(auto y = first; y < last; y++)
+				convertNormalRow(
+					chain.getPixels(level) + y * width * pixelSize, width, pixelSize, destination + y * pixels.rowPitch * destinationSize, destinationSize);
+		});
+		unlockLevel(OgreTexture, level);
+	}
+	mipChains.erase({ gltfTextureID, false });
+
+	return findTexture(name);
 }
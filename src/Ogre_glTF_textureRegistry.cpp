@@ -0,0 +1,120 @@
+#include "Ogre_glTF_textureRegistry.hpp"
+#include "Ogre_glTF_common.hpp"
+#include <OgreLogManager.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreTextureManager.h>
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+using namespace Ogre_glTF;
+
+std::unordered_map<std::string, textureRegistry::entry>& textureRegistry::getEntries()
+{
+	static std::unordered_map<std::string, entry> entries;
+	return entries;
+}
+
+textureSlice textureRegistry::find(const std::string& name)
+{
+	auto& entries	 = getEntries();
+	const auto found = entries.find(name);
+	if(found == entries.end()) return {};
+
+	//The texture could have been removed from the texture manager by the application
+	auto texture = Ogre::TextureManager::getSingleton().getByName(found->second.textureName);
+	if(!texture)
+	{
+		entries.erase(found);
+		return {};
+	}
+
+	return { texture, found->second.slice };
+}
+
+textureSlice textureRegistry::acquire(const std::string& name)
+{
+	auto texture = find(name);
+	if(texture.texture)
+	{
+		++getEntries().at(name).references;
+		return texture;
+	}
+
+	texture.texture = Ogre::TextureManager::getSingleton().getByName(name);
+	if(texture.texture) add(name, texture);
+	return texture;
+}
+
+void textureRegistry::add(const std::string& name, const textureSlice& texture)
+{
+	getEntries()[name] = { texture.texture->getName(), texture.slice, 1 };
+}
+
+void textureRegistry::release(const std::string& name)
+{
+	//Adapters can outlive Ogre, the textures are already gone then
+	auto& entries	 = getEntries();
+	const auto found = entries.find(name);
+	if(!Ogre::TextureManager::getSingletonPtr() || found == entries.end() || found->second.references == 0 || --found->second.references > 0) return;
+
+	//The entry is erased with the texture, the name needs to be copied
+	const auto textureName = found->second.textureName;
+	removeIfUnused(textureName);
+}
+
+void textureRegistry::collect()
+{
+	if(!Ogre::TextureManager::getSingletonPtr()) return;
+
+	std::vector<std::string> textureNames;
+	for(const auto& entry : getEntries())
+		if(entry.second.references == 0) textureNames.push_back(entry.second.textureName);
+	std::sort(textureNames.begin(), textureNames.end());
+	textureNames.erase(std::unique(textureNames.begin(), textureNames.end()), textureNames.end());
+	for(const auto& textureName : textureNames) removeIfUnused(textureName);
+}
+
+size_t textureRegistry::getMemory()
+{
+	auto textureManager = Ogre::TextureManager::getSingletonPtr();
+	if(!textureManager) return 0;
+
+	//The slices of a texture array are all registered with the name of the array, it is only counted once
+	std::unordered_set<std::string> counted;
+	size_t memory { 0 };
+	for(const auto& entry : getEntries())
+	{
+		if(!counted.insert(entry.second.textureName).second) continue;
+		const auto texture = textureManager->getByName(entry.second.textureName);
+		if(!texture) continue;
+		for(size_t level { 0 }; level <= texture->getNumMipmaps(); level++)
+			memory += Ogre::PixelUtil::getMemorySize(std::max<Ogre::uint32>(1, texture->getWidth() >> level),
+													 std::max<Ogre::uint32>(1, texture->getHeight() >> level),
+													 texture->getDepth(),
+													 texture->getFormat());
+	}
+	return memory;
+}
+
+void textureRegistry::removeIfUnused(const std::string& textureName)
+{
+	//The other slices of a texture array can still be referenced
+	auto& entries = getEntries();
+	for(const auto& other : entries)
+		if(other.second.textureName == textureName && other.second.references > 0) return;
+
+	//When no datablock uses the texture, the resource system and this pointer are the only owners. The registry only keeps names
+	auto textureManager = Ogre::TextureManager::getSingletonPtr();
+	auto texture		= textureManager->getByName(textureName);
+	if(texture && texture.useCount() > Ogre::ResourceGroupManager::RESOURCE_SYSTEM_NUM_REFERENCE_COUNTS + 1) return;
+
+	for(auto other = entries.begin(); other != entries.end();)
+		other = other->second.textureName == textureName ? entries.erase(other) : std::next(other);
+	if(texture)
+	{
+		OgreLog("Removing the texture " + textureName + ", no adapter uses it anymore");
+		texture.setNull();
+		textureManager->remove(textureName);
+	}
+}
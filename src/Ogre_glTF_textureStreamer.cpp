@@ -0,0 +1,255 @@
+#include "Ogre_glTF_textureStreamer.hpp"
+#include "Ogre_glTF_streamedTexture.hpp"
+#include "Ogre_glTF_common.hpp"
+#include <OgreLogManager.h>
+#include <OgreTextureManager.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgreRoot.h>
+#include <OgreHlmsManager.h>
+#include <OgreHlms.h>
+#include <OgreHlmsPbsDatablock.h>
+#include <OgreItem.h>
+#include <OgreCamera.h>
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///State of the textureStreamer, shared with its thread
+	struct textureStreamerState
+	{
+		///Protect the lists of textures
+		std::mutex mutex;
+
+		///Used to wake up the thread when there's a texture to compute
+		std::condition_variable wakeUp;
+
+		///Used to notify finish that a texture was computed
+		std::condition_variable computed;
+
+		///Textures whose levels are not computed yet
+		std::vector<std::unique_ptr<streamedTexture>> waiting;
+
+		///Textures whose levels are computed, waiting to be uploaded
+		std::vector<std::unique_ptr<streamedTexture>> ready;
+
+		///Set while the thread computes a texture, which is in neither list
+		bool computing = false;
+
+		///Set when the streamer is destroyed
+		bool stopping = false;
+
+		///The thread that computes the levels
+		std::thread thread;
+	};
+}
+
+using namespace Ogre_glTF;
+
+namespace
+{
+	///Compute all the levels of a texture. If one of them can't be computed, the texture is left without levels
+	void computeLevels(streamedTexture& texture)
+	{
+		try
+		{
+			texture.levels.resize(texture.levelCount);
+			for(size_t level { 0 }; level < texture.levelCount; level++)
+			{
+				texture.levels[level].resize(Ogre::PixelUtil::getMemorySize(Ogre::uint32(std::max<size_t>(1, texture.width >> level)),
+																			Ogre::uint32(std::max<size_t>(1, texture.height >> level)),
+																			1,
+																			texture.format));
+				texture.computeLevel(level, texture.levels[level].data());
+			}
+		}
+		catch(const std::exception&)
+		{
+			texture.levels.clear();
+		}
+	}
+
+	///What the thread of the streamer does until it is destroyed : compute the levels of the waiting texture with the highest priority
+	void computeLoop(textureStreamerState& state)
+	{
+		std::unique_lock<std::mutex> lock(state.mutex);
+		for(;;)
+		{
+			state.wakeUp.wait(lock, [&] { return state.stopping || !state.waiting.empty(); });
+			if(state.stopping) return;
+
+			const auto highest = std::max_element(
+				state.waiting.begin(), state.waiting.end(), [](const std::unique_ptr<streamedTexture>& a, const std::unique_ptr<streamedTexture>& b) {
+					return a->priority < b->priority;
+				});
+			auto texture = std::move(*highest);
+			state.waiting.erase(highest);
+			state.computing = true;
+
+			lock.unlock();
+			computeLevels(*texture);
+			lock.lock();
+
+			state.ready.push_back(std::move(texture));
+			state.computing = false;
+			state.computed.notify_all();
+		}
+	}
+
+	///Replace a texture by a complete one, with all the computed levels of the streamed texture. The texture keeps its name and its Ogre
+	///object, so the datablocks that use it see the new levels
+	void upload(const streamedTexture& streamed)
+	{
+		if(streamed.levels.empty())
+		{
+			OgreLog("Could not compute the levels of the streamed texture " + streamed.name + ", it keeps its small levels");
+			return;
+		}
+
+		//The application could have removed the texture, or destroyed Ogre, in the meantime
+		const auto textureManager = Ogre::TextureManager::getSingletonPtr();
+		const auto texture		  = textureManager ? textureManager->getByName(streamed.name) : Ogre::TexturePtr {};
+		if(!texture)
+		{
+			OgreLog("The streamed texture " + streamed.name + " was removed before it was complete");
+			return;
+		}
+
+		texture->freeInternalResources();
+		texture->setWidth(Ogre::uint32(streamed.width));
+		texture->setHeight(Ogre::uint32(streamed.height));
+		texture->setNumMipmaps(Ogre::uint8(streamed.levelCount - 1));
+		texture->createInternalResources();
+		for(size_t level { 0 }; level < streamed.levelCount; level++)
+		{
+			const auto buffer = texture->getBuffer(0, level);
+			buffer->blitFromMemory(
+				Ogre::PixelBox(buffer->getWidth(), buffer->getHeight(), 1, streamed.format, const_cast<Ogre::uchar*>(streamed.levels[level].data())));
+		}
+
+		if(streamed.onComplete) streamed.onComplete(streamed.levels);
+	}
+
+	///Get the number of bytes of all the computed levels of a texture
+	size_t getUploadSize(const streamedTexture& texture)
+	{
+		size_t size { 0 };
+		for(const auto& level : texture.levels) size += level.size();
+		return size;
+	}
+}
+
+textureStreamer::textureStreamer() : state { std::make_unique<textureStreamerState>() } {}
+
+textureStreamer::~textureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->stopping = true;
+	}
+	state->wakeUp.notify_all();
+	if(state->thread.joinable()) state->thread.join();
+}
+
+textureStreamer& textureStreamer::getSingleton()
+{
+	static textureStreamer streamer;
+	return streamer;
+}
+
+void textureStreamer::add(std::unique_ptr<streamedTexture> texture)
+{
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->waiting.push_back(std::move(texture));
+		if(!state->thread.joinable()) state->thread = std::thread([this] { computeLoop(*state); });
+	}
+	state->wakeUp.notify_one();
+}
+
+size_t textureStreamer::update(size_t byteBudget)
+{
+	//Take the ready textures that fit in the budget, the ones with the highest priority first
+	std::vector<std::unique_ptr<streamedTexture>> uploads;
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		auto& ready = state->ready;
+		std::stable_sort(ready.begin(), ready.end(), [](const std::unique_ptr<streamedTexture>& a, const std::unique_ptr<streamedTexture>& b) {
+			return a->priority > b->priority;
+		});
+
+		size_t uploadSize { 0 };
+		auto texture = ready.begin();
+		for(; texture != ready.end(); ++texture)
+		{
+			const auto size = getUploadSize(**texture);
+			if(!uploads.empty() && uploadSize + size > byteBudget) break;
+			uploadSize += size;
+			uploads.push_back(std::move(*texture));
+		}
+		ready.erase(ready.begin(), texture);
+	}
+
+	for(const auto& texture : uploads) upload(*texture);
+	return getPendingCount();
+}
+
+void textureStreamer::prioritize(const Ogre::Camera* camera)
+{
+	//The priority of a texture is the biggest apparent size of the items that use it : their radius over their distance to the camera
+	std::unordered_map<std::string, float> priorities;
+	const auto pbs = Ogre::Root::getSingleton().getHlmsManager()->getHlms(Ogre::HLMS_PBS);
+	for(const auto& entry : pbs->getDatablockMap())
+	{
+		const auto datablock = dynamic_cast<Ogre::HlmsPbsDatablock*>(entry.second.datablock);
+		if(!datablock) continue;
+
+		auto priority = 0.0f;
+		for(const auto renderable : datablock->getLinkedRenderables())
+		{
+			const auto subItem = dynamic_cast<Ogre::SubItem*>(renderable);
+			const auto item	   = subItem ? subItem->getParent() : nullptr;
+			const auto node	   = item ? item->getParentNode() : nullptr;
+			if(!node) continue;
+
+			const auto distance = camera->getDerivedPosition().distance(node->_getDerivedPosition());
+			priority			= std::max(priority, float(item->getWorldRadius() / std::max(distance, std::numeric_limits<Ogre::Real>::epsilon())));
+		}
+
+		for(size_t type { 0 }; type < Ogre::NUM_PBSM_TEXTURE_TYPES; type++)
+		{
+			const auto texture = datablock->getTexture(Ogre::uint8(type));
+			if(!texture) continue;
+			auto& texturePriority = priorities[texture->getName()];
+			texturePriority		  = std::max(texturePriority, priority);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(state->mutex);
+	for(const auto list : { &state->waiting, &state->ready })
+		for(const auto& texture : *list)
+		{
+			const auto priority = priorities.find(texture->name);
+			texture->priority	= priority == priorities.end() ? 0.0f : priority->second;
+		}
+}
+
+void textureStreamer::finish()
+{
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->computed.wait(lock, [&] { return state->waiting.empty() && !state->computing; });
+	}
+	update(std::numeric_limits<size_t>::max());
+}
+
+size_t textureStreamer::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->waiting.size() + state->ready.size() + (state->computing ? 1 : 0);
+}
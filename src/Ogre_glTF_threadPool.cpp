@@ -0,0 +1,77 @@
+#include "Ogre_glTF_threadPool.hpp"
+#include <algorithm>
+
+using namespace Ogre_glTF;
+
+threadPool::threadPool(size_t threadCount)
+{
+	if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	//The calling thread takes part in the loops, so we need one less worker
+	for(size_t i = 1; i < threadCount; ++i) workers.emplace_back([this] { workerLoop(); });
+}
+
+threadPool::~threadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for(auto& worker : workers) worker.join();
+}
+
+size_t threadPool::size() const { return workers.size() + 1; }
+
+void threadPool::parallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+	//Not worth waking anybody up
+	if(workers.empty() || count < 2)
+	{
+		for(size_t i = 0; i < count; ++i) function(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job			= &function;
+		jobSize		= count;
+		busyWorkers = workers.size();
+		nextElement = 0;
+		++generation;
+	}
+	wakeUp.notify_all();
+
+	work();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this] { return busyWorkers == 0; });
+	job = nullptr;
+}
+
+void threadPool::work()
+{
+	for(auto i = nextElement++; i < jobSize; i = nextElement++) (*job)(i);
+}
+
+void threadPool::workerLoop()
+{
+	size_t lastGeneration { 0 };
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [&] { return stopping || generation != lastGeneration; });
+			if(stopping) return;
+			lastGeneration = generation;
+		}
+
+		work();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--busyWorkers;
+		}
+		finished.notify_one();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <tiny_gltf.h>
+#include <vector>
+#include "Ogre_glTF_bufferViewDecoder.hpp"
+
+namespace Ogre_glTF
+{
+	///Read the whole content of accessors at once, converting the components to floating point values
+	class accessorReader
+	{
+		///Reference to the model
+		tinygltf::Model& model;
+
+		///Reference to the bufferView decoder of the model
+		bufferViewDecoder& bufferViews;
+
+		///Convert count elements of an accessor to tightly packed floats
+		/// \param accessor accessor the elements come from, that give their type
+		/// \param data pointer to the first element
+		/// \param byteStride number of bytes between two elements
+		/// \param count number of elements to convert
+		/// \param output where to write count * getComponentCount(accessor.type) floats
+		void convert(const tinygltf::Accessor& accessor, const unsigned char* data, size_t byteStride, size_t count, float* output);
+
+	public:
+		///Construct the accessor reader
+		/// \param input model where the accessors are
+		/// \param decoder object that give access to the (possibly compressed) bufferViews of the model
+		accessorReader(tinygltf::Model& input, bufferViewDecoder& decoder);
+
+		///Get the number of components of an accessor element type. eg "3" for a VEC3, "16" for a MAT4
+		/// \param type glTF defined element type
+		static size_t getComponentCount(int type);
+
+		///Read all the elements of an accessor as tightly packed floats. Normalized integers are converted to the [0;1] or [-1;1] range
+		/// \param accessorIndex index of the accessor to read
+		/// \param output vector where the values are written. It will contain accessor.count * getComponentCount(accessor.type) floats
+		void readFloats(int accessorIndex, std::vector<float>& output);
+
+		///Read only the elements of an accessor that are not all zeros. A sparse accessor without bufferView is read without being expanded
+		/// \param accessorIndex index of the accessor to read
+		/// \param indices set to the index of the non zero elements, in increasing order
+		/// \param values set to the tightly packed floats of these elements
+		void readNonZeroFloats(int accessorIndex, std::vector<uint32_t>& indices, std::vector<float>& values);
+	};
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <tiny_gltf.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///Give access to the content of the bufferViews of a model. BufferViews compressed with EXT_meshopt_compression
+	///are decoded the first time something reads them, and the result is kept for the lifetime of the object.
+	class bufferViewDecoder
+	{
+		///Reference to the model
+		tinygltf::Model& model;
+
+		///Decoded content of the compressed bufferViews, indexed by bufferView
+		std::unordered_map<int, std::vector<unsigned char>> decodedBufferViews;
+
+		///Tightly packed content of the sparse accessors that had to be expanded, indexed by the address of the accessor
+		std::unordered_map<const tinygltf::Accessor*, std::vector<unsigned char>> resolvedSparseAccessors;
+
+		///Get a pointer to the bufferView data as stored in its buffer, without any decoding. Return nullptr if the buffer has no data
+		const unsigned char* getRawData(const tinygltf::BufferView& bufferView) const;
+
+		///Decode the compressed bufferView
+		/// \param bufferView the bufferView we are decoding. Its byteLength is the length of the decoded data
+		/// \param extension the EXT_meshopt_compression object of the bufferView
+		/// \param output where to write the decoded data
+		bool decode(const tinygltf::BufferView& bufferView, const tinygltf::Value& extension, std::vector<unsigned char>& output) const;
+
+	public:
+		///Construct the decoder
+		/// \param input model where the bufferViews are
+		bufferViewDecoder(tinygltf::Model& input);
+
+		///Return a pointer to the first byte of a bufferView
+		/// \param bufferViewIndex index of the bufferView in the glTF file
+		const unsigned char* getData(int bufferViewIndex);
+
+		///Return a pointer to the first byte of the data of an accessor. Sparse accessors are expanded into a tightly packed copy the first
+		///time they are read. Code that can deal with the sparse values itself should use getBaseData and applySparseValues instead
+		/// \param accessor the accessor we want to read
+		const unsigned char* getAccessorData(const tinygltf::Accessor& accessor);
+
+		///Get the number of bytes between two elements of the data returned by getAccessorData
+		/// \param accessor the accessor we want to read
+		size_t getAccessorByteStride(const tinygltf::Accessor& accessor) const;
+
+		///Get the size in bytes of one element of an accessor. eg "12" for a VEC3 of floats
+		/// \param accessor the accessor we want to read
+		static size_t getElementSize(const tinygltf::Accessor& accessor);
+
+		///Return a pointer to the data of an accessor without its sparse values applied, or nullptr if the accessor has no bufferView (all zeros).
+		///The elements are getBaseByteStride bytes apart
+		/// \param accessor the accessor we want to read
+		const unsigned char* getBaseData(const tinygltf::Accessor& accessor);
+
+		///Get the number of bytes between two elements of the data returned by getBaseData
+		/// \param accessor the accessor we want to read
+		size_t getBaseByteStride(const tinygltf::Accessor& accessor) const;
+
+		///Get the indices of the elements of a sparse accessor that are replaced by its sparse values, in increasing order
+		/// \param accessor a sparse accessor
+		std::vector<uint32_t> getSparseIndices(const tinygltf::Accessor& accessor);
+
+		///Return a pointer to the sparse values of an accessor. They are tightly packed, and in the same order as getSparseIndices
+		/// \param accessor a sparse accessor
+		const unsigned char* getSparseValues(const tinygltf::Accessor& accessor);
+
+		///Write the sparse values of an accessor over a copy of its base data. Does nothing if the accessor is not sparse
+		/// \param accessor the accessor we are reading
+		/// \param destination copy of the base data, accessor.count elements long
+		/// \param byteStride number of bytes between two elements in destination
+		void applySparseValues(const tinygltf::Accessor& accessor, unsigned char* destination, size_t byteStride);
+	};
+}
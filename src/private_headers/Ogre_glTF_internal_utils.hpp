@@ -1,7 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
 #include <OgrePrerequisites.h>
+#include "tiny_gltf.h"
 
 namespace Ogre_glTF
 {
@@ -17,5 +21,85 @@ namespace Ogre_glTF
 							   return static_cast<Ogre::Real>(n);
 						   });
 		}
+
+		///Get the extension object with the given name, or nullptr if it isn't present
+		inline const tinygltf::Value* findExtension(const tinygltf::ExtensionMap& extensions, const std::string& name)
+		{
+			const auto extension = extensions.find(name);
+			if(extension == extensions.end() || !extension->second.IsObject()) return nullptr;
+			return &extension->second;
+		}
+
+		///Get a number from a member of a JSON object, or the default value if the member is not here
+		inline double getNumber(const tinygltf::Value& object, const std::string& key, double defaultValue = 0)
+		{
+			if(!object.IsObject() || !object.Has(key)) return defaultValue;
+			const auto& value = object.Get(key);
+			if(value.IsInt()) return static_cast<double>(value.Get<int>());
+			if(value.IsNumber()) return value.Get<double>();
+			return defaultValue;
+		}
+
+		///Get a string from a member of a JSON object, or the default value if the member is not here
+		inline std::string getString(const tinygltf::Value& object, const std::string& key, const std::string& defaultValue = "")
+		{
+			if(!object.IsObject() || !object.Has(key)) return defaultValue;
+			const auto& value = object.Get(key);
+			if(value.IsString()) return value.Get<std::string>();
+			return defaultValue;
+		}
+
+		///Get a boolean from a member of a JSON object, or the default value if the member is not here
+		inline bool getBool(const tinygltf::Value& object, const std::string& key, bool defaultValue = false)
+		{
+			if(!object.IsObject() || !object.Has(key)) return defaultValue;
+			const auto& value = object.Get(key);
+			if(value.IsBool()) return value.Get<bool>();
+			return defaultValue;
+		}
+
+		///Compute a 64 bit hash of a block of memory. This is not cryptographic, it's only used to identify the content of files
+		/// \param data address of the memory to hash
+		/// \param size length of the memory to hash in bytes
+		/// \param seed value to start from, to combine the hash of several blocks
+		inline std::uint64_t hashBytes(const void* data, size_t size, std::uint64_t seed = 0)
+		{
+			const auto mix = [](std::uint64_t value) {
+				value ^= value >> 33;
+				value *= 0xFF51AFD7ED558CCDull;
+				value ^= value >> 33;
+				value *= 0xC4CEB9FE1A85EC53ull;
+				value ^= value >> 33;
+				return value;
+			};
+
+			//Consume the data 8 bytes at a time, the tail is padded with zeroes
+			const auto bytes   = static_cast<const unsigned char*>(data);
+			std::uint64_t hash = seed ^ mix(size);
+			for(size_t i = 0; i < size; i += 8)
+			{
+				std::uint64_t word { 0 };
+				memcpy(&word, bytes + i, std::min<size_t>(8, size - i));
+				hash = (hash ^ mix(word)) * 0x9E3779B97F4A7C15ull;
+				hash ^= hash >> 29;
+			}
+
+			return mix(hash);
+		}
+
+		///Format a hash as a string of 16 hexadecimal digits
+		inline std::string hashToString(std::uint64_t hash)
+		{
+			static const char digits[] = "0123456789abcdef";
+			std::string output(16, '0');
+			for(size_t i = 0; i < 16; ++i) output[15 - i] = digits[(hash >> (4 * i)) & 0xF];
+			return output;
+		}
+
+		///Return true if the glTF file declares that the extension needs to be supported to load it correctly
+		inline bool isExtensionRequired(const tinygltf::Model& model, const std::string& name)
+		{
+			return std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), name) != model.extensionsRequired.end();
+		}
 	}
-}
\ No newline at end of file
+}
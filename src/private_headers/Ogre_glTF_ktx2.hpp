@@ -0,0 +1,88 @@
+#pragma once
+
+#include <OgrePixelFormat.h>
+#include <cstddef>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///Reader of the KTX2 container used by the KHR_texture_basisu extension. Only the header, the level index and the data format
+	///descriptor are parsed : the levels are returned as they are stored in the file, and Basis Universal payloads are left to a transcoder.
+	///The object doesn't own the content of the file
+	class ktx2Image
+	{
+	public:
+		///How the levels of the image are stored
+		enum class Encoding {
+			Raw, ///< Blocks or pixels of a GPU format, without supercompression
+			ETC1S, ///< Basis Universal ETC1S, supercompressed with BasisLZ
+			UASTC, ///< Basis Universal UASTC, optionally supercompressed with Zstandard
+			Unsupported ///< Anything else : 3D, cubemap or array images, formats that Ogre can't sample, supercompressed raw data
+		};
+
+		///Check if some bytes start with the KTX2 identifier
+		/// \param data content of the file
+		/// \param size size of the file in bytes
+		static bool isKtx2(const unsigned char* data, size_t size);
+
+		///Parse a KTX2 file. Throws LoadingError if it is truncated or malformed
+		/// \param data content of the file. Needs to outlive the object
+		/// \param size size of the file in bytes
+		ktx2Image(const unsigned char* data, size_t size);
+
+		///Get the width of the biggest level, in pixels
+		size_t getWidth() const;
+
+		///Get the height of the biggest level, in pixels
+		size_t getHeight() const;
+
+		///Get the number of mip levels stored in the file
+		size_t getLevelCount() const;
+
+		///Get how the levels are stored
+		Encoding getEncoding() const;
+
+		///Get the Ogre pixel format of the levels of a Raw image
+		Ogre::PixelFormat getPixelFormat() const;
+
+		///Return true if the color channels are encoded with the sRGB transfer function
+		bool isSRGB() const;
+
+		///Return true if the image has an alpha channel
+		bool hasAlpha() const;
+
+		///Get the content of a level of a Raw image
+		/// \param level mip level, 0 is the biggest
+		const unsigned char* getLevelData(size_t level) const;
+
+		///Get the size in bytes of a level of a Raw image
+		/// \param level mip level, 0 is the biggest
+		size_t getLevelSize(size_t level) const;
+
+	private:
+		///Position of a level in the file
+		struct levelRange
+		{
+			size_t offset;
+			size_t size;
+		};
+
+		///Content of the file
+		const unsigned char* data;
+
+		///Dimensions of the biggest level
+		size_t width, height;
+
+		///Where each level is, starting from the biggest one
+		std::vector<levelRange> levels;
+
+		///How the levels are stored
+		Encoding encoding;
+
+		///Pixel format of Raw levels
+		Ogre::PixelFormat pixelFormat;
+
+		///Transfer function and alpha channel, from the data format descriptor
+		bool sRGB, alpha;
+	};
+}
@@ -2,6 +2,10 @@
 #include "tiny_gltf.h"
 #include <OgreHlms.h>
 #include <OgreHlmsPbs.h>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 namespace Ogre_glTF
 {
@@ -9,6 +13,10 @@ namespace Ogre_glTF
 	///Foward declare the textureImporter
 	class textureImporter;
 
+	///Forward declare the import options and the material report
+	struct importOptions;
+	struct materialReport;
+
 	///Load material information from a model inside Ogre, provide you a datablock to set to an Ogre::Item object
 	class materialLoader
 	{
@@ -16,6 +24,34 @@ namespace Ogre_glTF
 		textureImporter& textureImporterRef;
 		///The model
 		tinygltf::Model& model;
+		///Options of the adapter, used to know if materials need to be canonicalized
+		const importOptions& options;
+
+		///Datablock of each material of the model, filled the first time they are asked for
+		mutable std::vector<Ogre::HlmsDatablock*> datablocks;
+
+		///Names of the datablocks held in the residencyManager
+		mutable std::unordered_set<std::string> acquiredDatablocks;
+
+		///Get a hash of everything that end up in the datablock of a material. Textures are identified by their key : the content of their
+		///image and how this adapter processes it, so that identical materials of different files loaded the same way get the same hash
+		/// \param material the material to hash
+		std::uint64_t hashMaterial(const tinygltf::Material& material) const;
+
+		///Get a copy of a material that gives the same image with the fewest Hlms properties : factors are quantized, alpha settings
+		///that can't change anything are removed, and textures made of a single color are folded into the factors
+		/// \param material the material to canonicalize
+		/// \param quantize if not set, the factors are kept as they are : the material is only simplified from the content of its textures
+		tinygltf::Material canonicalize(const tinygltf::Material& material, bool quantize = true) const;
+
+		///Get a readable description of the set of Hlms properties the datablock of a material will have
+		/// \param material the material to describe
+		std::string getPermutation(const tinygltf::Material& material) const;
+
+		///Create the datablock of a material
+		/// \param material the material to create
+		/// \param name name of the datablock in the Hlms
+		Ogre::HlmsPbsDatablock* createDatablock(const tinygltf::Material& material, const std::string& name) const;
 
 		static Ogre::Vector3 convertColor(const tinygltf::ColorValue& color);
 
@@ -79,9 +115,18 @@ namespace Ogre_glTF
 		///Construct the material loader
 		/// \param input model to load material from
 		/// \param textureInterface the texture importer to get Ogre texture from
-		materialLoader(tinygltf::Model& input, textureImporter& textureInterface);
-		///Get the material (the HlmsDatablock)
+		/// \param importSettings options of the adapter
+		materialLoader(tinygltf::Model& input, textureImporter& textureInterface, const importOptions& importSettings);
+
+		///Release the datablocks held in the residencyManager
+		~materialLoader();
+
+		///Get the material (the HlmsDatablock). Materials with the same parameters and textures share the same datablock, even across files
+		/// \param index index of the material in the glTF file. Invalid indices (eg. primitives without material) get the default datablock
 		Ogre::HlmsDatablock* getDatablock(size_t index = 0) const;
 		size_t getDatablockCount() const;
+
+		///Count the distinct Hlms property sets and datablocks of the materials of the model, with and without canonicalization
+		materialReport getReport() const;
 	};
 }
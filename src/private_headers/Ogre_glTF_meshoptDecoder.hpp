@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Ogre_glTF
+{
+	///Decoders for the meshoptimizer bitstream used by the EXT_meshopt_compression glTF extension.
+	///These functions only work on raw memory and don't know anything about glTF or Ogre.
+	///All of them return false if the compressed data is malformed, or if its elements don't have a size they support.
+	namespace meshopt
+	{
+		///Decode a vertex buffer compressed in the "ATTRIBUTES" mode
+		/// \param destination where to write the decoded data. Must be at least count * byteStride bytes long
+		/// \param count number of elements to decode
+		/// \param byteStride size of an element in bytes. Needs to be a multiple of 4, and at most 256
+		/// \param source compressed data
+		/// \param sourceSize length of the compressed data in bytes
+		bool decodeVertexBuffer(unsigned char* destination, size_t count, size_t byteStride, const unsigned char* source, size_t sourceSize);
+
+		///Decode a triangle list index buffer compressed in the "TRIANGLES" mode
+		/// \param destination where to write the decoded data. Must be at least count * byteStride bytes long
+		/// \param count number of indices to decode. Needs to be a multiple of 3
+		/// \param byteStride size of an index in bytes, either 2 or 4
+		/// \param source compressed data
+		/// \param sourceSize length of the compressed data in bytes
+		bool decodeIndexBuffer(unsigned char* destination, size_t count, size_t byteStride, const unsigned char* source, size_t sourceSize);
+
+		///Decode an index sequence compressed in the "INDICES" mode
+		/// \param destination where to write the decoded data. Must be at least count * byteStride bytes long
+		/// \param count number of indices to decode
+		/// \param byteStride size of an index in bytes, either 2 or 4
+		/// \param source compressed data
+		/// \param sourceSize length of the compressed data in bytes
+		bool decodeIndexSequence(unsigned char* destination, size_t count, size_t byteStride, const unsigned char* source, size_t sourceSize);
+
+		///Apply the "OCTAHEDRAL" filter in place. Elements are 4 x int8 (byteStride 4) or 4 x int16 (byteStride 8)
+		bool decodeFilterOctahedral(unsigned char* data, size_t count, size_t byteStride);
+
+		///Apply the "QUATERNION" filter in place. Elements are 4 x int16 (byteStride 8)
+		bool decodeFilterQuaternion(unsigned char* data, size_t count, size_t byteStride);
+
+		///Apply the "EXPONENTIAL" filter in place. Elements are made of 32 bit values that are turned into floats (byteStride multiple of 4)
+		bool decodeFilterExponential(unsigned char* data, size_t count, size_t byteStride);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <OgrePrerequisites.h>
+#include <cstddef>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///Mip levels of an image, computed on the CPU with a 2x2 box filter. Each level is half the size of the previous one, rounded down,
+	///down to 1x1. Levels of sRGB images are filtered in linear space, alpha is always linear.
+	///The levels are computed row by row, so that the rows of a level can be spread on threads, and the levels of several images interleaved
+	class mipChain
+	{
+	public:
+		///Start the chain of an image. Only the first level is set, the others need to be computed with downsampleRows, in order
+		/// \param pixels pixels of the image, which is the first level of the chain. They need to outlive the chain
+		/// \param width width of the image in pixels
+		/// \param height height of the image in pixels
+		/// \param pixelSize number of bytes per pixel, each byte is a channel
+		/// \param gamma if set, the color channels are sRGB
+		/// \param mipmaps if not set, the chain only has the first level
+		mipChain(const Ogre::uchar* pixels, size_t width, size_t height, size_t pixelSize, bool gamma, bool mipmaps);
+
+		///Get the number of levels of the chain of an image, the first level included
+		/// \param width width of the image in pixels
+		/// \param height height of the image in pixels
+		/// \param mipmaps if not set, the chain only has the first level
+		static size_t countLevels(size_t width, size_t height, bool mipmaps);
+
+		///Get the number of levels, the first level included
+		size_t getLevelCount() const;
+
+		///Get the width of a level in pixels
+		/// \param level index of the level, 0 is the image
+		size_t getWidth(size_t level) const;
+
+		///Get the height of a level in pixels
+		/// \param level index of the level, 0 is the image
+		size_t getHeight(size_t level) const;
+
+		///Get the number of bytes per pixel
+		size_t getPixelSize() const;
+
+		///Get the pixels of a level
+		/// \param level index of the level, 0 is the image
+		const Ogre::uchar* getPixels(size_t level) const;
+
+		///Compute some rows of a level from the previous level, which needs to be complete
+		/// \param level index of the level to compute, at least 1
+		/// \param firstRow first row to compute
+		/// \param lastRow row after the last one to compute
+		void downsampleRows(size_t level, size_t firstRow, size_t lastRow);
+
+		///Copy the image in the chain, so that the chain doesn't need the pixels it was started from anymore
+		void keepImage();
+
+	private:
+		///The image
+		const Ogre::uchar* image;
+
+		///Dimensions of the image
+		size_t width, height;
+
+		///Number of bytes per pixel
+		size_t pixelSize;
+
+		///Set if the color channels are sRGB
+		bool gamma;
+
+		///Pixels of the levels after the first one
+		std::vector<std::vector<Ogre::uchar>> levels;
+
+		///Copy of the image made by keepImage
+		std::vector<Ogre::uchar> ownImage;
+	};
+}
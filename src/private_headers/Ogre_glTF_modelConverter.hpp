@@ -3,6 +3,9 @@
 #include "OgreMesh2.h"
 #include <tiny_gltf.h>
 #include "Ogre_glTF.hpp"
+#include "Ogre_glTF_bufferViewDecoder.hpp"
+#include <map>
+#include <unordered_set>
 
 namespace Ogre_glTF
 {
@@ -146,31 +149,115 @@ namespace Ogre_glTF
 	/// \param offset where the indexes starts in the buffer
 	/// \param stride number of bytes between elements
 	template <typename bufferType, typename sourceType>
-	void loadIndexBuffer(bufferType* dest, sourceType* source, size_t indexCount, size_t offset, size_t stride)
+	void loadIndexBuffer(bufferType* dest, const sourceType* source, size_t indexCount, size_t offset, size_t stride)
 	{
-		for(size_t i = 0; i < indexCount; ++i) { dest[i] = *(reinterpret_cast<sourceType*>(reinterpret_cast<unsigned char*>(source) + (offset + i * stride))); }
+		for(size_t i = 0; i < indexCount; ++i) { dest[i] = *(reinterpret_cast<const sourceType*>(reinterpret_cast<const unsigned char*>(source) + (offset + i * stride))); }
 	}
 
+	///A primitive of the glTF file, with the transform to apply to its vertices when it gets baked into another mesh
+	struct bakedPrimitive
+	{
+		///Index of the mesh in the glTF file
+		size_t mesh;
+
+		///Index of the primitive in the mesh
+		size_t primitive;
+
+		///Transform applied to the vertices of the primitive
+		Ogre::Matrix4 transform;
+	};
+
 	///Converter object : take a tinygltf model and encapsulate all the code necessary to extract mesh information
 	class modelConverter
 	{
 	public:
 		///Construct a modelConverter from a model
 		/// \param input model we are converting into an Ogre model
-		modelConverter(tinygltf::Model& input);
+		/// \param decoder object that give access to the (possibly compressed) bufferViews of the model
+		modelConverter(tinygltf::Model& input, bufferViewDecoder& decoder);
+
+		///Release the meshes held in the residencyManager
+		~modelConverter();
+
+		///Set the string that identify the content of the glTF file. It's used to give unique names to the created meshes,
+		///so that the same mesh is only converted once, and meshes from different files are never mixed up
+		/// \param identifier unique identifier of the file content
+		void setSourceIdentifier(const std::string& identifier);
+
+		///Get the name of the Ogre mesh created for a mesh of the glTF file
+		/// \param meshIdx index of the mesh in the glTF file
+		std::string getMeshName(size_t meshIdx) const;
+
+		///Find a mesh in the Ogre::MeshManager, made by this adapter or another one, and hold it in the residencyManager
+		/// \param meshName name of the mesh in the Ogre::MeshManager
+		/// \return the mesh, or a null pointer if there isn't one with this name
+		Ogre::MeshPtr findMesh(const std::string& meshName);
 
 		///Returns the mesh with the given name in the glTF file.
 		Ogre::MeshPtr getOgreMesh(const Ogre::String& name);
 		Ogre::MeshPtr getOgreMesh(size_t meshIdx);
+
+		///Create a mesh that can be morphed : the positions and normals of each submesh are put in their own vertex buffer, that can be updated.
+		///Each morphed item needs its own mesh, so this isn't cached
+		/// \param meshIdx index of the mesh in the glTF file
+		/// \param name name of the mesh created in the Ogre::MeshManager
+		/// \param morphedBuffers where to put the vertex buffer with the morphed attributes of each submesh
+		Ogre::MeshPtr createMorphableMesh(size_t meshIdx, const std::string& name, std::vector<Ogre::VertexBufferPacked*>& morphedBuffers);
 		
 		///Print out debug information on the model structure
 		// nodes contain transformation and scale information
 		void debugDump() const;
 
+		///Get the exact bounds of each submesh of a mesh
+		/// \param meshIdx index of the mesh in the glTF file
+		const std::vector<subMeshBounds>& getSubMeshBounds(size_t meshIdx);
+
 		///Return true if the model defines skins. Skins are "vertex to bone" asignment for skeletal animation
 		bool hasSkins() const;
 
+		///Return true if the mesh can be baked into another mesh : it needs to be made of triangle lists that are not skinned
+		/// \param meshIdx index of the mesh in the glTF file
+		bool isBakeable(size_t meshIdx) const;
+
+		///Get the number of vertices of all the primitives of a mesh
+		/// \param meshIdx index of the mesh in the glTF file
+		size_t getVertexCount(size_t meshIdx) const;
+
+		///Create a mesh where each submesh is the concatenation of a list of transformed primitives.
+		///All the primitives of a submesh need to have the same attributes, and to be bakeable
+		/// \param name name of the mesh created in the Ogre::MeshManager
+		/// \param subMeshes for each submesh to create, the list of primitives to put into it
+		Ogre::MeshPtr createBakedMesh(const std::string& name, const std::vector<std::vector<bakedPrimitive>>& subMeshes);
+
 	private:
+		///Create a mesh from a mesh of the glTF file
+		/// \param meshIdx index of the mesh in the glTF file
+		/// \param meshName name of the mesh created in the Ogre::MeshManager
+		/// \param morphedBuffers if not null, create a morphable mesh, and put in there the buffers with the morphed attributes
+		Ogre::MeshPtr createMesh(size_t meshIdx, const std::string& meshName, std::vector<Ogre::VertexBufferPacked*>* morphedBuffers);
+
+		///Hold a mesh in the residencyManager until the converter is destroyed
+		/// \param meshName name of the mesh in the Ogre::MeshManager
+		void acquireMesh(const std::string& meshName);
+
+		///Vertex and index data of a primitive, loaded in system memory
+		struct primitiveGeometry
+		{
+			///The vertex attributes of the primitive
+			std::vector<vertexBufferPart> parts;
+
+			///The indices of the primitive, as 32 bit integers. Generated if the primitive isn't indexed
+			std::vector<Ogre::uint32> indices;
+		};
+
+		///Load the content of a primitive in system memory
+		/// \param primitive the primitive we are loading
+		primitiveGeometry extractPrimitiveGeometry(const tinygltf::Primitive& primitive) const;
+
+		///Read the content of an index buffer as 32 bit integers
+		/// \param accessor index of the accessor to the index buffer
+		std::vector<Ogre::uint32> extractIndices(int accessor) const;
+
 		///Get a pointer to the Ogre::VaoManager
 		static Ogre::VaoManager* getVaoManager();
 
@@ -188,13 +275,31 @@ namespace Ogre_glTF
 
 		///Extract the buffer content from the attribute of a primitive of a mesh
 		/// \param attribute the attribute of the mesh primitive we are loading
-		vertexBufferPart extractVertexBuffer(const std::pair<std::string, int>& attribute, Ogre::Aabb& boundingBox) const;
+		/// \param bounds set to the exact bounds of the vertices when the attribute is the position
+		vertexBufferPart extractVertexBuffer(const std::pair<std::string, int>& attribute, subMeshBounds& bounds) const;
+
+		///Get bounds that contain all the given bounds
+		/// \param bounds the bounds of each submesh
+		static subMeshBounds mergeBounds(const std::vector<subMeshBounds>& bounds);
 
 		///Construct an actual vertex buffer from a list of vertex buffer parts
 		/// \param parts list of vertexBufferPart to load into the vertex buffer
-		Ogre::VertexBufferPackedVec constructVertexBuffer(const std::vector<vertexBufferPart>& parts) const;
+		/// \param bufferType type of the buffer to create. It's immutable unless we need to update it later
+		Ogre::VertexBufferPackedVec constructVertexBuffer(const std::vector<vertexBufferPart>& parts, Ogre::BufferType bufferType = Ogre::BT_IMMUTABLE) const;
 
 		///Reference to a loaded model
 		tinygltf::Model& model;
+
+		///Reference to the bufferView decoder of the model
+		bufferViewDecoder& bufferViews;
+
+		///Identifier of the content of the glTF file
+		std::string sourceIdentifier;
+
+		///Bounds of the submeshes of each mesh that was converted
+		std::map<size_t, std::vector<subMeshBounds>> subMeshesBounds;
+
+		///Names of the meshes held in the residencyManager
+		std::unordered_set<std::string> acquiredMeshes;
 	};
 }
\ No newline at end of file
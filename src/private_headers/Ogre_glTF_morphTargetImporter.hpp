@@ -0,0 +1,123 @@
+#pragma once
+
+#include <tiny_gltf.h>
+#include <OgrePrerequisites.h>
+#include <OgreVector3.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Ogre_glTF_accessorReader.hpp"
+
+namespace Ogre_glTF
+{
+	///One morph target of a primitive, stored as a sparse delta stream : only the vertices moved by the target are stored
+	struct morphTargetData
+	{
+		///Index of the vertices moved by the target
+		std::vector<Ogre::uint32> vertices;
+
+		///Position deltas of the moved vertices. 4 floats per vertex, the last one is a zero used as padding for SIMD
+		std::vector<float> positionDeltas;
+
+		///Normal deltas of the moved vertices, with the same layout. Empty if the target doesn't move the normals
+		std::vector<float> normalDeltas;
+	};
+
+	///Morph targets of one primitive
+	struct morphPrimitiveData
+	{
+		///Number of vertices of the primitive
+		size_t vertexCount = 0;
+
+		///Number of floats per vertex in the blended vertex data : 3 for the position, 3 more if there are normals
+		size_t floatsPerVertex = 3;
+
+		///Vertex data without any target applied : the position, then the normal if there is one
+		std::vector<float> baseVertices;
+
+		///The morph targets
+		std::vector<morphTargetData> targets;
+	};
+
+	///Morph targets of all the primitives of a mesh, shared by all the items created from this mesh
+	struct morphMeshData
+	{
+		///Index of the mesh in the glTF file
+		size_t meshIndex = 0;
+
+		///Targets of each primitive of the mesh
+		std::vector<morphPrimitiveData> primitives;
+
+		///Name of each target, if the file gives them
+		std::vector<std::string> targetNames;
+
+		///Weights given in the mesh definition
+		std::vector<float> defaultWeights;
+
+		///How far from its base position a vertex can move when all the weights are between 0 and 1
+		Ogre::Vector3 maxDisplacement = Ogre::Vector3::ZERO;
+	};
+
+	///Animation of the weights of the morph targets of a node
+	struct morphWeightAnimation
+	{
+		///The interpolation methods defined by glTF
+		enum class interpolationType { step, linear, cubicSpline };
+
+		///Name of the animation
+		std::string name;
+
+		///How to interpolate between keyframes
+		interpolationType interpolation = interpolationType::linear;
+
+		///Time of each keyframe, in seconds
+		std::vector<float> times;
+
+		///The weight of each target at each keyframe. With cubic spline interpolation, each keyframe has 3 sets of weights : in-tangents, values and out-tangents
+		std::vector<float> weights;
+	};
+
+	///All the weight animations of a node
+	struct morphAnimationList
+	{
+		///The animations
+		std::vector<morphWeightAnimation> animations;
+	};
+
+	///Load morph targets ("targets" of mesh primitives) and the animations of their weights
+	class morphTargetImporter
+	{
+		///Reference to the model
+		tinygltf::Model& model;
+
+		///Used to read the target attributes
+		accessorReader& accessors;
+
+		///Morph data of the meshes that were already loaded
+		std::map<size_t, std::shared_ptr<const morphMeshData>> loadedMeshes;
+
+		///Load the morph targets of a primitive
+		/// \param primitive primitive of the mesh we are loading
+		/// \param displacements biggest displacement of a vertex by each target, updated with the ones of this primitive
+		morphPrimitiveData loadPrimitive(const tinygltf::Primitive& primitive, std::vector<Ogre::Vector3>& displacements);
+
+	public:
+		///Construct the morph target importer
+		/// \param input model where the morph targets are loaded from
+		/// \param reader object used to read the accessors of the model
+		morphTargetImporter(tinygltf::Model& input, accessorReader& reader);
+
+		///Return true if all the primitives of the mesh have morph targets that we can blend. They need floating point positions and normals
+		/// \param meshIdx index of the mesh in the glTF file
+		bool isMorphable(size_t meshIdx) const;
+
+		///Get the morph targets of a mesh. They are only loaded once
+		/// \param meshIdx index of the mesh in the glTF file
+		std::shared_ptr<const morphMeshData> getMorphData(size_t meshIdx);
+
+		///Get all the animations that change the morph target weights of a node
+		/// \param nodeIdx index of the node in the glTF file
+		std::shared_ptr<const morphAnimationList> getWeightAnimations(size_t nodeIdx);
+	};
+}
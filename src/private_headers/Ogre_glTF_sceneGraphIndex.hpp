@@ -0,0 +1,67 @@
+#pragma once
+
+#include <tiny_gltf.h>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///Relations between the nodes of a model that the glTF file only give one way (children, skin joints).
+	///The index is built the first time it is queried, in time linear in the number of nodes and joints, and never change after that.
+	class sceneGraphIndex
+	{
+		///Reference to the model
+		tinygltf::Model& model;
+
+		///Set to true once the index is built
+		bool built = false;
+
+		///One bit per node, set if the node is a joint of any skin
+		std::vector<bool> joints;
+
+		///Parent of each node, -1 for the nodes that are not a child of any other node
+		std::vector<int> parents;
+
+		///Joints of each skin that don't have a parent in the same skin
+		std::vector<std::vector<int>> skinRoots;
+
+		///All the nodes, each one followed by all the nodes of its subtree (depth first pre-order). Parents are always before their children
+		std::vector<int> order;
+
+		///Position of each node in the order array
+		std::vector<size_t> orderPositions;
+
+		///Number of nodes in the subtree of each node, the node itself included
+		std::vector<size_t> subtreeSizes;
+
+		///Build all the tables at once
+		void build();
+
+	public:
+		///Construct the index. Nothing is computed before the first query, the model doesn't need to be loaded yet
+		/// \param input model where the nodes are
+		sceneGraphIndex(tinygltf::Model& input);
+
+		///Return true if the node is a joint of any skin
+		/// \param node index of the node
+		bool isJoint(size_t node);
+
+		///Get the index of the parent of a node, or -1 if it is a root node
+		/// \param node index of the node
+		int getParent(size_t node);
+
+		///Get the joints of a skin that are the root of a bone hierarchy
+		/// \param skin index of the skin
+		const std::vector<int>& getSkinRoots(size_t skin);
+
+		///Get all the nodes in depth first order : every node is followed by its whole subtree, parents always come before their children
+		const std::vector<int>& getTopologicalOrder();
+
+		///Get the position of a node in the topological order. Its subtree is the getSubtreeSize(node) nodes starting there
+		/// \param node index of the node
+		size_t getOrderPosition(size_t node);
+
+		///Get the number of nodes in the subtree of a node, the node itself included
+		/// \param node index of the node
+		size_t getSubtreeSize(size_t node);
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+//Detect what SIMD instruction set we can use for the few hand vectorized kernels of the library.
+//Every kernel that use theses must also provide a scalar path, used when none of them is available.
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+///SSE2 is available (always true on x86_64)
+#define Ogre_glTF_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define Ogre_glTF_SIMD_SSE2 0
+#endif
+
+#if Ogre_glTF_SIMD_SSE2
+namespace Ogre_glTF
+{
+	namespace simd
+	{
+		///Load 3 floats without touching the memory after them. The last component of the vector is zero
+		inline __m128 load3(const void* address)
+		{
+			const auto floats = static_cast<const float*>(address);
+			return _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64(static_cast<const __m128i*>(address))), _mm_load_ss(floats + 2));
+		}
+
+		///Store the 3 first floats of a vector without touching the memory after them
+		inline void store3(void* address, __m128 value)
+		{
+			_mm_storel_epi64(static_cast<__m128i*>(address), _mm_castps_si128(value));
+			_mm_store_ss(static_cast<float*>(address) + 2, _mm_movehl_ps(value, value));
+		}
+	}
+}
+#endif
@@ -3,6 +3,12 @@
 #include <tiny_gltf.h>
 #include <OgrePrerequisites.h>
 #include <OgreOldBone.h>
+#include "Ogre_glTF_bufferViewDecoder.hpp"
+#include "Ogre_glTF_accessorReader.hpp"
+#include "Ogre_glTF_sceneGraphIndex.hpp"
+#include "Ogre_glTF_threadPool.hpp"
+#include "Ogre_glTF.hpp"
+#include <memory>
 
 namespace Ogre_glTF
 {
@@ -12,6 +18,21 @@ namespace Ogre_glTF
 		///Reference to the model
 		tinygltf::Model& model;
 
+		///Reference to the bufferView decoder of the model
+		bufferViewDecoder& bufferViews;
+
+		///Reference to the accessor reader of the model
+		accessorReader& accessors;
+
+		///Reference to the scene graph index of the model
+		sceneGraphIndex& sceneGraph;
+
+		///Options of the adapter
+		const importOptions& options;
+
+		///Threads used to build the keyframes, created the first time they are needed
+		std::unique_ptr<threadPool> threads;
+
 		using tinygltfJointNodeIndex = int;
 
 		///number to increment when creating strings for skeleton with no names in glTF files
@@ -20,7 +41,7 @@ namespace Ogre_glTF
 		///Pointer to the skeleton object we are currently working on.
 		Ogre::v1::SkeletonPtr skeleton;
 
-		///Recurisve fucntion : Create a bone for each children, and each children's children...
+		///Create a bone for each children, and each children's children...
 		/// \param skinName name of the skin
 		/// \param childs array contaning the indices of the childrens
 		/// \param parent a pointer to a bone that is part of the skeleton we are creating
@@ -46,8 +67,27 @@ namespace Ogre_glTF
 		///Vector of keyframes
 		using keyFrameList = std::vector<keyFrame>;
 
-		///Type for a list of animation channels
-		using channelList = std::vector<std::reference_wrapper<tinygltf::AnimationChannel>>;
+		///Times and values of an animation sampler, each decoded at once in its own array
+		struct samplerData
+		{
+			///Time of each keyframe, in seconds
+			std::vector<float> times;
+
+			///Value of each keyframe, tightly packed : x, y, z for translations and scales, x, y, z, w for rotations. The tangents of
+			///cubic spline samplers are left out
+			std::vector<float> values;
+
+			///Set if the sampler keeps each value until its next keyframe, instead of interpolating them
+			bool step = false;
+		};
+
+		///The samplers that animate the translation, the rotation and the scale of a bone. A null pointer for a property that isn't animated
+		struct boneSamplers
+		{
+			const samplerData* translation = nullptr;
+			const samplerData* rotation	   = nullptr;
+			const samplerData* scale	   = nullptr;
+		};
 
 		///Type for holding the mapping beween Bone index and glTF nodes
 		using nodeIndexConversionMap = std::unordered_map<tinygltfJointNodeIndex, tinygltfJointNodeIndex>;
@@ -58,23 +98,17 @@ namespace Ogre_glTF
 		///Hold the list of the bind matrices. These are the inverse of the inverse bind matrices of the skin. Represent transforms that put each bone's into it's binding pose
 		std::vector<Ogre::Matrix4> bindMatrices;
 
-		///Load from an animation channel sampler the time data, and ore it inside the keyframe
-		void loadTimepointFromSamplerToKeyFrame(int bone, int frameID, int& count, keyFrame& animationFrame, tinygltf::AnimationSampler& sampler);
-
-		///Load vector of 3 doubles or 3 floats from the animation sampler, and store them into a vector
-		void loadVector3FromSampler(int frameID, int& count, tinygltf::AnimationSampler& sampler, Ogre::Vector3& vector);
-
-		///Load vector of 4 doubles or 4 floats from the animation sampler, and store them into a quaternion
-		void loadQuatFromSampler(int frameID, int& count, tinygltf::AnimationSampler& sampler, Ogre::Quaternion& quat) const;
-
-		///Goes throught the list of animation channel, and assign the 4 given pointers to the one that correspond to it
-		void detectAnimationChannel(const channelList& channels, tinygltf::AnimationChannel*& translation, tinygltf::AnimationChannel*& rotation, tinygltf::AnimationChannel*& scale, tinygltf::AnimationChannel*& weights) const;
-
-		///Load keyframe data from the samplers of each AnimationChannel into a KeyFrame object
-		void loadKeyFrameDataFromSampler(const tinygltf::Animation& animation, int bone, tinygltf::AnimationChannel* translation, tinygltf::AnimationChannel* rotation, tinygltf::AnimationChannel* scale, tinygltf::AnimationChannel* weights, int frameID, int& count, keyFrame& animationFrame);
+		///Decode the times and the values of an animation sampler, each accessor at once
+		/// \param sampler the sampler
+		/// \param componentCount number of floats of a value : 3 for translations and scales, 4 for rotations
+		/// \param output where to write the times and the values. Both are left empty if the sampler can't be read
+		void decodeSampler(const tinygltf::AnimationSampler& sampler, size_t componentCount, samplerData& output);
 
-		///Load all keyframes for the animation
-		void loadKeyFrames(const tinygltf::Animation& animation, int bone, keyFrameList& keyFrames, tinygltf::AnimationChannel* translation, tinygltf::AnimationChannel* rotation, tinygltf::AnimationChannel* scale, tinygltf::AnimationChannel* weights);
+		///Build all the keyframes of a bone from its decoded samplers. Each sampler has its own times, the keyframes are at all of them :
+		///the samplers that don't have a keyframe at a time are interpolated there. Safe to call concurrently
+		/// \param samplers the samplers of the bone
+		/// \param keyFrames where to write the keyframes
+		void loadKeyFrames(const boneSamplers& samplers, keyFrameList& keyFrames) const;
 
 		///All all animation for the skeleton
 		void loadSkeletonAnimations(tinygltf::Skin skin, const std::string& skeletonName);
@@ -82,7 +116,12 @@ namespace Ogre_glTF
 	public:
 		///Construct the skeleton importer
 		/// \param input model where the skeleton data is loaded from
-		skeletonImporter(tinygltf::Model& input);
+		/// \param decoder object that give access to the (possibly compressed) bufferViews of the model
+		/// \param reader object that read whole accessors of the model
+		/// \param index relations between the nodes of the model
+		/// \param importSettings options of the adapter
+		skeletonImporter(
+			tinygltf::Model& input, bufferViewDecoder& decoder, accessorReader& reader, sceneGraphIndex& index, const importOptions& importSettings);
 
 		///Return the constructed skeleton pointer
 		Ogre::v1::SkeletonPtr getSkeleton(size_t index);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Ogre_glTF.hpp"
+
+namespace Ogre_glTF
+{
+	///Image decoder used when importOptions::decoder is not set, or can't decode an image : stb_image, the decoder tinygltf ships with.
+	///stb converts the channels while decoding, 16 bit images are reduced to 8 bit
+	class stbImageDecoder final : public imageDecoder
+	{
+	public:
+		bool decode(const unsigned char* file,
+					size_t size,
+					Layout layout,
+					std::vector<unsigned char>& output,
+					size_t& width,
+					size_t& height,
+					size_t& channels) const override;
+	};
+}
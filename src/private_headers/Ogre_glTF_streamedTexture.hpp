@@ -0,0 +1,38 @@
+#pragma once
+
+#include <OgrePixelFormat.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///A texture created with its small levels only, that the textureStreamer completes. Its levels are computed from data owned by the
+	///functions, the importer that made it can be destroyed before it is complete
+	struct streamedTexture
+	{
+		///Name of the texture in the texture manager
+		std::string name;
+
+		///Size of the first level of the complete texture in pixels
+		size_t width, height;
+
+		///Number of levels of the complete texture, the first one included
+		size_t levelCount;
+
+		///Pixel format of the texture
+		Ogre::PixelFormat format;
+
+		///Compute the pixels or the blocks of a level, without padding. Called from the thread of the streamer
+		std::function<void(size_t level, Ogre::uchar* output)> computeLevel;
+
+		///Called from the thread that renders once the complete texture is uploaded, with all its levels. Can be empty
+		std::function<void(const std::vector<std::vector<Ogre::uchar>>& levels)> onComplete;
+
+		///Textures with the highest priority are computed and uploaded first
+		float priority = 0;
+
+		///The computed levels, empty until they are all computed, or if they couldn't be
+		std::vector<std::vector<Ogre::uchar>> levels;
+	};
+}
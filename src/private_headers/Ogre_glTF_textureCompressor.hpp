@@ -0,0 +1,63 @@
+#pragma once
+
+#include <OgrePixelFormat.h>
+#include <cstddef>
+
+namespace Ogre_glTF
+{
+	///CPU encoder of the BCn block compression formats. Images are encoded one row of 4x4 blocks at a time, so that the rows can be spread on threads.
+	///Blocks on the right and bottom edges of images that are not a multiple of 4 repeat the last column and row of pixels
+	class textureCompressor
+	{
+	public:
+		///Block formats the encoder produces
+		enum class Format {
+			BC1, ///< RGB, 4 bits per pixel
+			BC3, ///< RGBA, 8 bits per pixel
+			BC4, ///< One channel, 4 bits per pixel
+			BC5, ///< Two channels, 8 bits per pixel
+			BC7 ///< RGBA, 8 bits per pixel. Only mode 6 (one subset, RGBA endpoints) is used
+		};
+
+		///Construct an encoder
+		/// \param highQuality if set, endpoints are fitted to the principal axis of each block and refined by least squares. Otherwise they
+		///are taken from the bounding box of the block, which is several times faster
+		explicit textureCompressor(bool highQuality);
+
+		///Get the Ogre pixel format of a block format
+		/// \param format the block format
+		static Ogre::PixelFormat getPixelFormat(Format format);
+
+		///Get the size in bytes of one 4x4 block
+		/// \param format the block format
+		static size_t getBlockSize(Format format);
+
+		///Get the size in bytes of a whole image once encoded
+		/// \param format the block format
+		/// \param width width of the image in pixels
+		/// \param height height of the image in pixels
+		static size_t getEncodedSize(Format format, size_t width, size_t height);
+
+		///Encode one row of 4x4 blocks of an image
+		/// \param format the block format to encode to
+		/// \param pixels first channel to read of the first pixel of the image
+		/// \param width width of the image in pixels
+		/// \param height height of the image in pixels
+		/// \param pixelSize number of bytes from a pixel to the next one
+		/// \param channels number of channels to read in each pixel. BC1, BC3 and BC7 read 3 (opaque) or 4, BC4 reads 1 and BC5 reads 2
+		/// \param blockRow index of the row of blocks to encode
+		/// \param output where to write the (width + 3) / 4 blocks of the row
+		void encodeBlockRow(Format format,
+							const Ogre::uchar* pixels,
+							size_t width,
+							size_t height,
+							size_t pixelSize,
+							size_t channels,
+							size_t blockRow,
+							Ogre::uchar* output) const;
+
+	private:
+		///Set if the slower, better encoding is used
+		bool highQuality;
+	};
+}
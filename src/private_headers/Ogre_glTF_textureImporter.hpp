@@ -1,17 +1,80 @@
 #pragma once
 
 #include "tiny_gltf.h"
+#include "Ogre_glTF_textureCompressor.hpp"
+#include "Ogre_glTF_mipChain.hpp"
+#include "Ogre_glTF_textureRegistry.hpp"
+#include "Ogre_glTF.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <OgreTexture.h>
 
 namespace Ogre_glTF
 {
+	///Forward declare the thread pool and the KTX2 reader
+	class threadPool;
+	class ktx2Image;
 
-	///Import textures described in glTF into Ogre
+	///Import textures described in glTF into Ogre. Textures are identified by their index in the textures of the glTF file. Their image is
+	///the KTX2 image of their KHR_texture_basisu extension when it can be used, or their source image. Images are kept encoded by the
+	///loader, and only decoded when a texture that isn't in the textureRegistry yet is made from them
 	class textureImporter
 	{
+		///What a texture is used for by the materials. Only textures with the same use are packed in the same texture array
+		enum class Use { Color, MetalRough, Normal };
+
+		///Texture whose levels are kept in memory until loadTextures packs it in a texture array
+		struct stagedTexture
+		{
+			std::string name;
+			size_t width;
+			size_t height;
+			Ogre::PixelFormat format;
+			bool gamma;
+			Use use;
+			std::vector<std::vector<Ogre::uchar>> levels;
+		};
+
 		///List of the loaded basic textures
-		std::unordered_map<int, Ogre::TexturePtr> loadedTextures;
+		std::unordered_map<int, textureSlice> loadedTextures;
+
+		///Textures created while loadTextures packs them, by name
+		std::map<std::string, stagedTexture> stagedTextures;
+
+		///Names of the textures this importer holds a reference on in the textureRegistry
+		std::unordered_set<std::string> acquiredTextures;
+
+		///Set while loadTextures creates the textures it packs : they are staged in memory instead of being created
+		bool staging = false;
+
+		///Maximum number of slices of a texture array
+		static const size_t maxArraySlices;
+
+		///Hash of the content of the images of the textures that were hashed so far
+		std::unordered_map<int, std::uint64_t> imageHashes;
+
+		///Roles of the textures in the materials, by texture index and Use. Found the first time they are needed
+		mutable std::vector<std::array<bool, 3>> textureUses;
+
+		///Textures whose images were checked for a single color so far. The flag is set if all their pixels are the same
+		std::unordered_map<int, std::pair<bool, std::array<Ogre::uchar, 4>>> uniformColors;
+
+		///Decoded pixels of the images of the textures, by texture index. Textures that share an image decode it once each, they can need
+		///different layouts or sizes. KTX2 images are transcoded for the functions that need to read them
+		std::unordered_map<int, tinygltf::Image> decodedImages;
+
+		///Mip levels of KTX2 images transcoded ahead of the creation of their texture, by image index
+		std::unordered_map<int, std::vector<std::vector<Ogre::uchar>>> transcodedLevels;
+
+		///Mip chains of the decoded images of textures, by texture index and gamma. They are kept until the textures that use them are created,
+		///or until the textureStreamer completes them
+		std::map<std::pair<int, bool>, std::shared_ptr<mipChain>> mipChains;
 
 		///Static counter to make unique texture name. Incremented by constructor
 		static size_t id;
@@ -19,34 +82,259 @@ namespace Ogre_glTF
 		///Reference to the tinygltf
 		tinygltf::Model& model;
 
+		///Options of the adapter
+		const importOptions& options;
+
+		///Statistics of the adapter, the packed textures are counted in them
+		loadStatistics& statistics;
+
+		///Threads used to convert the pixels of the images, created the first time they are needed
+		std::unique_ptr<threadPool> threads;
+
+		///Version of the encoded blocks written in the cache. Increment it when the encoder changes
+		static const std::uint32_t compressedCacheVersion;
+
+		///Call function(index) for each index in [0, count), on importOptions::textureThreadCount threads
+		/// \param count number of calls
+		/// \param function what to do for an index. Needs to be safe to call concurrently
+		void parallelFor(size_t count, const std::function<void(size_t)>& function);
+
+		///Call function(first, last) on consecutive ranges of rows of an image, on importOptions::textureThreadCount threads
+		/// \param height number of rows of the image
+		/// \param function what to do for a range of rows. Needs to be safe to call concurrently on different ranges
+		void forEachRows(size_t height, const std::function<void(size_t, size_t)>& function);
+
+		///Get the name of the Ogre texture made from a glTF texture. It identifies the content of the image, the processing applied to it, and
+		///the options that change the result, so that textures made the same way from the same image share their name
+		/// \param gltfTextureID index of a texture in the gltf file
+		/// \param variant processing applied to the image : empty for a plain color texture, or a suffix naming the processing
+		std::string getTextureName(int gltfTextureID, const std::string& variant = "");
+
+		///Get the decoded pixels of the image of a texture, decoding it the first time they are needed
+		/// \param gltfTextureID index of a texture in the gltf file
+		/// \param imageIndex index of its image, that isn't a KTX2 image
+		/// \return the image, or a null pointer if it can't be decoded
+		const tinygltf::Image* decodeImage(int gltfTextureID, int imageIndex);
+
+		///Get the roles the materials use a texture for, indexed by Use. Textures that no material uses are colors
+		/// \param gltfTextureID index of a texture in the gltf file
+		const std::array<bool, 3>& getUses(int gltfTextureID) const;
+
+		///Get the layout the image of a texture is decoded to : RGB8 if it is only used for metalness and roughness, Color otherwise. A
+		///texture always uses the same layout, its mip chains are made from it
+		/// \param gltfTextureID index of a texture in the gltf file
+		imageDecoder::Layout getImageLayout(int gltfTextureID) const;
+
+		///Get the biggest width or height of a texture, from importOptions::maxTextureSize and the limits of its roles
+		/// \param gltfTextureID index of a texture in the gltf file
+		/// \return the limit, or 0 if the image of the texture already fits
+		size_t getMaxSize(int gltfTextureID) const;
+
+		///Halve a decoded image until it fits in the maximum size of its texture
+		/// \param gltfTextureID index of the texture
+		/// \param image the decoded image, replaced by the downscaled one
+		void downscale(int gltfTextureID, tinygltf::Image& image);
+
+		///Get the KTX2 image of a texture, or -1 if it doesn't have one
+		/// \param gltfTextureID index of a texture in the gltf file
+		int getKtx2Image(int gltfTextureID) const;
+
+		///Create a texture, or stage it if loadTextures is packing the textures
+		/// \param name name of the texture
+		/// \param width width of the first level in pixels
+		/// \param height height of the first level in pixels
+		/// \param levelCount number of mip levels, the first one included
+		/// \param format pixel format of the texture
+		/// \param gamma if set, the texture is sampled as sRGB
+		/// \param use what the materials use the texture for
+		/// \return the texture, or a null pointer if it was staged
+		Ogre::TexturePtr createTexture(
+			const std::string& name, size_t width, size_t height, size_t levelCount, Ogre::PixelFormat format, bool gamma, Use use);
+
+		///Get the memory of a whole level of a texture made by createTexture, to write its pixels
+		/// \param texture the texture, or a null pointer if it was staged
+		/// \param name name of the texture
+		/// \param level index of the level
+		Ogre::PixelBox lockLevel(const Ogre::TexturePtr& texture, const std::string& name, size_t level);
+
+		///Release a level locked by lockLevel
+		/// \param texture the texture, or a null pointer if it was staged
+		/// \param level index of the level
+		void unlockLevel(const Ogre::TexturePtr& texture, size_t level);
+
+		///Write a whole level of a texture made by createTexture
+		/// \param texture the texture, or a null pointer if it was staged
+		/// \param name name of the texture
+		/// \param level index of the level
+		/// \param data pixels or blocks of the level, in the format of the texture, without padding
+		void writeLevel(const Ogre::TexturePtr& texture, const std::string& name, size_t level, const Ogre::uchar* data);
+
+		///Find a texture made by this importer, or by the importer of another adapter, by its name. A reference on it is taken in the
+		///textureRegistry the first time it is found
+		/// \param name name of the texture
+		textureSlice findTexture(const std::string& name);
+
+		///Return true if a texture was created, or staged
+		/// \param name name of the texture
+		bool isTextureCreated(const std::string& name);
+
+		///Register a texture created by this importer, and hold a reference on it
+		/// \param name name of the texture
+		/// \param texture the texture, or the slice of a texture array
+		void registerTexture(const std::string& name, const textureSlice& texture);
+
+		///Create the texture arrays of the staged textures. Textures with the same size, format, levels, gamma and use share an array,
+		///the ones left alone are created as normal textures
+		void packStagedTextures();
+
 		///Load a single texture
-		/// \param texture reference to the texture that we are loading
-		void loadTexture(const tinygltf::Texture& texture);
+		/// \param gltfTextureID index of the texture that we are loading
+		void loadTexture(int gltfTextureID);
 
-		///Checks that is hardware gamma enabled
-		bool isHardwareGammaEnabled() const;
+		///Check if the render system can sample a family of block formats
+		/// \param formats capability of the render system for the formats
+		static bool isFormatSupported(Ogre::Capabilities formats);
+
+		///Check if textures are compressed, and if the render system can sample a family of block formats
+		/// \param formats capability of the render system for the formats
+		bool isCompressionEnabled(Ogre::Capabilities formats) const;
+
+		///Choose the format a KTX2 image is uploaded as. Raw levels are uploaded as they are, Basis Universal ones are transcoded
+		/// \param ktx2 the parsed image
+		/// \param normal if set, the image is a normal map, which can only be uploaded as BC5
+		/// \param target set to the format to transcode Basis Universal levels to
+		/// \return the pixel format of the texture, or PF_UNKNOWN if the image can't be uploaded as it is
+		Ogre::PixelFormat getKtx2Format(const ktx2Image& ktx2, bool normal, basisTranscoder::Target& target) const;
+
+		///Transcode all the levels of some Basis Universal images at once, one level per job, and keep them for createKtx2Texture
+		/// \param images index and target format of the images to transcode
+		void transcodeKtx2Levels(const std::vector<std::pair<int, basisTranscoder::Target>>& images);
+
+		///Create a texture with all the mip levels of a KTX2 image, without decoding them
+		/// \param name name of the texture
+		/// \param imageIndex index of the KTX2 image in the gltf file
+		/// \param normal if set, the image is a normal map
+		/// \param gamma if set, the texture is sampled as sRGB
+		/// \param maxSize biggest width or height of the texture, the bigger levels are skipped. 0 for no limit
+		/// \return false if the image can't be uploaded as it is
+		bool createKtx2Texture(const std::string& name, int imageIndex, bool normal, bool gamma, size_t maxSize);
+
+		///Compute the mip chains of several textures at once : the rows of each level of all the images are spread on the threads together
+		/// \param textures index of the textures, and if their color channels are filtered as sRGB
+		void generateMipChains(const std::vector<std::pair<int, bool>>& textures);
+
+		///Get the mip chain of the decoded image of a texture, computing it if needed
+		/// \param gltfTextureID index of a texture in the gltf file. Its image needs to be decodable
+		/// \param gamma if set, the color channels are filtered as sRGB
+		const mipChain& getMipChain(int gltfTextureID, bool gamma);
+
+		///Get the mip chain of the decoded image of a texture, computing it if needed, with its own copy of the image so that the
+		///textureStreamer can use it after the importer is destroyed
+		/// \param gltfTextureID index of a texture in the gltf file. Its image needs to be decodable
+		/// \param gamma if set, the color channels are filtered as sRGB
+		std::shared_ptr<const mipChain> getStreamedMipChain(int gltfTextureID, bool gamma);
+
+		///Check if a texture created now would be streamed : importOptions::streamTextures is set, the textures are not staged, and the
+		///texture has levels bigger than importOptions::streamedLevelSize
+		/// \param width width of the first level in pixels
+		/// \param height height of the first level in pixels
+		bool isStreamed(size_t width, size_t height) const;
+
+		///Create a texture with only its levels that are not bigger than importOptions::streamedLevelSize, and add it to the
+		///textureStreamer that completes it with all its levels
+		/// \param name name of the texture
+		/// \param width width of the first level of the complete texture in pixels
+		/// \param height height of the first level of the complete texture in pixels
+		/// \param levelCount number of levels of the complete texture, the first one included
+		/// \param format pixel format of the texture
+		/// \param gamma if set, the texture is sampled as sRGB
+		/// \param use what the materials use the texture for
+		/// \param computeLevel compute the pixels or the blocks of a level, without padding. Called now for the small levels, then from the
+		///thread of the streamer for all of them. It can't use the importer
+		/// \param onComplete called by the streamer with all the levels, once the complete texture is uploaded. Can be empty
+		/// \return the small texture
+		Ogre::TexturePtr createStreamedTexture(const std::string& name,
+											   size_t width,
+											   size_t height,
+											   size_t levelCount,
+											   Ogre::PixelFormat format,
+											   bool gamma,
+											   Use use,
+											   std::function<void(size_t, Ogre::uchar*)> computeLevel,
+											   std::function<void(const std::vector<std::vector<Ogre::uchar>>&)> onComplete);
+
+		///Create a block compressed texture from some channels of an image, with all its mip levels. The encoded blocks are read from, and
+		///written to, importOptions::textureCacheDirectory when it is set. The mip chain is only computed when they are not in the cache
+		/// \param name name of the texture
+		/// \param gltfTextureID index of the texture in the gltf file
+		/// \param format block format of the texture
+		/// \param firstChannel first channel of the image to encode
+		/// \param channels number of channels to encode, starting from firstChannel
+		/// \param gamma if set, the texture is sampled as sRGB
+		/// \param use what the materials use the texture for
+		/// \return the texture, or a null pointer if it was staged. Streamed textures only have their small levels
+		Ogre::TexturePtr createCompressedTexture(const std::string& name,
+												 int gltfTextureID,
+												 textureCompressor::Format format,
+												 size_t firstChannel,
+												 size_t channels,
+												 bool gamma,
+												 Use use);
 
 	public:
 		///Construct the texture importer object. Inrement the id counter
 		/// \param input reference to the model that we are loading
-		textureImporter(tinygltf::Model& input);
+		/// \param importSettings options of the adapter
+		/// \param adapterStatistics statistics of the adapter
+		textureImporter(tinygltf::Model& input, const importOptions& importSettings, loadStatistics& adapterStatistics);
+
+		///Destructor, stop the threads and release the textures of the importer
+		~textureImporter();
 
-		///Load all the textures in the model
+		///Checks that is hardware gamma enabled. If it is, the textures are sampled as sRGB
+		bool isHardwareGammaEnabled() const;
+
+		///Load all the textures in the model. With importOptions::packTextureArrays, the textures the materials use are all created here, and
+		///the ones with the same size, format and use are packed in shared texture arrays
 		void loadTextures();
 
 		///Get the loaded texture that corespound to the given index
-		/// \param glTFTextureSourceID index of a texture in the gltf file
-		Ogre::TexturePtr getTexture(int glTFTextureSourceID);
-
-		///Get the texture that corespound to the given index, but as a greyscale one containing only
-		///the information of the given channel. It seems that the order of channel on loaded textures
-		///is BGR
-		/// \param gltfTextureSourceID index of a texture in the gltf file
-		/// \param channel index of a channel. Starts from zero
-		Ogre::TexturePtr generateGreyScaleFromChannel(int gltfTextureSourceID, int channel);
-
-		///Get the normal texture in a compatible format
-		/// \param gltfTextureSourceID index of a texture in the gltf file
-		Ogre::TexturePtr getNormalSNORM(int gltfTextureSourceID);
+		/// \param gltfTextureID index of a texture in the gltf file
+		textureSlice getTexture(int gltfTextureID);
+
+		///Get the decoded pixels of the image of a texture, decoding it if needed. KTX2 images are transcoded to RGBA8, unless the texture has
+		///a fallback image
+		/// \param gltfTextureID index of a texture in the gltf file
+		/// \return the image, or a null pointer if the texture doesn't have an image that can be decoded
+		const tinygltf::Image* getDecodedImage(int gltfTextureID);
+
+		///Return true if the image of a texture has an alpha channel. Decoded images whose alpha is 255 everywhere don't have one
+		/// \param gltfTextureID index of a texture in the gltf file
+		bool hasAlphaChannel(int gltfTextureID);
+
+		///Get the metalness and the roughness of a glTF metallicRoughness texture as two single channel textures. Both channels are
+		///extracted in one pass over the image : metalness is in the B channel (index 2), roughness in the G channel (index 1)
+		/// \param gltfTextureID index of a texture in the gltf file
+		/// \return the metalness texture, and the roughness texture
+		std::pair<textureSlice, textureSlice> getMetalRoughTextures(int gltfTextureID);
+
+		///Get a hash of the encoded content of the image of a texture, that identify it regardless of the file it comes from
+		/// \param gltfTextureID index of a texture in the gltf file
+		std::uint64_t getImageHash(int gltfTextureID);
+
+		///Get what identifies the textures made from a glTF texture, whatever their role : its image, and how the adapter processes it.
+		///Datablocks that bind textures with different keys can't be shared
+		/// \param gltfTextureID index of a texture in the gltf file
+		std::string getTextureKey(int gltfTextureID);
+
+		///Check if all the pixels of an image have the same color. Such an image can be replaced by a constant in a material
+		/// \param gltfTextureID index of a texture in the gltf file
+		/// \param color set to the RGBA color of the pixels if they are all the same. Alpha is 255 for images without an alpha channel
+		bool getUniformColor(int gltfTextureID, std::array<Ogre::uchar, 4>& color);
+
+		///Get the normal texture in a compatible format : the UNORM pixels of the image are converted to SNORM. Only the X and Y channels
+		///are kept if importOptions::twoChannelNormalMaps is set. KTX2 images are transcoded to BC5 when the render system supports it
+		/// \param gltfTextureID index of a texture in the gltf file
+		textureSlice getNormalSNORM(int gltfTextureID);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <OgreTexture.h>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace Ogre_glTF
+{
+	///A texture made by the importer : a whole texture, or a slice of a texture array shared with other textures of the same size, format
+	///and use
+	struct textureSlice
+	{
+		///The texture, null if there is none
+		Ogre::TexturePtr texture;
+
+		///Index of the slice in the texture array
+		Ogre::uint16 slice = 0;
+	};
+
+	///Process wide registry of the textures made by the texture importers of all the adapters. Textures are named after the content of
+	///their image and the processing applied to it, so that the same image loaded from different files maps to a single texture. Each
+	///importer holds a reference on the textures it uses. The registry only keeps names, the textures belong to Ogre's texture manager.
+	///It is used from the thread that loads the files
+	class textureRegistry
+	{
+	public:
+		///Get a registered texture, without adding a reference to it
+		/// \param name name of the texture
+		/// \return the texture, or a null texture if there isn't one with this name
+		static textureSlice find(const std::string& name);
+
+		///Get a texture and add a reference to it. Textures of the texture manager that are not registered yet are registered
+		/// \param name name of the texture
+		/// \return the texture, or a null texture if there isn't one with this name
+		static textureSlice acquire(const std::string& name);
+
+		///Register a new texture, with one reference
+		/// \param name name of the texture
+		/// \param texture the texture, or the slice of a texture array
+		static void add(const std::string& name, const textureSlice& texture);
+
+		///Remove a reference to a texture. Once a texture (or all the slices of a texture array) isn't referenced anymore, it is removed from
+		///the registry and from the texture manager. Unless a datablock still uses it : it then stays registered, to be acquired again
+		/// \param name name of the texture
+		static void release(const std::string& name);
+
+		///Remove the textures that are not referenced anymore, and that were kept because a datablock was using them, if no datablock uses
+		///them now. Called by the residencyManager once it destroyed datablocks
+		static void collect();
+
+		///Get the video memory used by the registered textures, all their levels and slices included, in bytes
+		static size_t getMemory();
+
+	private:
+		///A registered texture
+		struct entry
+		{
+			///Name of the texture in the texture manager. It is the name of the texture array for packed textures
+			std::string textureName;
+
+			///Index of the slice in the texture array
+			Ogre::uint16 slice;
+
+			///Number of importers that use the texture
+			size_t references;
+		};
+
+		///Get the registered textures, by name
+		static std::unordered_map<std::string, entry>& getEntries();
+
+		///Remove a texture from the registry and from the texture manager if none of its slices is referenced, and no datablock uses it
+		/// \param textureName name of the texture in the texture manager
+		static void removeIfUnused(const std::string& textureName);
+	};
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ogre_glTF
+{
+	///Small pool of worker threads, used to spread loops over independent elements on all the cores of the machine
+	class threadPool
+	{
+	public:
+		///Start the worker threads
+		/// \param threadCount number of threads that run the loops, including the calling thread. 0 means one per hardware thread
+		explicit threadPool(size_t threadCount = 0);
+
+		///Stop and join the worker threads
+		~threadPool();
+
+		///Non copyable object
+		threadPool(const threadPool&) = delete;
+
+		///Non copyable object
+		threadPool& operator=(const threadPool&) = delete;
+
+		///Get the number of threads that run the loops, including the calling thread
+		size_t size() const;
+
+		///Call function(i) for each i in [0; count). The calls are spread on the workers and the calling thread. Return when all of them are done
+		/// \param count number of elements to process
+		/// \param function what to do for one element. Needs to be safe to call concurrently on different elements
+		void parallelFor(size_t count, const std::function<void(size_t)>& function);
+
+	private:
+		///What the worker threads do until the pool is destroyed
+		void workerLoop();
+
+		///Process elements of the current loop until there are none left
+		void work();
+
+		///The worker threads
+		std::vector<std::thread> workers;
+
+		///Protect the state of the current loop
+		std::mutex mutex;
+
+		///Used to wake up the workers when there's a new loop
+		std::condition_variable wakeUp;
+
+		///Used to notify the calling thread that the workers are done with the current loop
+		std::condition_variable finished;
+
+		///The function of the current loop
+		const std::function<void(size_t)>* job = nullptr;
+
+		///Number of elements in the current loop
+		size_t jobSize = 0;
+
+		///Next element to process in the current loop
+		std::atomic<size_t> nextElement { 0 };
+
+		///Incremented each time a loop starts, so that workers can tell new loops apart
+		size_t generation = 0;
+
+		///Number of workers still running the current loop
+		size_t busyWorkers = 0;
+
+		///Set when the pool is destroyed
+		bool stopping = false;
+	};
+}